@@ -0,0 +1,137 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+'use strict';
+
+jest.mock('bindings', () => () => ({}));
+
+const AdapterFactory = require('../adapterFactory');
+
+// openMany only uses the adapters it is given, it is called without the singleton and its driver bindings
+function openMany(adapters, options, callback) {
+    AdapterFactory.prototype.openMany.call({}, adapters, options, callback);
+}
+
+// Adapter whose open reports the given error, or succeeds, once finish is called
+function createAdapter(error) {
+    const adapter = {};
+    adapter.open = (options, callback) => {
+        adapter.options = options;
+        adapter.finish = () => callback(error);
+    };
+    return adapter;
+}
+
+describe('AdapterFactory.openMany', () => {
+
+    it('should call back with an empty list when there are no adapters', () => {
+        const callback = jest.fn();
+
+        openMany([], {}, callback);
+
+        expect(callback).toHaveBeenCalledTimes(1);
+        expect(callback.mock.calls[0][0]).toEqual([]);
+    });
+
+    it('should report the results in the order of the adapters', () => {
+        const adapters = [createAdapter(), createAdapter(), createAdapter()];
+        const callback = jest.fn();
+
+        openMany(adapters, { baudRate: 1000000 }, callback);
+
+        adapters[2].finish();
+        adapters[0].finish();
+        expect(callback).toHaveBeenCalledTimes(0);
+        adapters[1].finish();
+
+        expect(callback).toHaveBeenCalledTimes(1);
+        const results = callback.mock.calls[0][0];
+        expect(results).toHaveLength(3);
+        results.forEach((result, index) => {
+            expect(result.adapter).toBe(adapters[index]);
+            expect(result.error).toBeUndefined();
+        });
+    });
+
+    it('should report the failures next to the adapters that opened', () => {
+        const failure = new Error('Could not open');
+        const adapters = [createAdapter(), createAdapter(failure), createAdapter()];
+        const callback = jest.fn();
+
+        openMany(adapters, {}, callback);
+        adapters.forEach(adapter => adapter.finish());
+
+        const results = callback.mock.calls[0][0];
+        expect(results[0].error).toBeUndefined();
+        expect(results[1].error).toBe(failure);
+        expect(results[2].error).toBeUndefined();
+    });
+
+    it('should only count the first outcome of an adapter', () => {
+        const adapters = [createAdapter(), createAdapter()];
+        const callback = jest.fn();
+
+        openMany(adapters, {}, callback);
+        adapters[0].finish();
+        adapters[0].finish();
+
+        expect(callback).toHaveBeenCalledTimes(0);
+        adapters[1].finish();
+        expect(callback).toHaveBeenCalledTimes(1);
+    });
+
+    it('should give each adapter its own copy of the options', () => {
+        const options = { baudRate: 1000000 };
+        const adapters = [createAdapter(), createAdapter()];
+
+        openMany(adapters, options, jest.fn());
+
+        expect(adapters[0].options).toEqual(options);
+        expect(adapters[0].options).not.toBe(options);
+        expect(adapters[0].options).not.toBe(adapters[1].options);
+    });
+
+    it('should take the options of each adapter from a function', () => {
+        const adapters = [createAdapter(), createAdapter()];
+        const options = jest.fn(adapter => ({ port: adapters.indexOf(adapter) }));
+
+        openMany(adapters, options, jest.fn());
+
+        expect(adapters[0].options).toEqual({ port: 0 });
+        expect(adapters[1].options).toEqual({ port: 1 });
+    });
+});
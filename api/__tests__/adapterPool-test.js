@@ -0,0 +1,151 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+'use strict';
+
+const EventEmitter = require('events');
+const AdapterPool = require('../adapterPool');
+
+// Stands in for the native pool, selects the adapter id set by the test
+class NativePool {
+    constructor() {
+        this.nextId = 0;
+        this.selected = undefined;
+        this.add = jest.fn(() => this.nextId++);
+        this.remove = jest.fn(() => true);
+        this.select = jest.fn(() => this.selected);
+        this.getLoad = jest.fn(() => []);
+    }
+}
+
+describe('AdapterPool', () => {
+
+    let driver;
+    let nativePool;
+    let pool;
+
+    // Adapter of the driver, connecting succeeds right away
+    function createAdapter() {
+        const adapter = new EventEmitter();
+        adapter.driver = driver;
+        adapter._adapter = {};
+        adapter.connect = jest.fn((deviceAddress, options, callback) => callback(undefined, { address: deviceAddress }));
+        return adapter;
+    }
+
+    beforeEach(() => {
+        driver = {
+            AdapterPool: function AdapterPoolBinding() {
+                nativePool = new NativePool();
+                return nativePool;
+            },
+        };
+        pool = new AdapterPool({ peerMaxAge: 5000 });
+    });
+
+    describe('select', () => {
+
+        it('should return undefined when no adapter has been added', () => {
+            expect(pool.select('AA:BB:CC:DD:EE:FF')).toBeUndefined();
+        });
+
+        it('should return the adapter chosen by the native pool', () => {
+            const first = createAdapter();
+            const second = createAdapter();
+            pool.add(first);
+            const secondId = pool.add(second);
+
+            nativePool.selected = secondId;
+
+            expect(pool.select('AA:BB:CC:DD:EE:FF')).toBe(second);
+            expect(nativePool.select).toHaveBeenCalledWith('AA:BB:CC:DD:EE:FF', 5000, undefined);
+        });
+
+        it('should pass the address type of an address object', () => {
+            pool.add(createAdapter());
+            nativePool.selected = 0;
+
+            pool.select({ address: 'AA:BB:CC:DD:EE:FF', type: 'BLE_GAP_ADDR_TYPE_RANDOM_STATIC' });
+
+            expect(nativePool.select).toHaveBeenCalledWith('AA:BB:CC:DD:EE:FF', 5000, 'BLE_GAP_ADDR_TYPE_RANDOM_STATIC');
+        });
+
+        it('should return undefined when every adapter has been removed', () => {
+            const adapter = createAdapter();
+            pool.add(adapter);
+            pool.remove(adapter);
+
+            expect(pool.select('AA:BB:CC:DD:EE:FF')).toBeUndefined();
+        });
+
+        it('should refuse adapters of another driver', () => {
+            pool.add(createAdapter());
+
+            const other = createAdapter();
+            other.driver = { AdapterPool: NativePool };
+
+            expect(() => pool.add(other)).toThrowError(/same pc-ble-driver API version/);
+        });
+    });
+
+    describe('connect', () => {
+
+        it('should report an empty pool through the callback only', () => {
+            const callback = jest.fn();
+            const errorListener = jest.fn();
+            pool.on('error', errorListener);
+
+            expect(pool.connect('AA:BB:CC:DD:EE:FF', {}, callback)).toBeUndefined();
+
+            expect(callback).toHaveBeenCalledTimes(1);
+            expect(callback.mock.calls[0][0].message).toMatch(/adapter pool is empty/);
+            expect(errorListener).not.toHaveBeenCalled();
+        });
+
+        it('should connect through the selected adapter', () => {
+            const adapter = createAdapter();
+            const callback = jest.fn();
+            pool.add(adapter);
+            nativePool.selected = 0;
+
+            expect(pool.connect('AA:BB:CC:DD:EE:FF', { scanParams: {} }, callback)).toBe(adapter);
+
+            expect(adapter.connect.mock.calls[0][0]).toEqual('AA:BB:CC:DD:EE:FF');
+            expect(callback).toHaveBeenCalledWith(undefined, { address: 'AA:BB:CC:DD:EE:FF' }, adapter);
+        });
+    });
+});
@@ -93,11 +93,13 @@ const _makeError = function (userMessage, description) {
  * @fires Adapter#deviceNotifiedOrIndicated
  * @fires Adapter#error
  * @fires Adapter#keyPressed
+ * @fires Adapter#lescDhkeyAutoReplied
  * @fires Adapter#lescDhkeyRequest
  * @fires Adapter#logMessage
  * @fires Adapter#opened
  * @fires Adapter#passkeyDisplay
  * @fires Adapter#scanTimedOut
+ * @fires Adapter#secInfoAutoReplied
  * @fires Adapter#secInfoRequest
  * @fires Adapter#secParamsRequest
  * @fires Adapter#securityChanged
@@ -140,11 +142,34 @@ class Adapter extends EventEmitter {
         this._notSupportedMessage = notSupportedMessage;
 
         this._keys = null;
+        this._lescAutoReply = false;
+        this._defaultCommandTimeout = 0;
         this._attMtuMap = {};
 
+        // Events are only rendered as debug log text when someone listens to logMessage
+        this.on('newListener', event => this._onListenerChange(event, 1));
+        this.on('removeListener', event => this._onListenerChange(event, 0));
+
+        this._adapter.setCompletionCallback(this._completionCallback.bind(this));
+
         this._init();
     }
 
+    // Commands completed by the AddOn in the same wakeup are delivered here in one call
+    _completionCallback(completions) {
+        let firstError;
+
+        for (const completion of completions) {
+            try {
+                completion.callback.apply(undefined, completion.args);
+            } catch (error) {
+                if (firstError === undefined) firstError = error;
+            }
+        }
+
+        if (firstError !== undefined) throw firstError;
+    }
+
     _init() {
         this._devices = {};
         this._services = {};
@@ -226,9 +251,77 @@ class Adapter extends EventEmitter {
      _generateKeyPair() {
         if (this._keys === null) {
             this._keys = this._security.generateKeyPair();
+
+            if (this._lescAutoReply) {
+                this._adapter.setLescPrivateKey(this._keys.sk);
+            }
         }
     }
 
+    /**
+     * @summary Answer LE Secure Connections DHKey requests natively with this adapter's key-pair.
+     *
+     * While enabled, the shared secret is computed on a native worker thread and sent to the SoftDevice
+     * without waiting for JavaScript. <code>lescDhkeyAutoReplied</code> is emitted instead of
+     * <code>lescDhkeyRequest</code>. Requests that need OOB data are still emitted as <code>lescDhkeyRequest</code>.
+     *
+     * @param {boolean} enabled Whether to answer the requests natively.
+     * @returns {void}
+     */
+    setLescDhkeyAutoReply(enabled) {
+        this._lescAutoReply = enabled;
+
+        if (enabled) {
+            this._generateKeyPair();
+            this._adapter.setLescPrivateKey(this._keys.sk);
+        } else {
+            this._adapter.setLescPrivateKey(null);
+        }
+    }
+
+    /**
+     * @summary Keep the bonds of this adapter in a file and answer security information requests from it natively.
+     *
+     * Bonds are stored when pairing completes, <code>bond_store_pending</code> of <code>authStatus</code> then tells
+     * that the bond is being written. The file is written off the event loop and replaced atomically on every change,
+     * a failed write is reported as an error log message and leaves the stored bonds unchanged.
+     * Security information requests of stored peers are answered without waiting for JavaScript,
+     * <code>secInfoAutoReplied</code> is then emitted instead of <code>secInfoRequest</code>.
+     * LE Secure Connections bonds are found by the identity address of the peer. A peer reconnecting with a
+     * resolvable private address is not resolved with the stored IRK, its request is emitted as <code>secInfoRequest</code>.
+     *
+     * The file is read off the event loop, the callback is called once the store is open.
+     *
+     * @param {string|null} path Path of the bond store, created if it does not exist. <code>null</code> closes the store.
+     * @param {function(Error)} callback Callback signature: err => {}. Called with an error if the file can not be read
+     *                                   or is not a bond store.
+     * @returns {void}
+     */
+    setBondStore(path, callback) {
+        this._adapter.setBondStore(path, callback);
+    }
+
+    /**
+     * Get the bonds in the bond store. The keys are not included.
+     *
+     * @returns {Object[]} Peer address and key properties of each bond.
+     */
+    getBonds() {
+        return this._adapter.getBonds();
+    }
+
+    /**
+     * Remove a bond from the bond store.
+     *
+     * @param {Object} address Identity address of the peer, as returned by <code>getBonds</code>.
+     * @param {function(Error)} callback Callback signature: err => {}. Called with an error if the bond store
+     *                                   can not be written.
+     * @returns {void}
+     */
+    deleteBond(address, callback) {
+        this._adapter.deleteBond(address, callback);
+    }
+
     /**
      * Compute shared secret.
      *
@@ -247,6 +340,27 @@ class Adapter extends EventEmitter {
         return this._security.generateSharedSecret(this._keys.sk, publicKey.pk).ss;
     }
 
+    /**
+     * Compute shared secret on a worker thread, without blocking event delivery while it runs.
+     *
+     * @param {Object} [peerPublicKey] Peer public key.
+     * @param {function(Error, Array)} callback Callback signature: (err, sharedSecret) => {}.
+     * @returns {void}
+     */
+    computeSharedSecretAsync(peerPublicKey, callback) {
+        this._generateKeyPair();
+
+        let publicKey = peerPublicKey;
+
+        if (publicKey === null || publicKey === undefined) {
+            publicKey = this._keys;
+        }
+
+        this._security.generateSharedSecretAsync(this._keys.sk, publicKey.pk, (err, result) => {
+            if (callback) { callback(err, result && result.ss); }
+        });
+    }
+
     /**
      * Compute public key.
      *
@@ -341,6 +455,138 @@ class Adapter extends EventEmitter {
         };
     }
 
+    /**
+     * @summary Set the time commands issued on this adapter may take before they fail.
+     *
+     * The timeout covers both the time a command waits behind other commands and the time the connectivity chip
+     * takes to respond. A command that times out while waiting is never sent, and its callback receives an error
+     * with <code>timeoutStage</code> set to <code>'queued'</code>. A command that has been sent can not be
+     * interrupted; if it times out, its callback receives its real result when the response arrives. An error
+     * in that result has <code>timeoutStage</code> set to <code>'inFlight'</code>.
+     *
+     * Only applies to commands issued after the call.
+     *
+     * @param {number} timeout Timeout in milliseconds, or `0` to disable timeouts.
+     * @returns {void}
+     */
+    setDefaultCommandTimeout(timeout) {
+        this._defaultCommandTimeout = timeout;
+        this._adapter.setDefaultCommandTimeout(timeout);
+    }
+
+    /**
+     * @summary Issue commands with their own deadline and get a handle to abort them.
+     *
+     * Every command queued on this adapter while <code>issue</code> runs gets the timeout in <code>options</code>
+     * instead of the default command timeout. Commands queued after <code>issue</code> has returned, for example
+     * by the later steps of an operation made of several commands, are not covered. Opening, closing and resetting
+     * the adapter are never timed out or aborted.
+     *
+     * @example
+     * const handle = adapter.withCommandOptions({ timeout: 500 }, () => {
+     *     adapter.writeCharacteristicValue(characteristicId, value, false, err => { ... });
+     * });
+     * // Later, if nobody waits for the write anymore:
+     * handle.abort();
+     *
+     * @param {Object} options Options for the commands.
+     * @param {number} [options.timeout] Timeout in milliseconds, or `0` for none. Defaults to the default command timeout.
+     * @param {function} issue Function calling the methods of this adapter.
+     * @returns {Object} <code>commandIds</code>, the ids of the covered commands, and <code>abort()</code>. Abort
+     *                   cancels the covered commands that have not been sent yet, their callbacks receive an error
+     *                   with <code>cancelled</code> set. It returns the number of commands cancelled.
+     */
+    withCommandOptions(options, issue) {
+        const first = this._adapter.getLastCommandId() + 1;
+
+        if (options.timeout !== undefined) {
+            this._adapter.setDefaultCommandTimeout(options.timeout);
+        }
+
+        try {
+            issue();
+        } finally {
+            this._adapter.setDefaultCommandTimeout(this._defaultCommandTimeout);
+        }
+
+        const last = this._adapter.getLastCommandId();
+        const commandIds = [];
+
+        for (let id = first; id <= last; id++) {
+            commandIds.push(id);
+        }
+
+        return {
+            commandIds,
+            abort: () => commandIds.filter(id => this._adapter.cancelCommand(id)).length,
+        };
+    }
+
+    /**
+     * @summary Limit the number of driver log messages of a severity.
+     *
+     * Messages over the limit are dropped before they reach JavaScript, the number dropped is reported with the
+     * next delivered messages. By default trace and debug messages are limited to 2000 per second.
+     *
+     * @param {number} severity Severity to limit, one of the values of <code>logLevel</code>.
+     * @param {number} rate Messages per second, or `0` to not limit the severity.
+     * @param {number} [burst=rate] Number of messages that may be delivered at once after a quiet period.
+     * @returns {void}
+     */
+    setLogRateLimit(severity, rate, burst) {
+        this._adapter.setLogRateLimit(severity, rate, burst);
+    }
+
+    /**
+     * @summary Get the health of the link to the connectivity chip.
+     *
+     * The counters are cumulative since the adapter was opened. The round trip times, in milliseconds, cover the
+     * most recent 256 commands. The report has these members:
+     * <ul>
+     * <li>{number} roundTripCount, roundTripP50, roundTripP90, roundTripP99, roundTripMax
+     * <li>{number} sendRetriesExhaustedCount: Packets the transport gave up on after retransmitting them.
+     * <li>{number} unexpectedPacketCount, encodeErrorCount, decodeErrorCount, sendErrorCount
+     * <li>{number} ioErrorCount: Times the serial port was not available.
+     * <li>{number} resetCount: Resets of the connectivity chip.
+     * <li>{number} eventCount, eventBytes
+     * <li>{number} timeSinceLastEvent: Milliseconds since the last event, or `-1` if there was none.
+     * <li>{number} notificationQueueDepth: Events and statuses waiting for JavaScript.
+     * <li>{number} commandQueueDepth: Commands waiting for the adapter's command thread.
+     * <li>{number} logDroppedCount
+     * <li>{number} uptime: Milliseconds since the adapter was opened.
+     * </ul>
+     *
+     * @returns {Object} The health report.
+     */
+    getHealthReport() {
+        return this._adapter.getHealthReport();
+    }
+
+    /**
+     * @summary Emit a health report as a <code>status</code> event at an interval.
+     *
+     * @param {number} interval Interval in milliseconds, or `0` to stop the reports.
+     * @returns {void}
+     */
+    setHealthReportInterval(interval) {
+        this._adapter.setHealthReportInterval(interval);
+    }
+
+    /**
+     * @summary Write the flight recorder of this adapter to a file.
+     *
+     * The flight recorder keeps the most recent driver events, commands, statuses and log messages of every
+     * severity, also those not delivered because of their rate limit. Decode the file with
+     * <code>api/util/flightRecorder.js</code>.
+     *
+     * @param {string} path File to write.
+     * @param {function(Error, number)} callback Callback signature: (err, length) => {}.
+     * @returns {void}
+     */
+    dumpFlightRecorder(path, callback) {
+        this._adapter.dumpFlightRecorder(path, callback);
+    }
+
     /**
      * @summary Initialize the adapter.
      *
@@ -359,8 +605,30 @@ class Adapter extends EventEmitter {
      * <li>{number} [retransmissionInterval=250]: The time interval to wait between retransmitted packets.
      * <li>{number} [responseTimeout=1500]: Response timeout of the data link layer.
      * <li>{boolean} [enableBLE=true]: Whether the BLE stack should be initialized and enabled.
+     * <li>{number} [commandTimeout=0]: Time in milliseconds a command may wait and run before it fails with a
+     *                                  timeout error. If `0`, commands never time out. See <code>setDefaultCommandTimeout</code>.
+     * <li>{number} [flightRecorderSize=4194304]: Size in bytes of the flight recorder, or `0` to disable it.
+     *                                           See <code>dumpFlightRecorder</code>.
+     * <li>{number} [healthReportInterval=0]: Interval in milliseconds of the transport health reports emitted as
+     *                                       <code>status</code> events, or `0` for none. See <code>getHealthReport</code>.
+     * <li>{Object[]} [initScript]: Configuration commands to run right after the BLE stack is enabled, in order and without
+     *                              returning to JavaScript in between. Each entry has an <code>op</code> and the parameters of
+     *                              the command it stands for:
+     *                              <ul>
+     *                              <li><code>{ op: 'setBleOption', optId, option }</code>
+     *                              <li><code>{ op: 'addVendorSpecificUUID', uuid: { uuid128 } }</code>
+     *                              <li><code>{ op: 'gapSetAddress', address: { address, type }, cycleMode }</code>
+     *                              <li><code>{ op: 'gapSetDeviceName', connSecMode: { sm, lv }, name }</code>
+     *                              <li><code>{ op: 'gapSetPPCP', connParams }</code>
+     *                              <li><code>{ op: 'gapSetAppearance', appearance }</code>
+     *                              <li><code>{ op: 'gapSetTXPower', txPower }</code>
+     *                              <li><code>{ op: 'gapSetAdvertisingData', data, scanResponse }</code>
+     *                              </ul>
+     *                              If a step fails the adapter is closed again and the error names the step.
      * </ul>
-     * @param {function(Error)} [callback] Callback signature: err => {}.
+     * @param {function(Error, Object)} [callback] Callback signature: (err, initScriptResult) => {}, where
+     *                                             <code>initScriptResult</code> is <code>{ stepCount, duration, vendorUuidTypes }</code>
+     *                                             if an init script was given.
      * @returns {void}
      */
     open(options, callback) {
@@ -387,6 +655,7 @@ class Adapter extends EventEmitter {
                 retransmissionInterval: 250,
                 responseTimeout: 1500,
                 enableBLE: true,
+                commandTimeout: 0,
             };
         } else {
             if (!options.baudRate) options.baudRate = 115200;
@@ -397,8 +666,11 @@ class Adapter extends EventEmitter {
             if (!options.retransmissionInterval) options.retransmissionInterval = 250;
             if (!options.responseTimeout) options.responseTimeout = 1500;
             if (options.enableBLE === undefined) options.enableBLE = true;
+            if (!options.commandTimeout) options.commandTimeout = 0;
         }
 
+        this.setDefaultCommandTimeout(options.commandTimeout);
+
         this._changeState({ baudRate: options.baudRate, parity: options.parity, flowControl: options.flowControl });
 
         options.logCallback = this._logCallback.bind(this);
@@ -406,7 +678,7 @@ class Adapter extends EventEmitter {
         options.statusCallback = this._statusCallback.bind(this);
         options.enableBLEParams = this._getDefaultEnableBLEParams();
 
-        this._adapter.open(this._state.port, options, err => {
+        this._adapter.open(this._state.port, options, (err, initScriptResult) => {
             if (this._checkAndPropagateError(err, 'Error occurred opening serial port.', callback)) { return; }
 
             this._changeState({ available: true });
@@ -427,7 +699,7 @@ class Adapter extends EventEmitter {
                 });
             }
 
-            if (callback) { callback(); }
+            if (callback) { callback(undefined, initScriptResult); }
         });
     }
 
@@ -489,6 +761,63 @@ class Adapter extends EventEmitter {
         });
     }
 
+    /**
+     * @summary Recover the connectivity device without closing the serial port.
+     *
+     * The connectivity device is reset, and once the link to it is active again the configuration
+     * done since the BLE stack was enabled is applied again natively in one batch: the enable parameters,
+     * vendor specific UUIDs, BLE options, GAP settings, advertising data and the GATT server table.
+     * This is much faster than <code>close</code> followed by <code>open</code>.
+     *
+     * Connections and ongoing operations are lost. The GATT server attributes keep their handles.
+     *
+     * @param {Object} [options] Options:
+     * <ul>
+     * <li>{number} [resetTimeout=2000]: Time in milliseconds to wait for the device to come back after the reset.
+     * </ul>
+     * @param {function(Error, Object)} [callback] Callback signature: (err, timing) => {}, where timing has
+     *                                             <code>resetTime</code>, <code>replayTime</code> and
+     *                                             <code>timeToReady</code> in milliseconds, and
+     *                                             <code>replayedCount</code>.
+     * @returns {void}
+     */
+    reinitialize(options, callback) {
+        if (typeof options === 'function') {
+            callback = options;
+            options = {};
+        }
+
+        const resetTimeout = (options && options.resetTimeout) || 2000;
+
+        if (!this.state.available) {
+            if (callback) callback(_makeError('The adapter is not available.'));
+            return;
+        }
+
+        // The GATT server table is restored natively, only the connection state is cleared on reset
+        const attributes = {
+            services: this._services,
+            characteristics: this._characteristics,
+            descriptors: this._descriptors,
+        };
+        const bleEnabled = this.state.bleEnabled;
+
+        this._reinitializing = true;
+
+        this._adapter.reinitialize(resetTimeout, (err, timing) => {
+            this._reinitializing = false;
+
+            if (this._checkAndPropagateError(err, 'Error occurred reinitializing adapter.', callback)) { return; }
+
+            this._services = attributes.services;
+            this._characteristics = attributes.characteristics;
+            this._descriptors = attributes.descriptors;
+            this._changeState({ available: true, bleEnabled });
+
+            if (callback) { callback(undefined, timing); }
+        });
+    }
+
     /**
      * This function is for debugging purposes. It will return an object with these members:
      * <ul>
@@ -496,6 +825,16 @@ class Adapter extends EventEmitter {
      * <li>{number} eventCallbackTotalCount
      * <li>{number} eventCallbackBatchMaxCount
      * <li>{number} eventCallbackBatchAvgCount
+     * <li>{number} eventQueueFullCount: Number of times the driver had to wait for room in the event queue.
+     * <li>{number} logDroppedCount: Number of log entries dropped because the log queue was full.
+     * <li>{number} commandQueueDepth: Number of commands waiting for the adapter's command thread.
+     * <li>{number} commandQueueMaxDepth
+     * <li>{number} commandTotalCount
+     * <li>{number} commandWaitTimeAvg: Average time in milliseconds a command waited before being executed.
+     * <li>{number} commandWaitTimeMax
+     * <li>{number} commandCompletionBatchAvgCount: Average number of commands completed per wakeup.
+     * <li>{number} commandTimedOutCount: Number of commands that failed with a timeout.
+     * <li>{number} commandCancelledCount: Number of commands cancelled before they were started.
      * </ul>
      *
      * @returns {Object} This adapters stats.
@@ -504,6 +843,41 @@ class Adapter extends EventEmitter {
         return this._adapter.getStats();
     }
 
+    /**
+     * @summary Start recording a timeline of the commands and events of this adapter.
+     *
+     * For each command the time it was queued, started and returned from the connectivity chip, and the
+     * time its callback ran, are recorded. For each event the time it was received from the driver, queued,
+     * dispatched to JavaScript and handled are recorded. The records are kept in a fixed size ring in the
+     * native addon, the oldest records are overwritten when it is full.
+     *
+     * @param {number} [capacity=65536] Number of records kept. Only used the first time tracing is started.
+     * @returns {void}
+     */
+    startTrace(capacity) {
+        this._adapter.setTracing(true, capacity);
+    }
+
+    /**
+     * @summary Stop recording the timeline. The records are kept and can still be retrieved.
+     *
+     * @returns {void}
+     */
+    stopTrace() {
+        this._adapter.setTracing(false);
+    }
+
+    /**
+     * @summary Get the recorded timeline in Chrome trace event JSON format.
+     *
+     * The result can be loaded in chrome://tracing or https://ui.perfetto.dev.
+     *
+     * @returns {string} The trace as a JSON string.
+     */
+    getTrace() {
+        return this._adapter.getTrace();
+    }
+
     /**
      * @summary Enable the BLE stack.
      *
@@ -562,7 +936,14 @@ class Adapter extends EventEmitter {
     _statusCallback(status) {
         switch (status.id) {
             case this._bleDriver.RESET_PERFORMED:
-                this._init();
+                if (this._reinitializing) {
+                    // The attribute table is restored by reinitialize()
+                    const { _services, _characteristics, _descriptors } = this;
+                    this._init();
+                    Object.assign(this, { _services, _characteristics, _descriptors });
+                } else {
+                    this._init();
+                }
                 this._changeState(
                     {
                         available: false,
@@ -587,28 +968,45 @@ class Adapter extends EventEmitter {
          *
          * @event Adapter#status
          * @type {Object}
-         * @property {string} status - Human-readable status message.
+         * @property {string} status - Human-readable status message. A periodic health report has the id
+         *                             <code>HEALTH_REPORT</code> and the report in its <code>health</code> member.
          */
         this.emit('status', status);
     }
 
-    _logCallback(severity, message) {
-        /**
-         * Log message event.
-         *
-         * @event Adapter#logMessage
-         * @type {Object}
-         * @property {string} severity - Severity of the log event.
-         * @property {string} message - Human-readable log message.
-         */
-        this.emit('logMessage', severity, message);
+    _logCallback(severities, messages, timestamps, droppedCount) {
+        for (let i = 0; i < messages.length; i += 1) {
+            /**
+             * Log message event.
+             *
+             * @event Adapter#logMessage
+             * @type {Object}
+             * @property {string} severity - Severity of the log event.
+             * @property {string} message - Human-readable log message.
+             * @property {number} timestamp - Time the driver logged the message, in milliseconds since the epoch.
+             */
+            this.emit('logMessage', severities[i], messages[i], timestamps[i]);
+        }
+
+        if (droppedCount > 0) {
+            this.emit('logMessage', logLevel.WARNING, `${droppedCount} driver log messages dropped, see setLogRateLimit.`, Date.now());
+        }
     }
 
-    _eventCallback(eventArray) {
+    _onListenerChange(event, added) {
+        if (event !== 'logMessage') return;
+
+        // newListener is emitted before the listener is added, removeListener after it is removed
+        this._adapter.setDebugLogListeners(this.listenerCount('logMessage') + added > 0);
+    }
+
+    _eventCallback(eventArray, debugLogConsumers) {
         eventArray.forEach(event => {
-            const text = new ToText(event);
-            // TODO: set the correct level for different types of events:
-            this.emit('logMessage', logLevel.DEBUG, text.toString());
+            if (debugLogConsumers) {
+                const text = new ToText(event);
+                // TODO: set the correct level for different types of events:
+                this.emit('logMessage', logLevel.DEBUG, text.toString());
+            }
 
             switch (event.id) {
                 case this._bleDriver.BLE_GAP_EVT_CONNECTED:
@@ -939,6 +1337,7 @@ class Adapter extends EventEmitter {
                 kdist_own: event.kdist_own,
                 kdist_peer: event.kdist_peer,
                 keyset: event.keyset,
+                bond_store_pending: event.bond_store_pending,
             }
         );
     }
@@ -990,6 +1389,19 @@ class Adapter extends EventEmitter {
     _parseLescDhkeyRequest(event) {
         const device = this._getDeviceByConnectionHandle(event.conn_handle);
 
+        if (event.auto_replied) {
+            /**
+             * An LE Secure Connections DHKey request was answered natively, see <code>setLescDhkeyAutoReply</code>.
+             *
+             * @event Adapter#lescDhkeyAutoReplied
+             * @type {Object}
+             * @property {Device} device - The <code>Device</code> instance representing the BLE peer we're connected to.
+             * @property {Object} event.pk_peer - LE Secure Connections remote P-256 Public Key.
+             */
+            this.emit('lescDhkeyAutoReplied', device, event.pk_peer);
+            return;
+        }
+
         /**
          * Request to calculate an LE Secure Connections DHKey.
          *
@@ -1006,6 +1418,19 @@ class Adapter extends EventEmitter {
     _parseSecInfoRequest(event) {
         const device = this._getDeviceByConnectionHandle(event.conn_handle);
 
+        if (event.auto_replied) {
+            /**
+             * Security information was replied from the bond store, see <code>setBondStore</code>.
+             *
+             * @event Adapter#secInfoAutoReplied
+             * @type {Object}
+             * @property {Device} device - The <code>Device</code> instance representing the BLE peer we're connected to.
+             * @property {Object} event - Security Information Request Event Parameters
+             */
+            this.emit('secInfoAutoReplied', device, event);
+            return;
+        }
+
         /**
          * Request to provide security information.
          *
@@ -1528,13 +1953,12 @@ class Adapter extends EventEmitter {
                 delete this._gattOperationsMap[device.instanceId];
                 gattOperation.callback(undefined, gattOperation.readBytes);
             } else if (event.data.length === this._maxReadPayloadSize(device.instanceId)) {
-                // We need to read more:
-                this._adapter.gattcRead(event.conn_handle, event.handle, gattOperation.readBytes.length, err => {
-                    if (err) {
-                        delete this._gattOperationsMap[device.instanceId];
-                        this.emit('error', _makeError('Read value failed', err));
-                        gattOperation.callback('Failed reading at byte #' + gattOperation.readBytes.length);
-                    }
+                // We need to read more. The native promise is settled from the command completion
+                // directly, only the failure needs handling here.
+                this._adapter.gattcRead(event.conn_handle, event.handle, gattOperation.readBytes.length).catch(err => {
+                    delete this._gattOperationsMap[device.instanceId];
+                    this.emit('error', _makeError('Read value failed', err));
+                    gattOperation.callback('Failed reading at byte #' + gattOperation.readBytes.length);
                 });
             } else {
                 delete this._gattOperationsMap[device.instanceId];
@@ -1587,26 +2011,17 @@ class Adapter extends EventEmitter {
                 writeParameters.value = value;
                 gattOperation.bytesWritten += value.length;
 
-                this._adapter.gattcWrite(device.connectionHandle, writeParameters, err => {
-
-                    if (err) {
-                        console.log('some error');
-                        this._longWriteCancel(device, gattOperation.attribute);
-                        this.emit('error', _makeError('Failed to write value to device/handle ' + device.instanceId + '/' + handle, err));
-                        return;
-                    }
+                this._adapter.gattcWrite(device.connectionHandle, writeParameters).catch(err => {
+                    this._longWriteCancel(device, gattOperation.attribute);
+                    this.emit('error', _makeError('Failed to write value to device/handle ' + device.instanceId + '/' + handle, err));
                 });
             } else {
                 writeParameters.write_op = this._bleDriver.BLE_GATT_OP_EXEC_WRITE_REQ;
                 writeParameters.flags = this._bleDriver.BLE_GATT_EXEC_WRITE_FLAG_PREPARED_WRITE;
 
-                this._adapter.gattcWrite(device.connectionHandle, writeParameters, err => {
-
-                    if (err) {
-                        this._longWriteCancel(device, gattOperation.attribute);
-                        this.emit('error', _makeError('Failed to write value to device/handle ' + device.instanceId + '/' + handle, err));
-                        return;
-                    }
+                this._adapter.gattcWrite(device.connectionHandle, writeParameters).catch(err => {
+                    this._longWriteCancel(device, gattOperation.attribute);
+                    this.emit('error', _makeError('Failed to write value to device/handle ' + device.instanceId + '/' + handle, err));
                 });
             }
 
@@ -2001,6 +2416,28 @@ class Adapter extends EventEmitter {
         attribute.value = attribute.value.slice(0, offset).concat(value);
     }
 
+    _gapGetDeviceName(callback) {
+        const name = this._adapter.gapGetDeviceNameSync();
+
+        if (name !== undefined) {
+            process.nextTick(() => callback(name));
+            return;
+        }
+
+        this._adapter.gapGetDeviceName(callback);
+    }
+
+    _gapGetAddress(callback) {
+        const address = this._adapter.gapGetAddressSync();
+
+        if (address !== undefined) {
+            process.nextTick(() => callback(address));
+            return;
+        }
+
+        this._adapter.gapGetAddress(callback);
+    }
+
     /**
      * Gets and updates this adapter's state.
      *
@@ -2020,7 +2457,7 @@ class Adapter extends EventEmitter {
 
             changedStates.firmwareVersion = version;
 
-            this._adapter.gapGetDeviceName((name, err) => {
+            this._gapGetDeviceName((name, err) => {
                 if (this._checkAndPropagateError(
                     err,
                     'Failed to retrieve driver version.',
@@ -2028,7 +2465,7 @@ class Adapter extends EventEmitter {
 
                 changedStates.name = name;
 
-                this._adapter.gapGetAddress((address, err) => {
+                this._gapGetAddress((address, err) => {
                     if (this._checkAndPropagateError(
                         err,
                         'Failed to retrieve device address.',
@@ -2971,6 +3408,13 @@ class Adapter extends EventEmitter {
         let decodeUUID = (uuid, data) => {
             return new Promise((resolve, reject) => {
                 const length = uuid.length === 32 ? 16 : 2;
+                const decodedUUID = this._adapter.decodeUUIDSync(length, uuid);
+
+                if (decodedUUID !== undefined) {
+                    data.decoded_uuid = decodedUUID;
+                    resolve(data);
+                    return;
+                }
 
                 this._adapter.decodeUUID(length, uuid, (err, _uuid) => {
                     if (err) {
@@ -122,8 +122,13 @@ class AdapterFactory extends EventEmitter {
         this._bleDrivers = bleDrivers;
         this._adapters = {};
 
-        // TODO: should adapters be updated on this.getAdapters call or on an interval? Time interval for now.
-        this.updateInterval = setInterval(this._updateAdapterList.bind(this), UPDATE_INTERVAL_MS);
+        // Adapters plugged in or out are reported by the driver where the platform supports it, polled otherwise
+        try {
+            this._bleDrivers.v2.watchAdapters(this._onAdapterHotplug.bind(this));
+            this._updateAdapterList();
+        } catch (error) {
+            this.updateInterval = setInterval(this._updateAdapterList.bind(this), UPDATE_INTERVAL_MS);
+        }
     }
 
     /**
@@ -218,6 +223,30 @@ class AdapterFactory extends EventEmitter {
         });
     }
 
+    _onAdapterHotplug(action, adapter) {
+        const adapterInstanceId = this._getInstanceId(adapter);
+
+        if (action === 'added') {
+            if (this._adapters[adapterInstanceId] !== undefined) return;
+
+            try {
+                const newAdapter = this._parseAndCreateAdapter(adapter);
+                this._adapters[adapterInstanceId] = newAdapter;
+                this._setUpListenersForAdapterOpenAndClose(newAdapter);
+                this.emit('added', newAdapter);
+            } catch (error) {
+                this.emit('logMessage', logLevel.DEBUG, `Unable to create adapter: ${error.message}`);
+            }
+        } else if (action === 'removed') {
+            const removedAdapter = this._adapters[adapterInstanceId];
+            if (removedAdapter === undefined) return;
+
+            removedAdapter.removeAllListeners('opened');
+            delete this._adapters[adapterInstanceId];
+            this.emit('removed', removedAdapter);
+        }
+    }
+
     // TODO: create a separate npm module that gets connected adapters and information about them
     _updateAdapterList(callback) {
         // for getting the adapters we just use pc-ble-driver AddOn v2
@@ -291,6 +320,47 @@ class AdapterFactory extends EventEmitter {
             }
         });
     }
+
+    /**
+     * Open several adapters at the same time.
+     *
+     * Every adapter is opened on its own command thread, so the time to open all of them is close to the
+     * time to open the slowest one. A failure to open one adapter does not affect the others.
+     *
+     * @param {Adapter[]} adapters The adapters to open.
+     * @param {Object|function(Adapter): Object} options Options passed to <code>Adapter.open</code>, or a
+     *                                                   function returning the options of each adapter.
+     * @param {function(Object[])} callback Called when every adapter is opened or has failed.
+     *                                      Callback signature: results => {}, where results[i] is
+     *                                      <code>{ adapter, error }</code> for adapters[i].
+     * @returns {void}
+     */
+    openMany(adapters, options, callback) {
+        const results = new Array(adapters.length);
+        let remaining = adapters.length;
+
+        if (remaining === 0) {
+            callback(results);
+            return;
+        }
+
+        adapters.forEach((adapter, index) => {
+            // Adapter.open fills in the defaults of the options object, each adapter gets its own copy
+            const adapterOptions = typeof options === 'function' ? options(adapter) : Object.assign({}, options);
+
+            adapter.open(adapterOptions, error => {
+                // Only the first outcome of an adapter counts, open may report a later state error too
+                if (results[index] !== undefined) return;
+
+                results[index] = { adapter, error };
+                remaining -= 1;
+
+                if (remaining === 0) {
+                    callback(results);
+                }
+            });
+        });
+    }
 }
 
 module.exports = AdapterFactory;
@@ -0,0 +1,219 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+'use strict';
+
+const EventEmitter = require('events');
+
+/** Adapter events forwarded by the pool, tagged with the adapter they came from. */
+const FORWARDED_EVENTS = [
+    'deviceDiscovered',
+    'deviceConnected',
+    'deviceDisconnected',
+    'connectTimedOut',
+    'connParamUpdate',
+    'securityChanged',
+    'characteristicValueChanged',
+    'descriptorValueChanged',
+    'deviceNotifiedOrIndicated',
+    'stateChanged',
+    'error',
+    'warning',
+];
+
+/**
+ * Adapter pool event. Fired for every forwarded event of an adapter in the pool.
+ *
+ * @event AdapterPool#event
+ * @param {Object} event <code>{ adapterId, adapter, name, args }</code>, where <code>name</code> and
+ *                       <code>args</code> are the name and arguments of the adapter event.
+ */
+
+/**
+ * Spreads connections over several open adapters.
+ *
+ * Each adapter keeps track of its own connections, connection attempts and the signal strength of the
+ * peers it hears advertising. When connecting to a peer, the pool picks the least loaded of the adapters
+ * that have heard the peer recently, preferring the strongest signal, and falls back to the least loaded
+ * adapter when none have. The events of all adapters are also available as a single stream.
+ *
+ * All adapters in a pool must use the same pc-ble-driver API version.
+ */
+class AdapterPool extends EventEmitter {
+    /**
+     * @constructor
+     * @param {Object} [options] Pool options:
+     *                           <ul>
+     *                           <li>{number} peerMaxAge: Time in milliseconds an advertising report counts as
+     *                                                    recent when choosing an adapter. Default 10000.
+     *                           </ul>
+     */
+    constructor(options) {
+        super();
+
+        this._peerMaxAge = (options && options.peerMaxAge !== undefined) ? options.peerMaxAge : 10000;
+        this._pool = null;
+        this._driver = null;
+        this._adapters = {};
+        this._listeners = {};
+    }
+
+    /**
+     * Get the adapters in the pool.
+     * @returns {Adapter[]} The adapters in the pool.
+     */
+    get adapters() {
+        return Object.keys(this._adapters).map(id => this._adapters[id]);
+    }
+
+    /**
+     * Add an adapter to the pool.
+     *
+     * @param {Adapter} adapter The adapter to add.
+     * @returns {number} Id of the adapter in the pool.
+     */
+    add(adapter) {
+        if (this._driver === null) {
+            this._driver = adapter.driver;
+            this._pool = new this._driver.AdapterPool();
+        } else if (this._driver !== adapter.driver) {
+            throw new Error('All adapters in a pool must use the same pc-ble-driver API version.');
+        }
+
+        const adapterId = this._pool.add(adapter._adapter);
+
+        if (this._adapters[adapterId] !== undefined) {
+            return adapterId;
+        }
+
+        this._adapters[adapterId] = adapter;
+        this._listeners[adapterId] = FORWARDED_EVENTS.map(name => {
+            const listener = (...args) => {
+                this.emit('event', { adapterId, adapter, name, args });
+            };
+
+            adapter.on(name, listener);
+            return { name, listener };
+        });
+
+        return adapterId;
+    }
+
+    /**
+     * Remove an adapter from the pool.
+     *
+     * @param {Adapter} adapter The adapter to remove.
+     * @returns {boolean} True if the adapter was in the pool.
+     */
+    remove(adapter) {
+        const adapterId = Object.keys(this._adapters).find(id => this._adapters[id] === adapter);
+
+        if (adapterId === undefined) {
+            return false;
+        }
+
+        this._listeners[adapterId].forEach(entry => adapter.removeListener(entry.name, entry.listener));
+        delete this._listeners[adapterId];
+        delete this._adapters[adapterId];
+
+        return this._pool.remove(Number(adapterId));
+    }
+
+    /**
+     * Choose the adapter that should connect to a peer.
+     *
+     * @param {string|Object} deviceAddress Address string of the peer, or an address object with an <code>address</code>
+     *                                       and an optional <code>type</code> property. Without a type, an advertising
+     *                                       report from the address with any type counts.
+     * @returns {Adapter|undefined} The chosen adapter, or undefined if the pool is empty.
+     */
+    select(deviceAddress) {
+        if (this._pool === null) {
+            return undefined;
+        }
+
+        const address = (typeof deviceAddress === 'string') ? deviceAddress : deviceAddress.address;
+        const type = (typeof deviceAddress === 'string') ? undefined : deviceAddress.type;
+        const adapterId = this._pool.select(address, this._peerMaxAge, type);
+
+        return adapterId === undefined ? undefined : this._adapters[adapterId];
+    }
+
+    /**
+     * Connect to a peer through the adapter chosen by <code>select</code>.
+     *
+     * @param {string|Object} deviceAddress Address of the peer, as for <code>Adapter.connect</code>.
+     * @param {Object} options Connection options, as for <code>Adapter.connect</code>.
+     * @param {function(Error, Device, Adapter)} [callback] Callback signature: (err, device, adapter) => {}.
+     * @returns {Adapter|undefined} The adapter that connects, or undefined if the pool is empty.
+     */
+    connect(deviceAddress, options, callback) {
+        const adapter = this.select(deviceAddress);
+
+        if (adapter === undefined) {
+            if (callback) { callback(new Error('Could not connect. The adapter pool is empty.')); }
+            return undefined;
+        }
+
+        adapter.connect(deviceAddress, options, (error, device) => {
+            if (callback) { callback(error, device, adapter); }
+        });
+
+        return adapter;
+    }
+
+    /**
+     * Get the load of every adapter in the pool.
+     *
+     * @returns {Object[]} <code>{ adapterId, adapter, connectionCount, pendingConnectCount, connectionRssi }</code> for each adapter.
+     */
+    getLoad() {
+        if (this._pool === null) {
+            return [];
+        }
+
+        return this._pool.getLoad().map(load => ({
+            adapterId: load.id,
+            adapter: this._adapters[load.id],
+            connectionCount: load.connectionCount,
+            pendingConnectCount: load.pendingConnectCount,
+            connectionRssi: load.connectionRssi,
+        }));
+    }
+}
+
+module.exports = AdapterPool;
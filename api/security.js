@@ -80,6 +80,60 @@ class Security {
     generateSharedSecret(privateKey, publicKey) {
         return this._bleDriver.eccComputeSharedSecret(privateKey, publicKey);
     }
+
+    /**
+     * Keep key pairs generated ahead of time on a low priority thread, so that taking one is instant.
+     * The pool is shared by all adapters.
+     *
+     * @param {number} size Number of key pairs to keep, at most `1024`, or `0` to generate them when needed.
+     * @returns {void}
+     * @throws {RangeError} If the size is larger than `1024`.
+     */
+    setKeyPairPoolSize(size) {
+        this._bleDriver.eccSetKeypairPoolSize(size);
+    }
+
+    /**
+     * @returns {Object} The <code>size</code> of the key pair pool, the key pairs <code>available</code>,
+     *                   and the number of key pairs taken from the pool (<code>hitCount</code>) or generated
+     *                   because it was empty (<code>missCount</code>).
+     */
+    getKeyPairPoolStats() {
+        return this._bleDriver.eccGetKeypairPoolStats();
+    }
+
+    /**
+     * Generates a public/private key pair on a worker thread.
+     *
+     * @param {function(Error, Object)} [callback] Signature: (err, keyPair) => {}. If omitted a promise is returned.
+     * @returns {Promise|undefined} The promise of the key pair if no callback is given.
+     */
+    generateKeyPairAsync(callback) {
+        return this._bleDriver.eccGenerateKeypairAsync(callback);
+    }
+
+    /**
+     * Generates a public key on a worker thread.
+     *
+     * @param {Array} privateKey The private key that should be used to generate the public key.
+     * @param {function(Error, Object)} [callback] Signature: (err, { pk }) => {}. If omitted a promise is returned.
+     * @returns {Promise|undefined} The promise of the public key if no callback is given.
+     */
+    generatePublicKeyAsync(privateKey, callback) {
+        return this._bleDriver.eccComputePublicKeyAsync(privateKey, callback);
+    }
+
+    /**
+     * Generates a shared secret on a worker thread.
+     *
+     * @param {Array} privateKey The private key that should be used to generate the shared secret.
+     * @param {Array} publicKey The public key that should be used to generate the shared secret.
+     * @param {function(Error, Object)} [callback] Signature: (err, { ss }) => {}. If omitted a promise is returned.
+     * @returns {Promise|undefined} The promise of the shared secret if no callback is given.
+     */
+    generateSharedSecretAsync(privateKey, publicKey, callback) {
+        return this._bleDriver.eccComputeSharedSecretAsync(privateKey, publicKey, callback);
+    }
 }
 
 module.exports = Security;
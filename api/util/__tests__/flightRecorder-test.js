@@ -0,0 +1,99 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+'use strict';
+
+const FlightRecorder = require('../flightRecorder');
+
+function record(type, flags, code, value, micros, payload) {
+    const header = Buffer.alloc(20);
+    header.writeUInt16LE(20 + payload.length, 0);
+    header.writeUInt8(type, 2);
+    header.writeUInt8(flags, 3);
+    header.writeUInt32LE(code, 4);
+    header.writeUInt32LE(value, 8);
+    header.writeUInt32LE(micros, 12);
+    header.writeUInt32LE(0, 16);
+    return Buffer.concat([header, payload]);
+}
+
+function dump(records, overwrittenCount, epoch) {
+    const body = Buffer.concat(records);
+    const header = Buffer.alloc(24);
+    header.write('BLEFLT01', 0, 'ascii');
+    header.writeUInt32LE(body.length, 8);
+    header.writeUInt32LE(overwrittenCount, 12);
+    header.writeDoubleLE(epoch, 16);
+    return Buffer.concat([header, body]);
+}
+
+describe('decode', () => {
+    it('should reject a buffer without the magic', () => {
+        expect(() => FlightRecorder.decode(Buffer.alloc(24))).toThrow();
+    });
+
+    it('should decode the header of an empty dump', () => {
+        const result = FlightRecorder.decode(dump([], 7, 1000));
+        expect(result.epoch).toEqual(1000);
+        expect(result.overwrittenCount).toEqual(7);
+        expect(result.records).toEqual([]);
+    });
+
+    it('should decode commands, logs and events in order', () => {
+        const result = FlightRecorder.decode(dump([
+            record(2, 0, 1, 0, 1000, Buffer.from('GapStartScan')),
+            record(4, 2, 0, 0, 2000, Buffer.from('hello')),
+            record(1, 0, 0x13, 0, 2500, Buffer.from([1, 2, 3])),
+            record(3, 2, 1, 13, 3000, Buffer.from('GapStartScan')),
+        ], 0, 1000));
+
+        expect(result.records.length).toEqual(4);
+        expect(result.records[0]).toEqual({ type: 'commandIssued', time: 1001, commandId: 1, name: 'GapStartScan' });
+        expect(result.records[1]).toEqual({ type: 'log', time: 1002, severity: 2, message: 'hello' });
+        expect(result.records[2].eventId).toEqual(0x13);
+        expect(Array.from(result.records[2].data)).toEqual([1, 2, 3]);
+        expect(result.records[3]).toEqual({
+            type: 'commandCompleted', time: 1003, commandId: 1, name: 'GapStartScan', result: 13, abortReason: 'timeoutQueued',
+        });
+    });
+
+    it('should stop at a truncated record', () => {
+        const full = dump([record(4, 2, 0, 0, 0, Buffer.from('hello'))], 0, 0);
+        const result = FlightRecorder.decode(full.slice(0, full.length - 2));
+        expect(result.records).toEqual([]);
+    });
+});
@@ -0,0 +1,134 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+'use strict';
+
+/**
+ * Decoder of the flight recorder dumps written by <code>Adapter.dumpFlightRecorder</code>.
+ * See src/flight_recorder.h for the binary format.
+ */
+
+const MAGIC = 'BLEFLT01';
+const FILE_HEADER_LENGTH = 24;
+const RECORD_HEADER_LENGTH = 20;
+
+const RECORD_TYPES = {
+    1: 'event',
+    2: 'commandIssued',
+    3: 'commandCompleted',
+    4: 'log',
+    5: 'status',
+};
+
+const ABORT_REASONS = ['', 'cancelled', 'timeoutQueued', 'timeoutInFlight'];
+
+function decodeRecord(buffer, offset, epoch) {
+    const length = buffer.readUInt16LE(offset);
+    const type = RECORD_TYPES[buffer.readUInt8(offset + 2)] || 'unknown';
+    const flags = buffer.readUInt8(offset + 3);
+    const code = buffer.readUInt32LE(offset + 4);
+    const value = buffer.readUInt32LE(offset + 8);
+    const micros = (buffer.readUInt32LE(offset + 16) * 0x100000000) + buffer.readUInt32LE(offset + 12);
+    const payload = buffer.slice(offset + RECORD_HEADER_LENGTH, offset + length);
+
+    const record = { type, time: epoch + (micros / 1000) };
+
+    switch (type) {
+        case 'event':
+            record.eventId = code;
+            record.data = payload;
+            break;
+        case 'commandIssued':
+            record.commandId = code;
+            record.name = payload.toString();
+            break;
+        case 'commandCompleted':
+            record.commandId = code;
+            record.name = payload.toString();
+            record.result = value;
+            if (flags !== 0) record.abortReason = ABORT_REASONS[flags] || flags;
+            break;
+        case 'log':
+            record.severity = flags;
+            record.message = payload.toString();
+            break;
+        case 'status':
+            record.statusId = code;
+            record.message = payload.toString();
+            break;
+        default:
+            record.data = payload;
+            break;
+    }
+
+    return { record, length };
+}
+
+/**
+ * Decode a flight recorder dump.
+ *
+ * @param {Buffer} buffer Content of a dump file.
+ * @returns {Object} <code>{ epoch, overwrittenCount, records }</code>, where <code>records</code> are in the order they
+ *                   were recorded and each has a <code>type</code> and a <code>time</code> in milliseconds since the epoch.
+ */
+function decode(buffer) {
+    if (buffer.length < FILE_HEADER_LENGTH || buffer.toString('ascii', 0, 8) !== MAGIC) {
+        throw new Error('Not a flight recorder dump.');
+    }
+
+    const recordsLength = buffer.readUInt32LE(8);
+    const overwrittenCount = buffer.readUInt32LE(12);
+    const epoch = buffer.readDoubleLE(16);
+    const end = Math.min(buffer.length, FILE_HEADER_LENGTH + recordsLength);
+    const records = [];
+
+    let offset = FILE_HEADER_LENGTH;
+
+    while (offset + RECORD_HEADER_LENGTH <= end) {
+        const decoded = decodeRecord(buffer, offset, epoch);
+        if (decoded.length < RECORD_HEADER_LENGTH || offset + decoded.length > end) break;
+
+        records.push(decoded.record);
+        offset += decoded.length;
+    }
+
+    return { epoch, overwrittenCount, records };
+}
+
+module.exports = {
+    decode,
+};
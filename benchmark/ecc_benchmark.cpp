@@ -0,0 +1,107 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Measures the P-256 operations of the addon with the micro-ecc settings the benchmark was built with.
+// Build the ecc_benchmark (host settings) and ecc_benchmark_portable (micro-ecc defaults) targets
+// with -DECC_BENCHMARK=ON and compare their output.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "ecc_p256.h"
+
+template<typename Operation>
+static double measure(const char *name, const int count, Operation operation)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto i = 0; i < count; ++i)
+    {
+        if (!operation())
+        {
+            std::cerr << name << " failed." << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto opsPerSecond = count / seconds;
+
+    std::cout << name << ": " << opsPerSecond << " ops/sec (" << count << " in " << seconds << " s)" << std::endl;
+
+    return opsPerSecond;
+}
+
+int main(int argc, char *argv[])
+{
+    auto count = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    if (count <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [operations per measurement]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    uint8_t sk[ECC_P256_SK_LEN];
+    uint8_t pk[ECC_P256_PK_LEN];
+    uint8_t peerSk[ECC_P256_SK_LEN];
+    uint8_t peerPk[ECC_P256_PK_LEN];
+    uint8_t ss[ECC_P256_SK_LEN];
+    uint8_t peerSs[ECC_P256_SK_LEN];
+
+    // The pool is empty, every key pair is generated by the caller
+    measure("keygen", count, [&]() { return eccP256GenerateKeypair(sk, pk); });
+    measure("public key", count, [&]() { return eccP256ComputePublicKey(sk, pk); });
+
+    if (!eccP256GenerateKeypair(peerSk, peerPk))
+    {
+        std::cerr << "keygen failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    measure("ecdh", count, [&]() { return eccP256ComputeSharedSecret(sk, peerPk, ss); });
+
+    if (!eccP256ComputeSharedSecret(peerSk, pk, peerSs) || memcmp(ss, peerSs, sizeof(ss)) != 0)
+    {
+        std::cerr << "ecdh does not agree with the peer." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -36,6 +36,7 @@
 
 const Adapter = require('./api/adapter');
 const AdapterFactory = require('./api/adapterFactory');
+const AdapterPool = require('./api/adapterPool');
 const AdapterState = require('./api/adapterState');
 const Characteristic = require('./api/characteristic');
 const Descriptor = require('./api/descriptor');
@@ -49,6 +50,7 @@ const ServiceFactory = require('./api/serviceFactory');
 module.exports = {
     Adapter,
     AdapterFactory,
+    AdapterPool,
     AdapterState,
     Characteristic,
     Descriptor,
@@ -35,14 +35,30 @@
  */
 
 #include "adapter.h"
+#include "adapter_registry.h"
 #include "common.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 
-Nan::Persistent<v8::Function> Adapter::constructor;
+// The addon may be loaded by several worker threads, each with its own isolate and event loop.
+// The Adapter constructor is therefore kept per isolate.
+std::map<v8::Isolate *, Nan::Persistent<v8::Function> *> Adapter::constructors;
+std::mutex Adapter::constructorsMutex;
 
-std::vector<Adapter *> adapters;
+// Adapters of all isolates by driver adapter, looked up from the driver threads
+AdapterRegistry adapterRegistry;
+
+#if NODE_MODULE_VERSION >= 64
+static void removeConstructor(void *arg)
+{
+    auto isolate = static_cast<v8::Isolate *>(arg);
+    Adapter::removeConstructor(isolate);
+}
+#endif
 
 NAN_MODULE_INIT(Adapter::Init)
 {
@@ -55,31 +71,52 @@ NAN_MODULE_INIT(Adapter::Init)
     initGattC(tpl);
     initGattS(tpl);
 
-    constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
+    auto isolate = v8::Isolate::GetCurrent();
+    auto constructor = new Nan::Persistent<v8::Function>(Nan::GetFunction(tpl).ToLocalChecked());
+
+    {
+        std::lock_guard<std::mutex> lock(constructorsMutex);
+        constructors[isolate] = constructor;
+    }
+
+#if NODE_MODULE_VERSION >= 64
+    node::AddEnvironmentCleanupHook(isolate, ::removeConstructor, isolate);
+#endif
+
     Nan::Set(target, Nan::New("Adapter").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
 }
 
-Adapter *Adapter::getAdapter(adapter_t *adapter, Adapter *defaultAdapter)
+void Adapter::removeConstructor(v8::Isolate *isolate)
 {
-    if (adapter == nullptr)
+    std::lock_guard<std::mutex> lock(constructorsMutex);
+    auto constructor = constructors.find(isolate);
+
+    if (constructor != constructors.end())
     {
-        return defaultAdapter;
+        constructor->second->Reset();
+        delete constructor->second;
+        constructors.erase(constructor);
     }
+}
 
-    for (auto value : adapters)
+Adapter *Adapter::getAdapter(adapter_t *adapter)
+{
+    if (adapter == nullptr)
     {
-        auto deviceAdapter = value->getInternalAdapter();
+        return nullptr;
+    }
 
-        if (deviceAdapter != nullptr)
-        {
-            if (value->getInternalAdapter()->internal == adapter->internal)
-            {
-                return value;
-            }
-        }
+    return adapterRegistry.find(adapter->internal);
+}
+
+AdapterRegistry::Lease Adapter::acquireAdapter(adapter_t *adapter)
+{
+    if (adapter == nullptr)
+    {
+        return AdapterRegistry::Lease();
     }
 
-    return defaultAdapter;
+    return adapterRegistry.acquire(adapter->internal);
 }
 
 adapter_t *Adapter::getInternalAdapter() const
@@ -87,14 +124,33 @@ adapter_t *Adapter::getInternalAdapter() const
     return adapter;
 }
 
+// Must be called before the driver can call back with the new adapter
+bool Adapter::setInternalAdapter(adapter_t *internalAdapter)
+{
+    if (adapter != nullptr)
+    {
+        adapterRegistry.remove(adapter->internal);
+    }
+
+    adapter = internalAdapter;
+
+    if (adapter != nullptr && !adapterRegistry.add(adapter->internal, this))
+    {
+        adapter = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
 extern "C" {
-    void event_handler(uv_async_t *handle)
+    void notification_handler(uv_async_t *handle)
     {
         auto adapter = static_cast<Adapter *>(handle->data);
 
         if (adapter != nullptr)
         {
-            adapter->onRpcEvent(handle);
+            adapter->onNotification(handle);
         }
         else
         {
@@ -117,22 +173,37 @@ extern "C" {
             std::terminate();
         }
     }
+
+    void health_report_handler(uv_timer_t *handle)
+    {
+        auto adapter = static_cast<Adapter *>(handle->data);
+
+        if (adapter != nullptr)
+        {
+            adapter->onHealthReportTimer(handle);
+        }
+    }
+}
+
+void Adapter::initNotificationHandling()
+{
+    asyncNotification = new uv_async_t();
+    notificationQueue.open();
+    asyncNotification->data = static_cast<void *>(this);
+
+    if (uv_async_init(loop, asyncNotification, notification_handler) != 0)
+    {
+        std::cerr << "Not able to create a new async notification handler." << std::endl;
+        std::terminate();
+    }
 }
 
 void Adapter::initEventHandling(Nan::Callback *callback, uint32_t interval)
 {
     eventInterval = interval;
-    asyncEvent = new uv_async_t();
 
     // Setup event related functionality
     eventCallback = callback;
-    asyncEvent->data = static_cast<void *>(this);
-
-    if (uv_async_init(uv_default_loop(), asyncEvent, event_handler) != 0)
-    {
-        std::cerr << "Not able to create a new async event handler." << std::endl;
-        std::terminate();
-    }
 
     // Clear the statistics
     eventCallbackCount = 0;
@@ -156,7 +227,7 @@ void Adapter::initEventHandling(Nan::Callback *callback, uint32_t interval)
     // Setup event interval functionality
     eventIntervalTimer->data = static_cast<void *>(this);
 
-    if (uv_timer_init(uv_default_loop(), eventIntervalTimer) != 0)
+    if (uv_timer_init(loop, eventIntervalTimer) != 0)
     {
         std::cerr << "Not able to create a new async event interval timer." << std::endl;
         std::terminate();
@@ -169,80 +240,71 @@ void Adapter::initEventHandling(Nan::Callback *callback, uint32_t interval)
     }
 }
 
-extern "C" {
-    void log_handler(uv_async_t *handle)
+void Adapter::setHealthReportInterval(const uint32_t interval)
+{
+    if (healthReportTimer == nullptr)
     {
-        auto adapter = static_cast<Adapter *>(handle->data);
-
-        if (adapter != nullptr)
+        if (interval == 0)
         {
-            adapter->onLogEvent(handle);
+            return;
         }
-        else
+
+        healthReportTimer = new uv_timer_t();
+        healthReportTimer->data = static_cast<void *>(this);
+
+        if (uv_timer_init(loop, healthReportTimer) != 0)
         {
-            std::cerr << "No AddOn adapter to process log event." << std::endl;
+            std::cerr << "Not able to create a new health report timer." << std::endl;
             std::terminate();
         }
     }
-}
 
-void Adapter::initLogHandling(Nan::Callback *callback)
-{
-    // Setup event related functionality
-    asyncLog = new uv_async_t();
-    logCallback = callback;
-    asyncLog->data = static_cast<void *>(this);
+    if (interval == 0)
+    {
+        uv_timer_stop(healthReportTimer);
+        return;
+    }
 
-    if (uv_async_init(uv_default_loop(), asyncLog, log_handler) != 0)
+    if (uv_timer_start(healthReportTimer, health_report_handler, interval, interval) != 0)
     {
-        std::cerr << "Not able to create a new event log handler." << std::endl;
+        std::cerr << "Not able to start the health report timer." << std::endl;
         std::terminate();
     }
 }
 
-extern "C" {
-    void status_handler(uv_async_t *handle)
-    {
-        auto adapter = static_cast<Adapter *>(handle->data);
-
-        if (adapter != nullptr)
-        {
-            adapter->onStatusEvent(handle);
-        }
-        else
-        {
-            std::cerr << "No AddOn adapter to process status event." << std::endl;
-            std::terminate();
-        }
-    }
+void Adapter::initLogHandling(Nan::Callback *callback)
+{
+    logCallback = callback;
+    logBuffer.open();
 }
 
 void Adapter::initStatusHandling(Nan::Callback *callback)
 {
-    // Setup event related functionality
-    asyncStatus = new uv_async_t();
     statusCallback = callback;
-    asyncStatus->data = static_cast<void *>(this);
-
-    if (uv_async_init(uv_default_loop(), asyncStatus, status_handler) != 0)
-    {
-        std::cerr << "Not able to create a new status handler." << std::endl;
-        std::terminate();
-    }
 }
 
 void Adapter::cleanUpV8Resources()
 {
     uv_mutex_lock(adapterCloseMutex);
 
-    if (asyncStatus != nullptr)
-    {
-        auto handle = reinterpret_cast<uv_handle_t *>(asyncStatus);
-        uv_close(handle, [](uv_handle_t *handle) {
-            free(handle);
-        });
+    // Release driver threads waiting for room in the queues and discard what is left
+    lescResponder.stop();
+    notificationQueue.close();
+    logBuffer.close();
 
-        asyncStatus = nullptr;
+    Notification notification;
+
+    while (notificationQueue.pop(notification))
+    {
+        if (notification.kind == NOTIFICATION_EVENT)
+        {
+            free(notification.event->event);
+            delete notification.event;
+        }
+        else if (notification.kind == NOTIFICATION_STATUS)
+        {
+            delete notification.status;
+        }
     }
 
     if (eventIntervalTimer != nullptr)
@@ -256,33 +318,35 @@ void Adapter::cleanUpV8Resources()
         auto handle = reinterpret_cast<uv_handle_t *>(eventIntervalTimer);
         uv_close(handle, [](uv_handle_t *handle)
         {
-            free(handle);
+            delete reinterpret_cast<uv_timer_t *>(handle);
         });
 
         eventIntervalTimer = nullptr;
     }
 
-    if (asyncEvent != nullptr)
+    if (healthReportTimer != nullptr)
     {
-        auto handle = reinterpret_cast<uv_handle_t *>(asyncEvent);
+        uv_timer_stop(healthReportTimer);
 
+        auto handle = reinterpret_cast<uv_handle_t *>(healthReportTimer);
         uv_close(handle, [](uv_handle_t *handle)
         {
-            free(handle);
+            delete reinterpret_cast<uv_timer_t *>(handle);
         });
 
-        asyncEvent = nullptr;
+        healthReportTimer = nullptr;
     }
 
-    if (asyncLog != nullptr)
+    if (asyncNotification != nullptr)
     {
-        auto logHandle = reinterpret_cast<uv_handle_t *>(asyncLog);
-        uv_close(logHandle, [](uv_handle_t *handle)
+        auto handle = reinterpret_cast<uv_handle_t *>(asyncNotification);
+
+        uv_close(handle, [](uv_handle_t *handle)
         {
-            free(handle);
+            delete reinterpret_cast<uv_async_t *>(handle);
         });
 
-        asyncLog = nullptr;
+        asyncNotification = nullptr;
     }
 
     uv_mutex_unlock(adapterCloseMutex);
@@ -293,6 +357,7 @@ void Adapter::initGeneric(v8::Local<v8::FunctionTemplate> tpl)
     Nan::SetPrototypeMethod(tpl, "open", Open);
     Nan::SetPrototypeMethod(tpl, "close", Close);
     Nan::SetPrototypeMethod(tpl, "connReset", ConnReset);
+    Nan::SetPrototypeMethod(tpl, "reinitialize", Reinitialize);
     Nan::SetPrototypeMethod(tpl, "getVersion", GetVersion);
     Nan::SetPrototypeMethod(tpl, "enableBLE", EnableBLE);
     Nan::SetPrototypeMethod(tpl, "addVendorspecificUUID", AddVendorSpecificUUID);
@@ -303,17 +368,37 @@ void Adapter::initGeneric(v8::Local<v8::FunctionTemplate> tpl)
     Nan::SetPrototypeMethod(tpl, "getBleOption", GetBleOption);
 
     Nan::SetPrototypeMethod(tpl, "getStats", GetStats);
+    Nan::SetPrototypeMethod(tpl, "setCompletionCallback", SetCompletionCallback);
+    Nan::SetPrototypeMethod(tpl, "setDefaultCommandTimeout", SetDefaultCommandTimeout);
+    Nan::SetPrototypeMethod(tpl, "setCommandTimeout", SetCommandTimeout);
+    Nan::SetPrototypeMethod(tpl, "getLastCommandId", GetLastCommandId);
+    Nan::SetPrototypeMethod(tpl, "cancelCommand", CancelCommand);
+    Nan::SetPrototypeMethod(tpl, "setTracing", SetTracing);
+    Nan::SetPrototypeMethod(tpl, "setLogRateLimit", SetLogRateLimit);
+    Nan::SetPrototypeMethod(tpl, "setDebugLogListeners", SetDebugLogListeners);
+    Nan::SetPrototypeMethod(tpl, "getHealthReport", GetHealthReport);
+    Nan::SetPrototypeMethod(tpl, "setLescPrivateKey", SetLescPrivateKey);
+    Nan::SetPrototypeMethod(tpl, "setBondStore", SetBondStore);
+    Nan::SetPrototypeMethod(tpl, "getBonds", GetBonds);
+    Nan::SetPrototypeMethod(tpl, "deleteBond", DeleteBond);
+    Nan::SetPrototypeMethod(tpl, "setHealthReportInterval", SetHealthReportInterval);
+    Nan::SetPrototypeMethod(tpl, "dumpFlightRecorder", DumpFlightRecorder);
+    Nan::SetPrototypeMethod(tpl, "getTrace", GetTrace);
+    Nan::SetPrototypeMethod(tpl, "encodeUUIDSync", EncodeUUIDSync);
+    Nan::SetPrototypeMethod(tpl, "decodeUUIDSync", DecodeUUIDSync);
 }
 
 void Adapter::initGap(v8::Local<v8::FunctionTemplate> tpl)
 {
     Nan::SetPrototypeMethod(tpl, "gapSetAddress", GapSetAddress);
     Nan::SetPrototypeMethod(tpl, "gapGetAddress", GapGetAddress);
+    Nan::SetPrototypeMethod(tpl, "gapGetAddressSync", GapGetAddressSync);
     Nan::SetPrototypeMethod(tpl, "gapUpdateConnectionParameters", GapUpdateConnectionParameters);
     Nan::SetPrototypeMethod(tpl, "gapDisconnect", GapDisconnect);
     Nan::SetPrototypeMethod(tpl, "gapSetTXPower", GapSetTXPower);
     Nan::SetPrototypeMethod(tpl, "gapSetDeviceName", GapSetDeviceName);
     Nan::SetPrototypeMethod(tpl, "gapGetDeviceName", GapGetDeviceName);
+    Nan::SetPrototypeMethod(tpl, "gapGetDeviceNameSync", GapGetDeviceNameSync);
     Nan::SetPrototypeMethod(tpl, "gapStartRSSI", GapStartRSSI);
     Nan::SetPrototypeMethod(tpl, "gapStopRSSI", GapStopRSSI);
     Nan::SetPrototypeMethod(tpl, "gapGetRSSI", GapGetRSSI);
@@ -372,10 +457,18 @@ void Adapter::initGattS(v8::Local<v8::FunctionTemplate> tpl)
 #endif
 }
 
-Adapter::Adapter()
+Adapter::Adapter() :
+    notificationQueue(NOTIFICATION_QUEUE_SIZE),
+    logBuffer(LOG_BATCH_MAX_LINES, LOG_BATCH_MAX_TEXT)
 {
     adapter = nullptr;
 
+    logBuffer.setRateLimit(SD_RPC_LOG_TRACE, LOG_DEFAULT_VERBOSE_RATE, 2 * LOG_DEFAULT_VERBOSE_RATE);
+    logBuffer.setRateLimit(SD_RPC_LOG_DEBUG, LOG_DEFAULT_VERBOSE_RATE, 2 * LOG_DEFAULT_VERBOSE_RATE);
+    logBatch.droppedCount = 0;
+    logSeverityFilter = SD_RPC_LOG_INFO;
+    debugLogListeners = false;
+
     eventCallbackMaxCount = 0;
     eventCallbackBatchEventCounter = 0;
     eventCallbackBatchEventTotalCount = 0;
@@ -384,10 +477,77 @@ Adapter::Adapter()
     eventCallback = nullptr;
 
     eventIntervalTimer = nullptr;
+    healthReportTimer = nullptr;
+
+    asyncNotification = nullptr;
+
+    connectionActiveCount = 0;
+    connectionCount = 0;
+    pendingConnectCount = 0;
+    connectionRssi = 0;
+    addressCached = false;
+    deviceNameCached = false;
+
+    // Handles of this adapter belong to the event loop of the thread that created it
+    loop = Nan::GetCurrentEventLoop();
+
+    commandQueue = new CommandQueue(loop, &traceBuffer, &flightRecorder, &healthMonitor);
 
-    asyncEvent = nullptr;
-    asyncLog = nullptr;
-    asyncStatus = nullptr;
+    // Commands returning promises do not reference the adapter from JavaScript,
+    // keep it from being collected until their results are delivered
+    commandQueue->setBusyHandler([this](const bool busy) {
+        if (busy)
+        {
+            Ref();
+        }
+        else
+        {
+            Unref();
+        }
+    });
+
+    lescResponder.setHandlers(
+        [this](const uint16_t connHandle, const uint8_t *dhkey) -> uint32_t
+        {
+            ble_gap_lesc_dhkey_t key;
+            memcpy(key.key, dhkey, sizeof(key.key));
+            auto errorCode = sd_ble_gap_lesc_dhkey_reply(adapter, connHandle, &key);
+            memset(&key, 0, sizeof(key));
+            return errorCode;
+        },
+        [this](const uint16_t connHandle, const uint32_t result)
+        {
+            std::ostringstream message;
+
+            if (result == NRF_SUCCESS)
+            {
+                message << "LESC DHKey replied for connection " << connHandle;
+                appendLog(SD_RPC_LOG_DEBUG, message.str().c_str());
+            }
+            else if (result == NRF_ERROR_INVALID_DATA)
+            {
+                message << "Invalid LESC peer public key for connection " << connHandle << ", failing the pairing";
+                appendLog(SD_RPC_LOG_ERROR, message.str().c_str());
+            }
+            else
+            {
+                message << "Failed to reply LESC DHKey for connection " << connHandle << ", error " << result;
+                appendLog(SD_RPC_LOG_ERROR, message.str().c_str());
+            }
+        });
+
+    bondStore.setResultHandler(
+        [this](const bool stored, const std::string &error)
+        {
+            if (stored)
+            {
+                appendLog(SD_RPC_LOG_DEBUG, "Bond stored");
+            }
+            else
+            {
+                appendLog(SD_RPC_LOG_ERROR, ("Bond not stored: " + error).c_str());
+            }
+        });
 
     adapterCloseMutex = new uv_mutex_t();
 
@@ -397,17 +557,37 @@ Adapter::Adapter()
         std::terminate();
     }
 
-    adapters.push_back(this);
+#if NODE_MODULE_VERSION >= 64
+    // Stop the adapter if its worker thread is terminated before the adapter is garbage collected
+    node::AddEnvironmentCleanupHook(v8::Isolate::GetCurrent(), environmentCleanup, this);
+#endif
 }
 
 Adapter::~Adapter()
 {
-    // Remove this adapter from the global container of adapters
-    adapters.erase(std::find(adapters.begin(), adapters.end(), this));
+#if NODE_MODULE_VERSION >= 64
+    node::RemoveEnvironmentCleanupHook(v8::Isolate::GetCurrent(), environmentCleanup, this);
+#endif
+
+    // Write the bonds not written yet while the log still takes the results
+    bondStore.shutdown();
+
+    // Release driver threads blocked on a full queue, the registry waits for the callbacks using this adapter
+    notificationQueue.close();
+    logBuffer.close();
+
+    // Stop routing driver callbacks to this adapter
+    if (adapter != nullptr)
+    {
+        adapterRegistry.remove(adapter->internal);
+    }
 
     // Remove callbacks and cleanup uv_handle_t instances
     cleanUpV8Resources();
 
+    // Wait for the command in progress and stop the command thread
+    delete commandQueue;
+
     uv_mutex_destroy(adapterCloseMutex);
     delete adapterCloseMutex;
 }
@@ -422,11 +602,41 @@ NAN_METHOD(Adapter::New)
     }
     else
     {
-        v8::Local<v8::Function> cons = Nan::New(constructor);
+        Nan::Persistent<v8::Function> *constructor;
+
+        {
+            std::lock_guard<std::mutex> lock(constructorsMutex);
+            constructor = constructors[v8::Isolate::GetCurrent()];
+        }
+
+        v8::Local<v8::Function> cons = Nan::New(*constructor);
         info.GetReturnValue().Set(cons->NewInstance());
     }
 }
 
+#if NODE_MODULE_VERSION >= 64
+void Adapter::environmentCleanup(void *arg)
+{
+    auto adapter = static_cast<Adapter *>(arg);
+
+    // The event loop is going away, close the driver and stop all threads using it.
+    // A driver thread blocked on a full queue is released first, sd_rpc_close waits for it.
+    adapter->lescResponder.stop();
+    adapter->bondStore.shutdown();
+    adapter->notificationQueue.close();
+    adapter->logBuffer.close();
+
+    if (adapter->adapter != nullptr)
+    {
+        sd_rpc_close(adapter->adapter);
+    }
+
+    // JavaScript must not run anymore, commands not delivered yet are freed without calling back
+    adapter->commandQueue->abandon();
+    adapter->cleanUpV8Resources();
+}
+#endif
+
 int32_t Adapter::getEventCallbackTotalTime() const
 {
     return static_cast<int32_t>(eventCallbackDuration.count());
@@ -464,6 +674,21 @@ double Adapter::getAverageCallbackBatchCount() const
     return averageCallbackBatchCount;
 }
 
+uint32_t Adapter::getEventQueueFullCount()
+{
+    return notificationQueue.getFullCount();
+}
+
+uint32_t Adapter::getLogDroppedCount()
+{
+    return logBuffer.getDroppedCount();
+}
+
+uint32_t Adapter::getLogDroppedCount(sd_rpc_log_severity_t severity)
+{
+    return logBuffer.getDroppedCount(severity);
+}
+
 void Adapter::addEventBatchStatistics(std::chrono::milliseconds duration)
 {
     eventCallbackDuration += duration;
@@ -537,6 +762,14 @@ void Adapter::destroySecurityKeyStorage(const uint16_t connHandle)
     keysetMap.erase(connHandle);
 }
 
+void Adapter::clearConfigurationCache()
+{
+    vendorUUIDBases.clear();
+    addressCached = false;
+    deviceNameCached = false;
+    cachedDeviceName.clear();
+}
+
 ble_gap_sec_keyset_t *Adapter::getSecurityKey(const uint16_t connHandle)
 {
     auto keyset = keysetMap.find(connHandle);
@@ -549,3 +782,128 @@ ble_gap_sec_keyset_t *Adapter::getSecurityKey(const uint16_t connHandle)
     return keyset->second;
 
 }
+
+// This runs in the NodeJS thread, before the keyset of the pairing is destroyed. Returns true if the bond is being written.
+bool Adapter::storeBond(const uint16_t connHandle, const ble_gap_evt_auth_status_t *status, const ble_gap_sec_keyset_t *keyset)
+{
+    if (!bondStore.isOpen() || status->auth_status != BLE_GAP_SEC_STATUS_SUCCESS || !status->bonded)
+    {
+        return false;
+    }
+
+    BondRecord record;
+    memset(&record, 0, sizeof(record));
+
+    auto peerIdKey = keyset->keys_peer.p_id_key;
+
+    if (status->kdist_peer.id && peerIdKey != nullptr)
+    {
+        record.addrType = peerIdKey->id_addr_info.addr_type;
+        memcpy(record.addr, peerIdKey->id_addr_info.addr, BLE_GAP_ADDR_LEN);
+        memcpy(record.irk, peerIdKey->id_info.irk, BLE_GAP_SEC_KEY_LEN);
+        record.irkValid = true;
+    }
+    else
+    {
+        auto address = connectionAddresses.find(connHandle);
+
+        if (address == connectionAddresses.end())
+        {
+            appendLog(SD_RPC_LOG_ERROR, "Bond not stored, the peer address of the connection is not known");
+            return false;
+        }
+
+        record.addrType = address->second.addr_type;
+        memcpy(record.addr, address->second.addr, BLE_GAP_ADDR_LEN);
+    }
+
+    // LE Secure Connections keys are not distributed, so the key distribution does not tell if they are set
+    auto copyKey = [](const ble_gap_enc_key_t *encKey, BondKey &key) -> bool
+    {
+        if (encKey == nullptr || encKey->enc_info.ltk_len == 0)
+        {
+            return false;
+        }
+
+        memcpy(key.ltk, encKey->enc_info.ltk, BLE_GAP_SEC_KEY_LEN);
+        key.ltkLen = encKey->enc_info.ltk_len;
+        key.lesc = encKey->enc_info.lesc;
+        key.auth = encKey->enc_info.auth;
+        key.ediv = encKey->master_id.ediv;
+        memcpy(key.rand, encKey->master_id.rand, BLE_GAP_SEC_RAND_LEN);
+        return true;
+    };
+
+    record.ownKeyValid = copyKey(keyset->keys_own.p_enc_key, record.ownKey);
+    record.peerKeyValid = copyKey(keyset->keys_peer.p_enc_key, record.peerKey);
+
+    // The file is written by the writer thread of the store, the result is logged
+    auto submitted = bondStore.submit(record);
+    memset(&record, 0, sizeof(record));
+
+    return submitted;
+}
+
+// This runs in the driver thread, the reply is sent before the event is queued for JavaScript
+bool Adapter::replySecurityInfo(const uint16_t connHandle, const ble_gap_evt_sec_info_request_t *request)
+{
+    BondRecord record;
+    auto legacy = request->master_id.ediv != 0 || std::any_of(request->master_id.rand, request->master_id.rand + BLE_GAP_SEC_RAND_LEN, [](uint8_t value) { return value != 0; });
+    auto found = legacy
+        ? bondStore.findByMasterId(request->master_id.ediv, request->master_id.rand, record)
+        : bondStore.findByAddress(request->peer_addr.addr_type, request->peer_addr.addr, record);
+
+    if (!found)
+    {
+        return false;
+    }
+
+    // As peripheral the key asked for by EDIV and RAND is the one this adapter distributed
+    const BondKey *key = nullptr;
+
+    if (record.ownKeyValid && record.ownKey.lesc != legacy)
+    {
+        key = &record.ownKey;
+    }
+    else if (!legacy && record.peerKeyValid && record.peerKey.lesc)
+    {
+        key = &record.peerKey;
+    }
+
+    if (key == nullptr)
+    {
+        memset(&record, 0, sizeof(record));
+        return false;
+    }
+
+    ble_gap_enc_info_t encInfo;
+    memset(&encInfo, 0, sizeof(encInfo));
+    memcpy(encInfo.ltk, key->ltk, BLE_GAP_SEC_KEY_LEN);
+    encInfo.ltk_len = key->ltkLen;
+    encInfo.lesc = key->lesc;
+    encInfo.auth = key->auth;
+
+    ble_gap_irk_t irk;
+    memcpy(irk.irk, record.irk, BLE_GAP_SEC_KEY_LEN);
+
+    auto errorCode = sd_ble_gap_sec_info_reply(adapter, connHandle,
+                                               request->enc_info ? &encInfo : nullptr,
+                                               request->id_info && record.irkValid ? &irk : nullptr,
+                                               nullptr);
+
+    memset(&encInfo, 0, sizeof(encInfo));
+    memset(&record, 0, sizeof(record));
+
+    std::ostringstream message;
+
+    if (errorCode != NRF_SUCCESS)
+    {
+        message << "Failed to reply security information for connection " << connHandle << ", error " << errorCode;
+        appendLog(SD_RPC_LOG_ERROR, message.str().c_str());
+        return false;
+    }
+
+    message << "Security information replied from the bond store for connection " << connHandle;
+    appendLog(SD_RPC_LOG_DEBUG, message.str().c_str());
+    return true;
+}
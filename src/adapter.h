@@ -39,34 +39,63 @@
 
 #include <nan.h>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
 #include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "sd_rpc.h"
 
-#include "circular_fifo_unsafe.h"
+#include "adapter_registry.h"
+#include "bond_store.h"
+#include "bounded_queue.h"
+#include "command_queue.h"
+#include "flight_recorder.h"
+#include "health_monitor.h"
+#include "lesc_responder.h"
+#include "log_buffer.h"
+#include "trace_buffer.h"
 
-const auto EVENT_QUEUE_SIZE = 64;
-const auto LOG_QUEUE_SIZE = 64;
-const auto STATUS_QUEUE_SIZE = 64;
+// Room for the events, statuses and log batch announcements waiting for one wakeup of the NodeJS thread
+const auto NOTIFICATION_QUEUE_SIZE = 128;
+// Upper bounds of the log lines and message text waiting for one wakeup of the NodeJS thread
+const auto LOG_BATCH_MAX_LINES = 4096;
+const auto LOG_BATCH_MAX_TEXT = 256 * 1024;
+
+// Default size in bytes of the flight recorder of an adapter, about a minute of busy traffic
+const auto FLIGHT_RECORDER_DEFAULT_SIZE = 4 * 1024 * 1024;
+
+// Default limit of trace and debug lines per second, the burst is twice the rate
+const auto LOG_DEFAULT_VERBOSE_RATE = 2000;
+
+// Upper bound of the peers remembered per adapter, the least recently heard ones are forgotten first
+const auto PEER_SIGHTINGS_MAX = 1024;
+
+// Status id of the periodic health reports, delivered on the status channel next to the sd_rpc_app_status_t ids
+const int HEALTH_REPORT = 100;
 
 #define ADAPTER_METHOD_DEFINITIONS(MainName) \
     static NAN_METHOD(MainName); \
     static void MainName(uv_work_t *req); \
     static void After##MainName(uv_work_t *req);
 
-struct LogEntry
-{
-public:
-    sd_rpc_log_severity_t severity;
-    std::string message;
-};
-
 struct EventEntry
 {
 public:
     ble_evt_t *event;
     std::string timestamp;
     int adapterID;
+
+    // Identifies the event in the trace, 0 if tracing was disabled when the event was received
+    uint32_t traceId;
+    const char *traceName;
+
+    // Set if a LESC DHKey request was answered natively
+    bool autoReplied;
 };
 
 struct StatusEntry
@@ -77,37 +106,105 @@ public:
     std::string timestamp;
 };
 
-//using namespace memory_relaxed_aquire_release;
-using namespace memory_sequential_unsafe;
+// An operation that configured the SoftDevice, kept so that it can be applied again after a reset
+struct OpenBaton;
+
+struct ConfigurationStep
+{
+public:
+    const char *name;
+
+    // Set for steps that set a value. A later step with the same name and target replaces the step.
+    bool isSetter;
+    std::string target;
+
+    std::function<uint32_t(adapter_t *)> apply;
+};
+
+// Last advertising report received from a peer
+struct PeerSighting
+{
+public:
+    int8_t rssi;
+    std::chrono::steady_clock::time_point heard;
+
+    // Position in the list of peers ordered by the time they were last heard
+    std::list<uint64_t>::iterator age;
+};
+
+enum NotificationKind
+{
+    NOTIFICATION_EVENT,
+    NOTIFICATION_STATUS,
+    NOTIFICATION_LOG
+};
+
+// Entry in the queue from the driver threads to the NodeJS thread, a log entry announces that logBuffer has lines
+struct Notification
+{
+public:
+    NotificationKind kind;
+    EventEntry *event;
+    StatusEntry *status;
+};
 
-typedef CircularFifo<EventEntry *, EVENT_QUEUE_SIZE> EventQueue;
-typedef CircularFifo<LogEntry *, LOG_QUEUE_SIZE> LogQueue;
-typedef CircularFifo<StatusEntry *, STATUS_QUEUE_SIZE> StatusQueue;
+typedef BoundedQueue<Notification> NotificationQueue;
 
 class Adapter : public Nan::ObjectWrap
 {
 public:
     static NAN_MODULE_INIT(Init);
+    static void removeConstructor(v8::Isolate *isolate);
 
-    static Adapter *getAdapter(adapter_t *adapter, Adapter *defaultAdapter = nullptr);
+    static Adapter *getAdapter(adapter_t *adapter);
+
+    // For the driver threads, the Adapter is not deleted while the lease is held
+    static AdapterRegistry::Lease acquireAdapter(adapter_t *adapter);
 
     adapter_t *getInternalAdapter() const;
 
+    // Returns false if there is no room to register the adapter
+    bool setInternalAdapter(adapter_t *internalAdapter);
+
+    void initNotificationHandling();
+    void onNotification(uv_async_t *handle);
+
     void initEventHandling(Nan::Callback *callback, const uint32_t interval);
     void appendEvent(ble_evt_t *event);
-
-    void onRpcEvent(uv_async_t *handle);
     void eventIntervalCallback(uv_timer_t *handle);
 
     void initLogHandling(Nan::Callback *callback);
-    void appendLog(LogEntry *log);
-
-    void onLogEvent(uv_async_t *handle);
+    void appendLog(sd_rpc_log_severity_t severity, const char *message);
 
     void initStatusHandling(Nan::Callback *callback);
     void appendStatus(StatusEntry *log);
 
-    void onStatusEvent(uv_async_t *handle);
+    // Delivers a health report on the status channel every interval milliseconds, 0 stops the reports
+    void setHealthReportInterval(const uint32_t interval);
+    void onHealthReportTimer(uv_timer_t *handle);
+
+    // Load and link state, used by AdapterPool to choose an adapter for a connection
+    void updateLinkState(const ble_evt_t *event);
+    void connectAttemptStarted();
+    void connectAttemptEnded();
+    uint32_t getConnectionCount();
+    uint32_t getPendingConnectCount();
+    double getConnectionRssi();
+    // Looks up a peer by its address in the most significant byte first order, addrType is negative to match any type
+    bool getPeerSighting(const uint64_t address, const int addrType, PeerSighting *sighting);
+
+    // Forgets connections, connection attempts and peers, called when the link to the connectivity chip starts over
+    void resetLinkState();
+
+    // Answers a security information request from the bond store, runs in the driver thread
+    bool replySecurityInfo(const uint16_t connHandle, const ble_gap_evt_sec_info_request_t *request);
+
+    // Called from the command thread when a configuration command has succeeded. Steps that add to the
+    // configuration are appended. A setter replaces the earlier step setting the same target, an empty
+    // target for setters of a single value, and moves to the end so the replay keeps the order of the calls.
+    static void recordConfiguration(adapter_t *adapter, const char *name, std::function<uint32_t(adapter_t *)> apply);
+    static void recordConfiguration(adapter_t *adapter, const char *name, const std::string &target, std::function<uint32_t(adapter_t *)> apply);
+    static void clearConfiguration(adapter_t *adapter);
 
     void cleanUpV8Resources();
 
@@ -120,20 +217,28 @@ public:
 
     double getAverageCallbackBatchCount() const;
 
+    uint32_t getEventQueueFullCount();
+    uint32_t getLogDroppedCount();
+    uint32_t getLogDroppedCount(sd_rpc_log_severity_t severity);
+
     void addEventBatchStatistics(std::chrono::milliseconds duration);
 
 private:
     explicit Adapter();
     ~Adapter();
 
-    static Nan::Persistent<v8::Function> constructor;
+    static std::map<v8::Isolate *, Nan::Persistent<v8::Function> *> constructors;
+    static std::mutex constructorsMutex;
 
     static NAN_METHOD(New);
 
+    static void environmentCleanup(void *arg);
+
     // General async methods
     ADAPTER_METHOD_DEFINITIONS(Open);
     ADAPTER_METHOD_DEFINITIONS(Close);
     ADAPTER_METHOD_DEFINITIONS(ConnReset);
+    ADAPTER_METHOD_DEFINITIONS(Reinitialize);
     ADAPTER_METHOD_DEFINITIONS(EnableBLE);
     ADAPTER_METHOD_DEFINITIONS(GetVersion);
     ADAPTER_METHOD_DEFINITIONS(AddVendorSpecificUUID);
@@ -145,6 +250,33 @@ private:
 
     // General sync methods
     static NAN_METHOD(GetStats);
+    static NAN_METHOD(SetCompletionCallback);
+    static NAN_METHOD(SetDefaultCommandTimeout);
+    static NAN_METHOD(SetCommandTimeout);
+    static NAN_METHOD(GetLastCommandId);
+    static NAN_METHOD(CancelCommand);
+    static NAN_METHOD(SetTracing);
+    static NAN_METHOD(SetLogRateLimit);
+    static NAN_METHOD(SetDebugLogListeners);
+    static NAN_METHOD(GetHealthReport);
+    static NAN_METHOD(SetLescPrivateKey);
+    static NAN_METHOD(SetBondStore);
+    static NAN_METHOD(GetBonds);
+    static NAN_METHOD(DeleteBond);
+    static void UpdateBondStore(uv_work_t *req);
+    static void AfterUpdateBondStore(uv_work_t *req);
+    static NAN_METHOD(SetHealthReportInterval);
+    static NAN_METHOD(DumpFlightRecorder);
+    static void WriteFlightRecorderDump(uv_work_t *req);
+    static void AfterWriteFlightRecorderDump(uv_work_t *req);
+    static NAN_METHOD(GetTrace);
+
+    // Sync methods answered from the state kept by the adapter. They return undefined if the
+    // value is not known locally, the caller must then use the async method.
+    static NAN_METHOD(EncodeUUIDSync);
+    static NAN_METHOD(DecodeUUIDSync);
+    static NAN_METHOD(GapGetAddressSync);
+    static NAN_METHOD(GapGetDeviceNameSync);
 
     // Gap async mehtods
     ADAPTER_METHOD_DEFINITIONS(GapSetAddress);
@@ -214,18 +346,54 @@ private:
     static void initGattS(v8::Local<v8::FunctionTemplate> tpl);
 
     void dispatchEvents();
+    void deliverEvents(std::vector<EventEntry *> &entries);
+    void deliverLogs();
+    void deliverStatus(StatusEntry *statusEntry);
+    bool hasDebugLogConsumers() const;
+    v8::Local<v8::Object> getHealthReport();
     static uint32_t enableBLE(adapter_t *adapter, ble_enable_params_t *ble_enable_params);
+    static uint32_t runInitScript(OpenBaton *baton);
 
     void createSecurityKeyStorage(const uint16_t connHandle, ble_gap_sec_keyset_t *keyset);
     void destroySecurityKeyStorage(const uint16_t connHandle);
     ble_gap_sec_keyset_t *getSecurityKey(const uint16_t connHandle);
+    bool storeBond(const uint16_t connHandle, const ble_gap_evt_auth_status_t *status, const ble_gap_sec_keyset_t *keyset);
+
+    bool encodeUUIDLocal(const ble_uuid_t *uuid, uint8_t *uuid_le_len, uint8_t *uuid_le) const;
+    bool decodeUUIDLocal(const uint8_t uuid_le_len, const uint8_t *uuid_le, ble_uuid_t *uuid) const;
+
+    void clearConfigurationCache();
 
     std::map<uint16_t, ble_gap_sec_keyset_t *> keysetMap;
 
+    // Peer address of each connection, only accessed from the NodeJS thread
+    std::map<uint16_t, ble_gap_addr_t> connectionAddresses;
+
+    // Cache of adapter configuration values, only accessed from the NodeJS thread.
+    // Cleared when the SoftDevice is opened, enabled or reset and invalidated by the corresponding setters.
+    std::map<uint8_t, ble_uuid128_t> vendorUUIDBases;
+    bool addressCached;
+    ble_gap_addr_t cachedAddress;
+    bool deviceNameCached;
+    std::string cachedDeviceName;
+
     adapter_t *adapter;
-    EventQueue eventQueue;
-    LogQueue logQueue;
-    StatusQueue statusQueue;
+
+    // Event loop of the thread (main or worker) that created this adapter
+    uv_loop_t *loop;
+
+    // Events and status are never dropped, the driver thread waits for room in the queue.
+    // Log lines are delivered in batches and dropped when over their rate limit or if JavaScript does not keep up.
+    // One queue for all kinds keeps their order and wakes the NodeJS thread once for all of them.
+    NotificationQueue notificationQueue;
+    LogBuffer logBuffer;
+
+    // Batch being delivered to JavaScript, swapped with the pending batch of logBuffer
+    LogBatch logBatch;
+
+    // Debug log text is only rendered when the log level lets it through and someone listens to it
+    sd_rpc_log_severity_t logSeverityFilter;
+    bool debugLogListeners;
 
     Nan::Callback *eventCallback;
     Nan::Callback *logCallback;
@@ -234,13 +402,47 @@ private:
     // Interval to use for sending BLE driver events to JavaScript. If 0 events will be sent as soon as they are received from the BLE driver.
     uint32_t eventInterval;
     uv_timer_t* eventIntervalTimer;
-    uv_async_t* asyncEvent;
-
-    uv_async_t* asyncLog;
-    uv_async_t* asyncStatus;
+    uv_async_t* asyncNotification;
 
     uv_mutex_t* adapterCloseMutex;
 
+    // Dedicated thread and queue for the RPC calls done by this adapter
+    CommandQueue *commandQueue;
+
+    // Timeline of the commands and events of this adapter, recorded while tracing is enabled
+    TraceBuffer traceBuffer;
+
+    // Compact record of every event, command and log line, kept while the adapter is open and dumped on request
+    FlightRecorder flightRecorder;
+
+    // Transport health, reset when the adapter is opened
+    HealthMonitor healthMonitor;
+    uv_timer_t *healthReportTimer;
+
+    // Answers LESC DHKey requests natively while JavaScript has set a private key
+    LescResponder lescResponder;
+
+    // Bonds made by this adapter, used to answer security information requests natively while open
+    BondStore bondStore;
+
+    // Configuration applied since the SoftDevice was last enabled, replayed by Reinitialize.
+    // Only accessed from the command thread.
+    std::vector<ConfigurationStep> configurationJournal;
+
+    // Link state, written by the driver thread for each event and read from the NodeJS thread
+    std::mutex linkStateMutex;
+    uint32_t connectionCount;
+    uint32_t pendingConnectCount;
+    double connectionRssi;
+    std::unordered_map<uint64_t, PeerSighting> peerSightings;
+    // Keys of peerSightings, the most recently heard peer first
+    std::list<uint64_t> peerSightingAge;
+
+    // Number of times the link to the connectivity chip has become active, waited for by Reinitialize
+    std::mutex statusMutex;
+    std::condition_variable statusCondition;
+    uint32_t connectionActiveCount;
+
     // Statistics:
     // Accumulated deltas for event callbacks done to the driver
     std::chrono::milliseconds eventCallbackDuration;
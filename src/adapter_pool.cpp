@@ -0,0 +1,308 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "adapter_pool.h"
+#include "adapter.h"
+#include "common.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+static name_map_t pool_addr_type_map =
+{
+    NAME_MAP_ENTRY(BLE_GAP_ADDR_TYPE_PUBLIC),
+    NAME_MAP_ENTRY(BLE_GAP_ADDR_TYPE_RANDOM_STATIC),
+    NAME_MAP_ENTRY(BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_RESOLVABLE),
+    NAME_MAP_ENTRY(BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_NON_RESOLVABLE)
+};
+
+static bool parseAddress(const std::string &text, uint64_t *key)
+{
+    unsigned int bytes[BLE_GAP_ADDR_LEN];
+
+    auto scan_count = sscanf(text.c_str(), "%2x:%2x:%2x:%2x:%2x:%2x",
+        &(bytes[0]), &(bytes[1]), &(bytes[2]), &(bytes[3]), &(bytes[4]), &(bytes[5]));
+
+    if (scan_count != BLE_GAP_ADDR_LEN)
+    {
+        return false;
+    }
+
+    // The text starts with the most significant byte
+    *key = 0;
+
+    for (auto i = 0; i < BLE_GAP_ADDR_LEN; i++)
+    {
+        *key = (*key << 8) | static_cast<uint8_t>(bytes[i]);
+    }
+
+    return true;
+}
+
+NAN_MODULE_INIT(AdapterPool::Init)
+{
+    v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(New);
+    tpl->SetClassName(Nan::New("AdapterPool").ToLocalChecked());
+    tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+    Nan::SetPrototypeMethod(tpl, "add", Add);
+    Nan::SetPrototypeMethod(tpl, "remove", Remove);
+    Nan::SetPrototypeMethod(tpl, "select", Select);
+    Nan::SetPrototypeMethod(tpl, "getLoad", GetLoad);
+
+    Nan::Set(target, Nan::New("AdapterPool").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+AdapterPool::AdapterPool() :
+    nextId(0)
+{}
+
+AdapterPool::~AdapterPool()
+{
+    for (auto &member : members)
+    {
+        member.second.object->Reset();
+        delete member.second.object;
+    }
+
+    members.clear();
+}
+
+NAN_METHOD(AdapterPool::New)
+{
+    if (!info.IsConstructCall())
+    {
+        Nan::ThrowTypeError("AdapterPool must be called with new");
+        return;
+    }
+
+    auto obj = new AdapterPool();
+    obj->Wrap(info.This());
+    info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(AdapterPool::Add)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<AdapterPool>(info.Holder());
+    v8::Local<v8::Object> adapterObject;
+    auto argumentcount = 0;
+
+    try
+    {
+        adapterObject = ConversionUtility::getJsObject(info[argumentcount]);
+
+        if (adapterObject->InternalFieldCount() < 1
+            || !adapterObject->GetConstructorName()->Equals(Nan::New("Adapter").ToLocalChecked()))
+        {
+            throw std::string("native Adapter");
+        }
+
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto adapter = Nan::ObjectWrap::Unwrap<Adapter>(adapterObject);
+
+    for (auto &member : obj->members)
+    {
+        if (member.second.adapter == adapter)
+        {
+            info.GetReturnValue().Set(ConversionUtility::toJsNumber(member.first));
+            return;
+        }
+    }
+
+    auto id = obj->nextId++;
+    obj->members[id] = Member{ adapter, new Nan::Persistent<v8::Object>(adapterObject) };
+
+    info.GetReturnValue().Set(ConversionUtility::toJsNumber(id));
+}
+
+NAN_METHOD(AdapterPool::Remove)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<AdapterPool>(info.Holder());
+    uint32_t id;
+    auto argumentcount = 0;
+
+    try
+    {
+        id = ConversionUtility::getNativeUint32(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto member = obj->members.find(id);
+
+    if (member == obj->members.end())
+    {
+        info.GetReturnValue().Set(Nan::False());
+        return;
+    }
+
+    member->second.object->Reset();
+    delete member->second.object;
+    obj->members.erase(member);
+
+    info.GetReturnValue().Set(Nan::True());
+}
+
+NAN_METHOD(AdapterPool::Select)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<AdapterPool>(info.Holder());
+    uint64_t address = 0;
+    auto hasAddress = false;
+    uint32_t maxAge = defaultPeerMaxAge;
+    auto addrType = -1;
+    auto argumentcount = 0;
+
+    try
+    {
+        if (!info[argumentcount]->IsUndefined() && !info[argumentcount]->IsNull())
+        {
+            if (!parseAddress(ConversionUtility::getNativeString(info[argumentcount]), &address))
+            {
+                throw std::string("address string");
+            }
+
+            hasAddress = true;
+        }
+
+        argumentcount++;
+
+        if (!info[argumentcount]->IsUndefined())
+        {
+            maxAge = ConversionUtility::getNativeUint32(info[argumentcount]);
+        }
+
+        argumentcount++;
+
+        // Without a type the most recent sighting of the address with any type counts
+        if (!info[argumentcount]->IsUndefined() && !info[argumentcount]->IsNull())
+        {
+            auto type = fromNameToValue(pool_addr_type_map, ConversionUtility::getNativeString(info[argumentcount]).c_str());
+
+            if (type == static_cast<uint16_t>(-1))
+            {
+                throw std::string("address type string");
+            }
+
+            addrType = type;
+        }
+
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto window = std::chrono::milliseconds(maxAge);
+
+    auto found = false;
+    auto bestHeard = false;
+    uint32_t bestId = 0;
+    uint32_t bestLoad = 0;
+    int8_t bestRssi = 0;
+
+    for (auto &member : obj->members)
+    {
+        auto adapter = member.second.adapter;
+        auto load = adapter->getConnectionCount() + adapter->getPendingConnectCount();
+
+        PeerSighting sighting;
+        auto heard = hasAddress
+            && adapter->getPeerSighting(address, addrType, &sighting)
+            && now - sighting.heard <= window;
+        int8_t rssi = heard ? sighting.rssi : INT8_MIN;
+
+        auto better = !found
+            || (heard && !bestHeard)
+            || (heard == bestHeard && (load < bestLoad || (load == bestLoad && rssi > bestRssi)));
+
+        if (better)
+        {
+            found = true;
+            bestHeard = heard;
+            bestId = member.first;
+            bestLoad = load;
+            bestRssi = rssi;
+        }
+    }
+
+    if (!found)
+    {
+        info.GetReturnValue().Set(Nan::Undefined());
+        return;
+    }
+
+    info.GetReturnValue().Set(ConversionUtility::toJsNumber(bestId));
+}
+
+NAN_METHOD(AdapterPool::GetLoad)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<AdapterPool>(info.Holder());
+    v8::Local<v8::Array> load = Nan::New<v8::Array>();
+    uint32_t index = 0;
+
+    for (auto &member : obj->members)
+    {
+        auto adapter = member.second.adapter;
+        v8::Local<v8::Object> entry = Nan::New<v8::Object>();
+
+        Utility::Set(entry, "id", member.first);
+        Utility::Set(entry, "connectionCount", adapter->getConnectionCount());
+        Utility::Set(entry, "pendingConnectCount", adapter->getPendingConnectCount());
+        Utility::Set(entry, "connectionRssi", adapter->getConnectionRssi());
+
+        Nan::Set(load, index++, entry);
+    }
+
+    info.GetReturnValue().Set(load);
+}
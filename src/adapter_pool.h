@@ -0,0 +1,80 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ADAPTER_POOL_H
+#define ADAPTER_POOL_H
+
+#include <nan.h>
+#include <cstdint>
+#include <map>
+
+class Adapter;
+
+// Chooses which of several open adapters should create a new connection.
+//
+// The choice is made from the link state each Adapter keeps up to date from its own driver
+// events: the adapters that have heard the peer advertise recently are preferred, and among
+// them the one with the fewest connections (established and pending), then the strongest RSSI.
+// If no adapter has heard the peer, the least loaded adapter is chosen.
+class AdapterPool : public Nan::ObjectWrap
+{
+public:
+    static NAN_MODULE_INIT(Init);
+
+private:
+    AdapterPool();
+    ~AdapterPool();
+
+    static NAN_METHOD(New);
+    static NAN_METHOD(Add);
+    static NAN_METHOD(Remove);
+    static NAN_METHOD(Select);
+    static NAN_METHOD(GetLoad);
+
+    struct Member
+    {
+        Adapter *adapter;
+        Nan::Persistent<v8::Object> *object;
+    };
+
+    // Default age in milliseconds of an advertising report for the peer to count as heard
+    static const uint32_t defaultPeerMaxAge = 10000;
+
+    std::map<uint32_t, Member> members;
+    uint32_t nextId;
+};
+
+#endif // ADAPTER_POOL_H
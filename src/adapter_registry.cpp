@@ -0,0 +1,171 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "adapter_registry.h"
+
+#include <thread>
+
+AdapterRegistry::AdapterRegistry()
+{
+    for (auto &slot : slots)
+    {
+        slot.key.store(nullptr, std::memory_order_relaxed);
+        slot.value.store(nullptr, std::memory_order_relaxed);
+        slot.readers.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t AdapterRegistry::hash(const void *handle)
+{
+    // Handles are heap pointers, the low bits carry little information
+    auto value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+
+    return static_cast<size_t>(value) & (capacity - 1);
+}
+
+bool AdapterRegistry::add(const void *handle, Adapter *adapter)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+
+    auto start = hash(handle);
+    Slot *freeSlot = nullptr;
+
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        auto &slot = slots[(start + i) & (capacity - 1)];
+        auto key = slot.key.load(std::memory_order_relaxed);
+
+        if (key == handle)
+        {
+            slot.value.store(adapter);
+            return true;
+        }
+
+        if (freeSlot == nullptr && slot.value.load(std::memory_order_relaxed) == nullptr)
+        {
+            freeSlot = &slot;
+        }
+
+        // The handle can not be further along the probe sequence than an unused slot
+        if (key == nullptr)
+        {
+            break;
+        }
+    }
+
+    if (freeSlot == nullptr)
+    {
+        return false;
+    }
+
+    // The key is stored before the value. A reader that sees the new value also sees the new key.
+    freeSlot->key.store(handle);
+    freeSlot->value.store(adapter);
+    return true;
+}
+
+void AdapterRegistry::remove(const void *handle)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+
+    auto start = hash(handle);
+
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        auto &slot = slots[(start + i) & (capacity - 1)];
+        auto key = slot.key.load(std::memory_order_relaxed);
+
+        if (key == handle)
+        {
+            slot.value.store(nullptr);
+
+            // A reader that announced itself before the value was cleared may be using the adapter.
+            // Later readers see the cleared value and let go.
+            while (slot.readers.load() != 0)
+            {
+                std::this_thread::yield();
+            }
+
+            return;
+        }
+
+        if (key == nullptr)
+        {
+            return;
+        }
+    }
+}
+
+AdapterRegistry::Lease AdapterRegistry::acquire(const void *handle)
+{
+    auto start = hash(handle);
+
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        auto &slot = slots[(start + i) & (capacity - 1)];
+        auto key = slot.key.load();
+
+        if (key == handle)
+        {
+            // Announced before the slot is checked again, remove() and reuse of the slot wait for it
+            slot.readers.fetch_add(1);
+
+            // The value is read before the key, a value stored by a later registration comes with its own key
+            auto value = slot.value.load();
+
+            if (value != nullptr && slot.key.load() == handle)
+            {
+                return Lease(&slot, value);
+            }
+
+            slot.readers.fetch_sub(1);
+        }
+        else if (key == nullptr)
+        {
+            return Lease();
+        }
+    }
+
+    return Lease();
+}
+
+Adapter *AdapterRegistry::find(const void *handle)
+{
+    return acquire(handle).get();
+}
@@ -0,0 +1,123 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ADAPTER_REGISTRY_H
+#define ADAPTER_REGISTRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+class Adapter;
+
+// Maps the internal handle of a driver adapter to the Adapter that receives its callbacks.
+//
+// Lookups are done by the driver threads for every event, log entry and status, and do not lock.
+// The table uses open addressing with linear probing. A key is never removed from its slot, a
+// removed entry only has its value cleared, so the probe sequence of every other key stays intact
+// and the slot can be reused by a later registration. Registrations are rare and serialized by a mutex.
+//
+// A driver thread holds a Lease while it uses the Adapter it found. Each slot counts its leases,
+// and remove() waits for them to end, so an Adapter is never deleted while a driver thread uses it
+// and a slot is never reused under a reader that matched its previous key.
+class AdapterRegistry
+{
+private:
+    struct Slot
+    {
+        std::atomic<const void *> key;
+        std::atomic<Adapter *> value;
+        std::atomic<uint32_t> readers;
+    };
+
+public:
+    class Lease
+    {
+    public:
+        Lease() : slot(nullptr), adapter(nullptr) {}
+        Lease(Lease &&other) : slot(other.slot), adapter(other.adapter)
+        {
+            other.slot = nullptr;
+            other.adapter = nullptr;
+        }
+
+        ~Lease()
+        {
+            if (slot != nullptr)
+            {
+                slot->readers.fetch_sub(1);
+            }
+        }
+
+        Adapter *get() const { return adapter; }
+
+    private:
+        friend class AdapterRegistry;
+
+        Lease(Slot *slot, Adapter *adapter) : slot(slot), adapter(adapter) {}
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+
+        Slot *slot;
+        Adapter *adapter;
+    };
+
+    AdapterRegistry();
+
+    // An adapter must be registered before the driver can call back with its handle,
+    // and unregistered before the handle is deleted. Returns false if the table is full.
+    bool add(const void *handle, Adapter *adapter);
+
+    // Waits for the leases on the adapter to end. Must not be called by a thread holding one.
+    void remove(const void *handle);
+
+    // For driver threads, the adapter stays registered until the lease is destroyed
+    Lease acquire(const void *handle);
+
+    // For the threads that own the adapter and know it is registered
+    Adapter *find(const void *handle);
+
+    static const size_t capacity = 256;
+
+private:
+    static size_t hash(const void *handle);
+
+    Slot slots[capacity];
+    std::mutex writeMutex;
+};
+
+#endif // ADAPTER_REGISTRY_H
@@ -0,0 +1,658 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "bond_store.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// File layout, all values little endian:
+//   header: magic (8 bytes), version (uint16), record size (uint16), record count (uint32)
+//   record: flags, address type, address (6), own key (28), peer key (28), peer IRK (16)
+//   key:    LTK (16), LTK length, key flags, EDIV (uint16), RAND (8)
+static const char BOND_FILE_MAGIC[8] = { 'P', 'C', 'B', 'L', 'E', 'B', 'N', 'D' };
+static const uint16_t BOND_FILE_VERSION = 1;
+static const size_t BOND_FILE_HEADER_SIZE = 16;
+static const size_t BOND_KEY_SIZE = BOND_LTK_LEN + 4 + BOND_RAND_LEN;
+static const size_t BOND_RECORD_SIZE = 2 + BOND_ADDR_LEN + 2 * BOND_KEY_SIZE + BOND_IRK_LEN;
+
+// Guards against reading a file that is not a bond store into memory
+static const uint32_t BOND_FILE_MAX_RECORDS = 4096;
+
+enum BondRecordFlags
+{
+    BOND_OWN_KEY_VALID = 0x01,
+    BOND_PEER_KEY_VALID = 0x02,
+    BOND_IRK_VALID = 0x04
+};
+
+enum BondKeyFlags
+{
+    BOND_KEY_LESC = 0x01,
+    BOND_KEY_AUTH = 0x02
+};
+
+static void writeUint16(uint8_t *data, const uint16_t value)
+{
+    data[0] = static_cast<uint8_t>(value);
+    data[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void writeUint32(uint8_t *data, const uint32_t value)
+{
+    writeUint16(data, static_cast<uint16_t>(value));
+    writeUint16(data + 2, static_cast<uint16_t>(value >> 16));
+}
+
+static uint16_t readUint16(const uint8_t *data)
+{
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+static uint32_t readUint32(const uint8_t *data)
+{
+    return readUint16(data) | (static_cast<uint32_t>(readUint16(data + 2)) << 16);
+}
+
+static void writeKey(uint8_t *data, const BondKey &key)
+{
+    memcpy(data, key.ltk, BOND_LTK_LEN);
+    data += BOND_LTK_LEN;
+    *data++ = key.ltkLen;
+    *data++ = (key.lesc ? BOND_KEY_LESC : 0) | (key.auth ? BOND_KEY_AUTH : 0);
+    writeUint16(data, key.ediv);
+    memcpy(data + 2, key.rand, BOND_RAND_LEN);
+}
+
+static void readKey(const uint8_t *data, BondKey &key)
+{
+    memcpy(key.ltk, data, BOND_LTK_LEN);
+    data += BOND_LTK_LEN;
+    key.ltkLen = *data++;
+    key.lesc = (*data & BOND_KEY_LESC) != 0;
+    key.auth = (*data & BOND_KEY_AUTH) != 0;
+    data++;
+    key.ediv = readUint16(data);
+    memcpy(key.rand, data + 2, BOND_RAND_LEN);
+}
+
+static uint64_t addressKey(const uint8_t addrType, const uint8_t *addr)
+{
+    uint64_t key = addrType;
+
+    for (auto i = BOND_ADDR_LEN; i > 0; --i)
+    {
+        key = (key << 8) | addr[i - 1];
+    }
+
+    return key;
+}
+
+static uint64_t randKey(const uint8_t *rand)
+{
+    uint64_t key = 0;
+
+    for (auto i = BOND_RAND_LEN; i > 0; --i)
+    {
+        key = (key << 8) | rand[i - 1];
+    }
+
+    return key;
+}
+
+static std::string fileError(const std::string &action, const std::string &path)
+{
+    return action + " " + path + " failed: " + strerror(errno);
+}
+
+BondStore::Bonds::~Bonds()
+{
+    // The keys are secrets, do not leave them in freed memory
+    for (auto &record : records)
+    {
+        memset(&record, 0, sizeof(record));
+    }
+}
+
+BondStore::BondStore()
+    : opened(false), bonds(std::make_shared<Bonds>()), running(false), stopped(false)
+{
+}
+
+BondStore::~BondStore()
+{
+    shutdown();
+}
+
+void BondStore::setResultHandler(ResultFunction resultFunction)
+{
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    result = resultFunction;
+}
+
+bool BondStore::open(const std::string &filePath, std::string &error)
+{
+    Operation operation;
+    operation.type = BOND_STORE_OPEN;
+    operation.path = filePath;
+    return perform(operation, error);
+}
+
+void BondStore::close()
+{
+    Operation operation;
+    operation.type = BOND_STORE_CLOSE;
+
+    std::string error;
+    perform(operation, error);
+}
+
+bool BondStore::remove(const uint8_t addrType, const uint8_t *addr, std::string &error)
+{
+    Operation operation;
+    operation.type = BOND_STORE_REMOVE;
+    memset(&operation.record, 0, sizeof(operation.record));
+    operation.record.addrType = addrType;
+    memcpy(operation.record.addr, addr, BOND_ADDR_LEN);
+    return perform(operation, error);
+}
+
+bool BondStore::isOpen()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return opened;
+}
+
+bool BondStore::submit(const BondRecord &record)
+{
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    Operation operation;
+    operation.type = BOND_STORE_PUT;
+    operation.record = record;
+    operation.completion = nullptr;
+
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    auto queued = enqueue(operation);
+    memset(&operation.record, 0, sizeof(operation.record));
+    return queued;
+}
+
+void BondStore::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        stopped = true;
+        running = false;
+    }
+
+    pendingCondition.notify_one();
+
+    if (writer.joinable())
+    {
+        writer.join();
+    }
+
+    // No writer is left, the bonds are released here
+    unload();
+}
+
+bool BondStore::perform(Operation &operation, std::string &error)
+{
+    Completion completion;
+    completion.done = false;
+    completion.succeeded = false;
+    operation.completion = &completion;
+
+    std::unique_lock<std::mutex> lock(pendingMutex);
+
+    if (!enqueue(operation))
+    {
+        error = "Bond store is shut down";
+        return false;
+    }
+
+    completedCondition.wait(lock, [&completion] { return completion.done; });
+
+    error = completion.error;
+    return completion.succeeded;
+}
+
+bool BondStore::enqueue(const Operation &operation)
+{
+    if (stopped)
+    {
+        return false;
+    }
+
+    pending.push_back(operation);
+
+    if (!running)
+    {
+        running = true;
+        writer = std::thread(&BondStore::run, this);
+    }
+
+    pendingCondition.notify_one();
+    return true;
+}
+
+// This runs in the bond store writer thread
+void BondStore::run()
+{
+    std::unique_lock<std::mutex> lock(pendingMutex);
+
+    while (true)
+    {
+        pendingCondition.wait(lock, [this] { return !running || !pending.empty(); });
+
+        // Requested operations are applied before the writer stops
+        if (pending.empty())
+        {
+            break;
+        }
+
+        auto operation = pending.front();
+        memset(&pending.front().record, 0, sizeof(BondRecord));
+        pending.pop_front();
+
+        auto resultFunction = result;
+
+        lock.unlock();
+
+        std::string error;
+        auto succeeded = apply(operation, error);
+        memset(&operation.record, 0, sizeof(operation.record));
+
+        if (operation.completion == nullptr && resultFunction)
+        {
+            resultFunction(succeeded, error);
+        }
+
+        lock.lock();
+
+        if (operation.completion != nullptr)
+        {
+            operation.completion->succeeded = succeeded;
+            operation.completion->error = error;
+            operation.completion->done = true;
+            completedCondition.notify_all();
+        }
+    }
+}
+
+// This runs in the bond store writer thread
+bool BondStore::apply(const Operation &operation, std::string &error)
+{
+    switch (operation.type)
+    {
+        case BOND_STORE_PUT:
+            return put(operation.record, error);
+        case BOND_STORE_REMOVE:
+            return remove(operation.record, error);
+        case BOND_STORE_OPEN:
+            return load(operation.path, error);
+        case BOND_STORE_CLOSE:
+            unload();
+            return true;
+    }
+
+    return false;
+}
+
+bool BondStore::load(const std::string &filePath, std::string &error)
+{
+    auto next = std::make_shared<Bonds>();
+    auto loaded = load(filePath, *next, error);
+
+    if (loaded)
+    {
+        index(*next);
+    }
+    else
+    {
+        next = std::make_shared<Bonds>();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    path = loaded ? filePath : std::string();
+    opened = loaded;
+    bonds = next;
+    return loaded;
+}
+
+void BondStore::unload()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    opened = false;
+    path.clear();
+    bonds = std::make_shared<Bonds>();
+}
+
+std::shared_ptr<const BondStore::Bonds> BondStore::snapshot()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return bonds;
+}
+
+bool BondStore::commit(const std::shared_ptr<Bonds> &next, std::string &error)
+{
+    std::string filePath;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!opened)
+        {
+            error = "Bond store is not open";
+            return false;
+        }
+
+        filePath = path;
+    }
+
+    index(*next);
+
+    // The current bonds stay in use if the file can not be written
+    if (!save(filePath, *next, error))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    bonds = next;
+    return true;
+}
+
+bool BondStore::put(const BondRecord &record, std::string &error)
+{
+    auto current = snapshot();
+    auto next = std::make_shared<Bonds>();
+    next->records = current->records;
+
+    auto it = current->addressIndex.find(addressKey(record.addrType, record.addr));
+
+    if (it != current->addressIndex.end())
+    {
+        next->records[it->second] = record;
+    }
+    else
+    {
+        next->records.push_back(record);
+    }
+
+    return commit(next, error);
+}
+
+bool BondStore::remove(const BondRecord &address, std::string &error)
+{
+    auto current = snapshot();
+
+    if (!isOpen())
+    {
+        error = "Bond store is not open";
+        return false;
+    }
+
+    auto it = current->addressIndex.find(addressKey(address.addrType, address.addr));
+
+    if (it == current->addressIndex.end())
+    {
+        return true;
+    }
+
+    auto next = std::make_shared<Bonds>();
+    next->records = current->records;
+    memset(&next->records[it->second], 0, sizeof(BondRecord));
+    next->records.erase(next->records.begin() + it->second);
+
+    return commit(next, error);
+}
+
+bool BondStore::findByMasterId(const uint16_t ediv, const uint8_t *rand, BondRecord &record)
+{
+    auto current = snapshot();
+    auto it = current->masterIdIndex.find(MasterId(ediv, randKey(rand)));
+
+    if (it == current->masterIdIndex.end())
+    {
+        return false;
+    }
+
+    record = current->records[it->second];
+    return true;
+}
+
+bool BondStore::findByAddress(const uint8_t addrType, const uint8_t *addr, BondRecord &record)
+{
+    auto current = snapshot();
+    auto it = current->addressIndex.find(addressKey(addrType, addr));
+
+    if (it == current->addressIndex.end())
+    {
+        return false;
+    }
+
+    record = current->records[it->second];
+    return true;
+}
+
+std::vector<BondRecord> BondStore::list()
+{
+    return snapshot()->records;
+}
+
+void BondStore::index(Bonds &bonds)
+{
+    bonds.addressIndex.clear();
+    bonds.masterIdIndex.clear();
+
+    for (size_t i = 0; i < bonds.records.size(); i++)
+    {
+        auto &record = bonds.records[i];
+        bonds.addressIndex[addressKey(record.addrType, record.addr)] = i;
+
+        // LE Secure Connections keys have an EDIV and RAND of zero, they are found by address
+        if (record.ownKeyValid && !record.ownKey.lesc)
+        {
+            bonds.masterIdIndex[MasterId(record.ownKey.ediv, randKey(record.ownKey.rand))] = i;
+        }
+    }
+}
+
+bool BondStore::load(const std::string &filePath, Bonds &bonds, std::string &error)
+{
+    auto file = fopen(filePath.c_str(), "rb");
+
+    if (file == nullptr)
+    {
+        if (errno == ENOENT)
+        {
+            return true;
+        }
+
+        error = fileError("Opening", filePath);
+        return false;
+    }
+
+    uint8_t header[BOND_FILE_HEADER_SIZE];
+    auto valid = fread(header, 1, sizeof(header), file) == sizeof(header)
+        && memcmp(header, BOND_FILE_MAGIC, sizeof(BOND_FILE_MAGIC)) == 0
+        && readUint16(header + 8) == BOND_FILE_VERSION
+        && readUint16(header + 10) == BOND_RECORD_SIZE
+        && readUint32(header + 12) <= BOND_FILE_MAX_RECORDS;
+
+    auto count = valid ? readUint32(header + 12) : 0;
+
+    for (uint32_t i = 0; valid && i < count; i++)
+    {
+        uint8_t data[BOND_RECORD_SIZE];
+
+        if (fread(data, 1, sizeof(data), file) != sizeof(data))
+        {
+            valid = false;
+            break;
+        }
+
+        BondRecord record;
+        record.ownKeyValid = (data[0] & BOND_OWN_KEY_VALID) != 0;
+        record.peerKeyValid = (data[0] & BOND_PEER_KEY_VALID) != 0;
+        record.irkValid = (data[0] & BOND_IRK_VALID) != 0;
+        record.addrType = data[1];
+        memcpy(record.addr, data + 2, BOND_ADDR_LEN);
+        readKey(data + 2 + BOND_ADDR_LEN, record.ownKey);
+        readKey(data + 2 + BOND_ADDR_LEN + BOND_KEY_SIZE, record.peerKey);
+        memcpy(record.irk, data + 2 + BOND_ADDR_LEN + 2 * BOND_KEY_SIZE, BOND_IRK_LEN);
+        memset(data, 0, sizeof(data));
+
+        bonds.records.push_back(record);
+    }
+
+    fclose(file);
+
+    if (!valid)
+    {
+        error = filePath + " is not a valid bond store";
+        return false;
+    }
+
+    return true;
+}
+
+// Writes the records to a temporary file and moves it over the store, the caller holds writeMutex
+bool BondStore::save(const std::string &filePath, const Bonds &bonds, std::string &error)
+{
+    auto &records = bonds.records;
+    auto temporaryPath = filePath + ".tmp";
+    std::vector<uint8_t> data(BOND_FILE_HEADER_SIZE + records.size() * BOND_RECORD_SIZE, 0);
+
+    memcpy(data.data(), BOND_FILE_MAGIC, sizeof(BOND_FILE_MAGIC));
+    writeUint16(data.data() + 8, BOND_FILE_VERSION);
+    writeUint16(data.data() + 10, BOND_RECORD_SIZE);
+    writeUint32(data.data() + 12, static_cast<uint32_t>(records.size()));
+
+    auto position = data.data() + BOND_FILE_HEADER_SIZE;
+
+    for (auto &record : records)
+    {
+        position[0] = (record.ownKeyValid ? BOND_OWN_KEY_VALID : 0)
+            | (record.peerKeyValid ? BOND_PEER_KEY_VALID : 0)
+            | (record.irkValid ? BOND_IRK_VALID : 0);
+        position[1] = record.addrType;
+        memcpy(position + 2, record.addr, BOND_ADDR_LEN);
+        writeKey(position + 2 + BOND_ADDR_LEN, record.ownKey);
+        writeKey(position + 2 + BOND_ADDR_LEN + BOND_KEY_SIZE, record.peerKey);
+        memcpy(position + 2 + BOND_ADDR_LEN + 2 * BOND_KEY_SIZE, record.irk, BOND_IRK_LEN);
+        position += BOND_RECORD_SIZE;
+    }
+
+#if defined(_WIN32)
+    auto file = fopen(temporaryPath.c_str(), "wb");
+#else
+    // Only the owner may read the keys
+    auto descriptor = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    auto file = descriptor >= 0 ? fdopen(descriptor, "wb") : nullptr;
+
+    if (file == nullptr && descriptor >= 0)
+    {
+        ::close(descriptor);
+    }
+#endif
+
+    if (file == nullptr)
+    {
+        error = fileError("Creating", temporaryPath);
+        memset(data.data(), 0, data.size());
+        return false;
+    }
+
+    auto written = fwrite(data.data(), 1, data.size(), file) == data.size() && fflush(file) == 0;
+    memset(data.data(), 0, data.size());
+
+    // The data must be on disk before the rename makes it the store
+#if defined(_WIN32)
+    written = written && _commit(_fileno(file)) == 0;
+#else
+    written = written && fsync(fileno(file)) == 0;
+#endif
+
+    if (!written)
+    {
+        error = fileError("Writing", temporaryPath);
+        fclose(file);
+        ::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    if (fclose(file) != 0)
+    {
+        error = fileError("Closing", temporaryPath);
+        ::remove(temporaryPath.c_str());
+        return false;
+    }
+
+#if defined(_WIN32)
+    if (MoveFileExA(temporaryPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) == 0)
+    {
+        error = "Replacing " + filePath + " failed with error " + std::to_string(GetLastError());
+        ::remove(temporaryPath.c_str());
+        return false;
+    }
+#else
+    if (rename(temporaryPath.c_str(), filePath.c_str()) != 0)
+    {
+        error = fileError("Replacing", filePath);
+        ::remove(temporaryPath.c_str());
+        return false;
+    }
+#endif
+
+    return true;
+}
@@ -0,0 +1,207 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BOND_STORE_H
+#define BOND_STORE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define BOND_LTK_LEN 16
+#define BOND_RAND_LEN 8
+#define BOND_IRK_LEN 16
+#define BOND_ADDR_LEN 6
+
+// Encryption key of a bond, with the EDIV and RAND identifying it
+struct BondKey
+{
+    uint8_t ltk[BOND_LTK_LEN];
+    uint8_t ltkLen;
+    bool lesc;
+    bool auth;
+    uint16_t ediv;
+    uint8_t rand[BOND_RAND_LEN];
+};
+
+struct BondRecord
+{
+    // Identity address of the peer, or the address it connected with if it did not distribute one
+    uint8_t addrType;
+    uint8_t addr[BOND_ADDR_LEN];
+
+    bool ownKeyValid;
+    BondKey ownKey;
+
+    bool peerKeyValid;
+    BondKey peerKey;
+
+    bool irkValid;
+    uint8_t irk[BOND_IRK_LEN];
+};
+
+// Bonds of one adapter, kept in memory and in a file.
+//
+// Lookups are done by the driver thread when the SoftDevice asks for security information.
+// Every change rewrites the whole file through a temporary file that replaces it, so a crash
+// leaves either the old or the new set of bonds on disk. A change is built on a copy of the
+// bonds, which replaces them only once it is on disk, so lookups never wait for the file.
+//
+// Files are only read and written by the writer thread, in the order the changes are requested.
+class BondStore
+{
+public:
+    // Called on the writer thread with the result of a bond submitted with submit()
+    typedef std::function<void(const bool stored, const std::string &error)> ResultFunction;
+
+    BondStore();
+    ~BondStore();
+
+    void setResultHandler(ResultFunction result);
+
+    // These wait for the writer thread and must not be called from the NodeJS thread.
+    // Loads the bonds in path, a missing file is an empty store. The store is closed on failure.
+    bool open(const std::string &path, std::string &error);
+    // Closes the store once the changes requested before are written
+    void close();
+    bool remove(const uint8_t addrType, const uint8_t *addr, std::string &error);
+
+    bool isOpen();
+
+    // Adds the bond from the writer thread, replacing the one with the same address.
+    // Returns false if the store is not open.
+    bool submit(const BondRecord &record);
+
+    // Writes the changes requested before, closes the store and stops the writer thread.
+    // For teardown, the store does not accept changes afterwards.
+    void shutdown();
+
+    // The EDIV and RAND distributed to the peer in a legacy pairing
+    bool findByMasterId(const uint16_t ediv, const uint8_t *rand, BondRecord &record);
+    // The address must match the stored identity address exactly. Resolvable private addresses are not
+    // resolved with the stored IRKs, a peer reconnecting with one is left to JavaScript.
+    bool findByAddress(const uint8_t addrType, const uint8_t *addr, BondRecord &record);
+
+    std::vector<BondRecord> list();
+
+private:
+    typedef std::pair<uint16_t, uint64_t> MasterId;
+
+    enum OperationType
+    {
+        BOND_STORE_PUT,
+        BOND_STORE_REMOVE,
+        BOND_STORE_OPEN,
+        BOND_STORE_CLOSE
+    };
+
+    // Result of an operation the caller waits for
+    struct Completion
+    {
+        bool done;
+        bool succeeded;
+        std::string error;
+    };
+
+    // A change applied by the writer thread. The record holds the bond to put or the address to remove.
+    struct Operation
+    {
+        OperationType type;
+        BondRecord record;
+        std::string path;
+        Completion *completion;
+    };
+
+    // A set of bonds, not changed once it is shared with the lookups
+    struct Bonds
+    {
+        ~Bonds();
+
+        std::vector<BondRecord> records;
+        std::unordered_map<uint64_t, size_t> addressIndex;
+        std::map<MasterId, size_t> masterIdIndex;
+    };
+
+    std::shared_ptr<const Bonds> snapshot();
+
+    // These run in the writer thread
+    bool apply(const Operation &operation, std::string &error);
+    bool load(const std::string &path, std::string &error);
+    void unload();
+    bool put(const BondRecord &record, std::string &error);
+    bool remove(const BondRecord &address, std::string &error);
+    // Saves the bonds and makes them the current ones
+    bool commit(const std::shared_ptr<Bonds> &next, std::string &error);
+
+    static bool load(const std::string &filePath, Bonds &bonds, std::string &error);
+    static bool save(const std::string &filePath, const Bonds &bonds, std::string &error);
+    static void index(Bonds &bonds);
+
+    void run();
+    // Queues the operation and waits for its result
+    bool perform(Operation &operation, std::string &error);
+    // Must be called with pendingMutex locked, returns false after shutdown()
+    bool enqueue(const Operation &operation);
+
+    // Changed by the writer thread with mutex held
+    std::string path;
+    bool opened;
+    std::shared_ptr<const Bonds> bonds;
+
+    // Held by the lookups, never during file I/O
+    std::mutex mutex;
+
+    // Operations requested by the other threads, applied by the writer thread
+    ResultFunction result;
+    std::deque<Operation> pending;
+    bool running;
+    bool stopped;
+    std::thread writer;
+    std::mutex pendingMutex;
+    std::condition_variable pendingCondition;
+    std::condition_variable completedCondition;
+};
+
+#endif // BOND_STORE_H
@@ -0,0 +1,159 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Thread safe FIFO with a fixed capacity used to pass entries from the driver threads to the NodeJS thread.
+//
+// When the queue is full a blocking push waits until the consumer has made room, giving back pressure
+// to the producer, while a non-blocking push drops the entry and counts it. Closing the queue releases
+// any blocked producer and makes further pushes fail until the queue is opened again.
+template<typename Element>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(const size_t capacity)
+        : capacity(capacity), closed(true), droppedCount(0), fullCount(0)
+    {
+    }
+
+    // Returns false if the entry was not queued, the caller keeps the ownership of the entry
+    bool push(const Element &item, const bool blocking)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if (!closed && queue.size() >= capacity)
+        {
+            fullCount += 1;
+
+            if (!blocking)
+            {
+                droppedCount += 1;
+                return false;
+            }
+
+            notFull.wait(lock, [this] { return closed || queue.size() < capacity; });
+        }
+
+        if (closed)
+        {
+            return false;
+        }
+
+        queue.push_back(item);
+        return true;
+    }
+
+    bool pop(Element &item)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (queue.empty())
+        {
+            return false;
+        }
+
+        item = queue.front();
+        queue.pop_front();
+        notFull.notify_one();
+
+        return true;
+    }
+
+    bool wasEmpty()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queue.empty();
+    }
+
+    bool wasFull()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queue.size() >= capacity;
+    }
+
+    void open()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = false;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queue.size();
+    }
+
+    // Number of entries dropped by non-blocking pushes on a full queue
+    uint32_t getDroppedCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return droppedCount;
+    }
+
+    // Number of pushes that found the queue full
+    uint32_t getFullCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return fullCount;
+    }
+
+private:
+    const size_t capacity;
+    bool closed;
+    uint32_t droppedCount;
+    uint32_t fullCount;
+
+    std::deque<Element> queue;
+    std::mutex mutex;
+    std::condition_variable notFull;
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,782 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "command_queue.h"
+
+#include <iostream>
+
+extern "C" {
+    void command_completed_handler(uv_async_t *handle)
+    {
+        auto queue = static_cast<CommandQueue *>(handle->data);
+
+        if (queue != nullptr)
+        {
+            queue->onCompleted(handle);
+        }
+        else
+        {
+            std::cerr << "No command queue to process command completion." << std::endl;
+            std::terminate();
+        }
+    }
+
+    void command_deadline_handler(uv_timer_t *handle)
+    {
+        auto queue = static_cast<CommandQueue *>(handle->data);
+
+        if (queue != nullptr)
+        {
+            queue->onDeadline(handle);
+        }
+    }
+}
+
+static void runMicrotasks()
+{
+    auto isolate = v8::Isolate::GetCurrent();
+
+#if V8_MAJOR_VERSION > 7 || (V8_MAJOR_VERSION == 7 && V8_MINOR_VERSION >= 4)
+    isolate->PerformMicrotaskCheckpoint();
+#else
+    isolate->RunMicrotasks();
+#endif
+}
+
+CommandQueue::CommandQueue(uv_loop_t *loop, TraceBuffer *traceBuffer, FlightRecorder *flightRecorder, HealthMonitor *healthMonitor)
+    : loop(loop), traceBuffer(traceBuffer), flightRecorder(flightRecorder), healthMonitor(healthMonitor)
+{
+    asyncCompleted = nullptr;
+    deadlineTimer = nullptr;
+    running = false;
+    stopping = false;
+    inFlight = false;
+    completionCallback = nullptr;
+    outstanding = 0;
+    nextId = 0;
+    defaultTimeout = 0;
+    completionBatchNumber = 0;
+    completionBatchEntryTotalCount = 0;
+
+    maxDepth = 0;
+    commandCount = 0;
+    waitTimeTotal = std::chrono::microseconds::zero();
+    waitTimeMax = std::chrono::microseconds::zero();
+    timedOutCount = 0;
+    cancelledCount = 0;
+
+    if (uv_mutex_init(&mutex) != 0)
+    {
+        std::cerr << "Not able to create command queue mutex! Terminating." << std::endl;
+        std::terminate();
+    }
+
+    if (uv_cond_init(&condition) != 0)
+    {
+        std::cerr << "Not able to create command queue condition! Terminating." << std::endl;
+        std::terminate();
+    }
+}
+
+CommandQueue::~CommandQueue()
+{
+    // The queue is deleted with its adapter, possibly from a garbage collection callback
+    abandon();
+
+    uv_cond_destroy(&condition);
+    uv_mutex_destroy(&mutex);
+
+    delete completionCallback;
+}
+
+void CommandQueue::start()
+{
+    if (running)
+    {
+        return;
+    }
+
+    asyncCompleted = new uv_async_t();
+    asyncCompleted->data = static_cast<void *>(this);
+
+    if (uv_async_init(loop, asyncCompleted, command_completed_handler) != 0)
+    {
+        std::cerr << "Not able to create a new command completion handler." << std::endl;
+        std::terminate();
+    }
+
+    // Only keep the event loop alive while there are commands in progress
+    uv_unref(reinterpret_cast<uv_handle_t *>(asyncCompleted));
+
+    deadlineTimer = new uv_timer_t();
+    deadlineTimer->data = static_cast<void *>(this);
+
+    if (uv_timer_init(loop, deadlineTimer) != 0)
+    {
+        std::cerr << "Not able to create command deadline timer." << std::endl;
+        std::terminate();
+    }
+
+    // Pending commands keep the loop alive through asyncCompleted
+    uv_unref(reinterpret_cast<uv_handle_t *>(deadlineTimer));
+
+    running = true;
+
+    if (uv_thread_create(&thread, threadMain, static_cast<void *>(this)) != 0)
+    {
+        std::cerr << "Not able to create command queue thread." << std::endl;
+        std::terminate();
+    }
+}
+
+void CommandQueue::joinThread()
+{
+    uv_mutex_lock(&mutex);
+    running = false;
+    uv_cond_signal(&condition);
+    uv_mutex_unlock(&mutex);
+
+    // The command in progress, if any, is allowed to finish
+    uv_thread_join(&thread);
+}
+
+void CommandQueue::closeHandles()
+{
+    uv_close(reinterpret_cast<uv_handle_t *>(asyncCompleted), [](uv_handle_t *handle) {
+        delete reinterpret_cast<uv_async_t *>(handle);
+    });
+
+    asyncCompleted = nullptr;
+
+    uv_timer_stop(deadlineTimer);
+    uv_close(reinterpret_cast<uv_handle_t *>(deadlineTimer), [](uv_handle_t *handle) {
+        delete reinterpret_cast<uv_timer_t *>(handle);
+    });
+
+    deadlineTimer = nullptr;
+}
+
+void CommandQueue::stop()
+{
+    if (!running)
+    {
+        return;
+    }
+
+    joinThread();
+
+    // Commands not started are completed with an error, so their batons are freed and their callers answered.
+    // Callbacks may queue more commands, they are completed the same way until the queue stays empty.
+    stopping = true;
+
+    while (true)
+    {
+        uv_mutex_lock(&mutex);
+
+        while (!pending.empty())
+        {
+            auto entry = pending.front();
+            pending.pop_front();
+            abortEntry(entry, COMMAND_CANCELLED);
+        }
+
+        auto done = completed.empty();
+        uv_mutex_unlock(&mutex);
+
+        if (done)
+        {
+            break;
+        }
+
+        onCompleted(asyncCompleted);
+    }
+
+    stopping = false;
+
+    closeHandles();
+    outstanding = 0;
+}
+
+void CommandQueue::abandon()
+{
+    if (!running)
+    {
+        return;
+    }
+
+    joinThread();
+
+    std::deque<CommandEntry> entries;
+
+    uv_mutex_lock(&mutex);
+    entries.swap(completed);
+    entries.insert(entries.end(), pending.begin(), pending.end());
+    pending.clear();
+    uv_mutex_unlock(&mutex);
+
+    // Only native memory is freed, the persistent handles of the callbacks and promises are reset.
+    // Structures the after callback of a command would have freed are left.
+    for (auto &entry : entries)
+    {
+        delete static_cast<Baton *>(entry.req->data);
+    }
+
+    closeHandles();
+
+    if (outstanding != 0)
+    {
+        outstanding = 0;
+
+        if (busyHandler)
+        {
+            busyHandler(false);
+        }
+    }
+}
+
+void CommandQueue::setBusyHandler(std::function<void(const bool busy)> handler)
+{
+    busyHandler = handler;
+}
+
+uint32_t CommandQueue::enqueue(uv_work_t *req, uv_work_cb work, uv_after_work_cb after, const char *name, const CommandKind kind)
+{
+    // Commands queued while stopping are completed by stop()
+    if (!running && !stopping)
+    {
+        start();
+    }
+
+    if (outstanding++ == 0)
+    {
+        uv_ref(reinterpret_cast<uv_handle_t *>(asyncCompleted));
+
+        if (busyHandler)
+        {
+            busyHandler(true);
+        }
+    }
+
+    auto baton = static_cast<Baton *>(req->data);
+    baton->id = ++nextId;
+
+    CommandEntry entry;
+    entry.id = baton->id;
+    entry.name = name;
+    entry.req = req;
+    entry.work = work;
+    entry.after = after;
+    entry.queued = std::chrono::steady_clock::now();
+    entry.kind = kind;
+    entry.hasDeadline = false;
+    entry.abortReason = COMMAND_NOT_ABORTED;
+
+    traceBuffer->record(TRACE_COMMAND_QUEUED, name, entry.id);
+    flightRecorder->record(FLIGHT_RECORD_COMMAND_ISSUED, 0, entry.id, 0, name);
+
+    uv_mutex_lock(&mutex);
+
+    if (defaultTimeout != 0 && kind == COMMAND_KIND_RPC)
+    {
+        entry.hasDeadline = true;
+        entry.deadline = entry.queued + std::chrono::milliseconds(defaultTimeout);
+    }
+
+    pending.push_back(entry);
+
+    if (pending.size() > maxDepth)
+    {
+        maxDepth = static_cast<uint32_t>(pending.size());
+    }
+
+    if (entry.hasDeadline)
+    {
+        startDeadlineTimer();
+    }
+
+    uv_cond_signal(&condition);
+    uv_mutex_unlock(&mutex);
+
+    return entry.id;
+}
+
+uint32_t CommandQueue::getLastId() const
+{
+    return nextId;
+}
+
+void CommandQueue::setDefaultTimeout(const uint32_t timeout)
+{
+    defaultTimeout = timeout;
+}
+
+bool CommandQueue::setTimeout(const uint32_t id, const uint32_t timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    auto found = false;
+
+    uv_mutex_lock(&mutex);
+
+    if (inFlight && inFlightEntry.id == id && inFlightEntry.kind == COMMAND_KIND_RPC)
+    {
+        inFlightEntry.hasDeadline = timeout != 0;
+        inFlightEntry.deadline = deadline;
+        found = true;
+    }
+
+    for (auto &entry : pending)
+    {
+        if (entry.id == id && entry.kind == COMMAND_KIND_RPC)
+        {
+            entry.hasDeadline = timeout != 0;
+            entry.deadline = deadline;
+            found = true;
+            break;
+        }
+    }
+
+    if (found && running)
+    {
+        startDeadlineTimer();
+    }
+
+    uv_mutex_unlock(&mutex);
+
+    return found;
+}
+
+bool CommandQueue::cancel(const uint32_t id)
+{
+    auto found = false;
+
+    uv_mutex_lock(&mutex);
+
+    for (auto it = pending.begin(); it != pending.end(); ++it)
+    {
+        if (it->id == id && it->kind == COMMAND_KIND_RPC)
+        {
+            auto entry = *it;
+            pending.erase(it);
+            abortEntry(entry, COMMAND_CANCELLED);
+            found = true;
+            break;
+        }
+    }
+
+    uv_mutex_unlock(&mutex);
+
+    // The callback is called from the completion handler, never from within cancel()
+    if (found)
+    {
+        uv_async_send(asyncCompleted);
+    }
+
+    return found;
+}
+
+// Must be called with mutex locked
+void CommandQueue::abortEntry(CommandEntry &entry, const CommandAbortReason reason)
+{
+    auto baton = static_cast<Baton *>(entry.req->data);
+
+    entry.abortReason = reason;
+    baton->abortReason = reason;
+
+    if (reason == COMMAND_CANCELLED)
+    {
+        baton->result = NRF_ERROR_FORBIDDEN;
+        cancelledCount += 1;
+    }
+    else
+    {
+        baton->result = NRF_ERROR_TIMEOUT;
+        timedOutCount += 1;
+    }
+
+    flightRecorder->record(FLIGHT_RECORD_COMMAND_COMPLETED, static_cast<uint8_t>(reason), entry.id,
+                           static_cast<uint32_t>(baton->result), entry.name);
+
+    completed.push_back(entry);
+}
+
+// Must be called with mutex locked, from the NodeJS thread
+void CommandQueue::startDeadlineTimer()
+{
+    auto hasDeadline = false;
+    std::chrono::steady_clock::time_point earliest;
+
+    for (auto &entry : pending)
+    {
+        if (entry.hasDeadline && (!hasDeadline || entry.deadline < earliest))
+        {
+            earliest = entry.deadline;
+            hasDeadline = true;
+        }
+    }
+
+    if (!hasDeadline)
+    {
+        uv_timer_stop(deadlineTimer);
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    uint64_t delay = 0;
+
+    if (earliest > now)
+    {
+        // Round up so that the timer does not fire just before the deadline
+        delay = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(earliest - now).count()) + 1;
+    }
+
+    uv_timer_start(deadlineTimer, command_deadline_handler, delay, 0);
+}
+
+// Now we are in the NodeJS thread. Complete the queued commands that have passed their deadline.
+void CommandQueue::onDeadline(uv_timer_t *handle)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto expired = false;
+
+    uv_mutex_lock(&mutex);
+
+    for (auto it = pending.begin(); it != pending.end();)
+    {
+        if (it->hasDeadline && it->deadline <= now)
+        {
+            auto entry = *it;
+            it = pending.erase(it);
+            abortEntry(entry, COMMAND_TIMEOUT_QUEUED);
+            expired = true;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    startDeadlineTimer();
+    uv_mutex_unlock(&mutex);
+
+    if (expired)
+    {
+        onCompleted(asyncCompleted);
+    }
+}
+
+void CommandQueue::threadMain(void *arg)
+{
+    auto queue = static_cast<CommandQueue *>(arg);
+    queue->run();
+}
+
+// This runs in the command thread (not Main Thread)
+void CommandQueue::run()
+{
+    traceBuffer->nameThread("command");
+
+    uv_mutex_lock(&mutex);
+
+    while (true)
+    {
+        while (running && pending.empty())
+        {
+            uv_cond_wait(&condition, &mutex);
+        }
+
+        if (!running)
+        {
+            break;
+        }
+
+        auto entry = pending.front();
+        pending.pop_front();
+
+        // Deadlines are also checked here in case the deadline timer has not fired yet
+        if (entry.hasDeadline && std::chrono::steady_clock::now() >= entry.deadline)
+        {
+            abortEntry(entry, COMMAND_TIMEOUT_QUEUED);
+            uv_async_send(asyncCompleted);
+            continue;
+        }
+
+        auto waitTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - entry.queued);
+        waitTimeTotal += waitTime;
+        commandCount += 1;
+
+        if (waitTime > waitTimeMax)
+        {
+            waitTimeMax = waitTime;
+        }
+
+        inFlight = true;
+        inFlightEntry = entry;
+
+        uv_mutex_unlock(&mutex);
+
+        traceBuffer->record(TRACE_COMMAND_STARTED, entry.name, entry.id);
+        auto started = std::chrono::steady_clock::now();
+        entry.work(entry.req);
+
+        if (entry.kind == COMMAND_KIND_RPC)
+        {
+            healthMonitor->recordRoundTrip(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started));
+        }
+
+        traceBuffer->record(TRACE_COMMAND_RETURNED, entry.name, entry.id);
+
+        uv_mutex_lock(&mutex);
+
+        // The deadline may have been changed while the command was running
+        entry = inFlightEntry;
+        inFlight = false;
+
+        auto baton = static_cast<Baton *>(entry.req->data);
+        auto reason = COMMAND_NOT_ABORTED;
+
+        if (entry.hasDeadline && std::chrono::steady_clock::now() > entry.deadline)
+        {
+            // The RPC has completed, but too late. It did run, so its result is kept and only marked as late.
+            reason = COMMAND_TIMEOUT_IN_FLIGHT;
+            baton->completedLate = true;
+            timedOutCount += 1;
+        }
+
+        flightRecorder->record(FLIGHT_RECORD_COMMAND_COMPLETED, static_cast<uint8_t>(reason), entry.id,
+                               static_cast<uint32_t>(baton->result), entry.name);
+
+        completed.push_back(entry);
+
+        uv_async_send(asyncCompleted);
+    }
+
+    uv_mutex_unlock(&mutex);
+}
+
+void CommandQueue::setCompletionCallback(Nan::Callback *callback)
+{
+    delete completionCallback;
+    completionCallback = callback;
+}
+
+// Now we are in the NodeJS thread. Call the completion callbacks.
+void CommandQueue::onCompleted(uv_async_t *handle)
+{
+    std::deque<CommandEntry> entries;
+
+    uv_mutex_lock(&mutex);
+    entries.swap(completed);
+    uv_mutex_unlock(&mutex);
+
+    if (entries.empty())
+    {
+        return;
+    }
+
+    completionBatchNumber += 1;
+    completionBatchEntryTotalCount += static_cast<uint32_t>(entries.size());
+
+    Nan::HandleScope scope;
+
+    CompletionBatch batch;
+    batch.entries = Nan::New<v8::Array>();
+    batch.count = 0;
+    batch.immediate = completionCallback == nullptr;
+    batch.settledCount = 0;
+
+    completeEntries(entries, &batch);
+
+    if (completionCallback == nullptr)
+    {
+        // There is no call into JavaScript to return from, so the reactions of settled promises are run here
+        if (batch.settledCount != 0)
+        {
+            runMicrotasks();
+        }
+
+        return;
+    }
+
+    // The completion callback is also called with no entries if promises were settled, node runs
+    // the promise reactions when it returns
+    if (batch.count == 0 && batch.settledCount == 0)
+    {
+        return;
+    }
+
+    // The callback is kept since it may be replaced while the batch is delivered
+    auto callback = completionCallback;
+    completionCallback = nullptr;
+
+    v8::Local<v8::Value> argv[1];
+    argv[0] = batch.entries;
+
+    for (auto &entry : entries)
+    {
+        traceBuffer->record(TRACE_COMMAND_CALLBACK_STARTED, entry.name, entry.id);
+    }
+
+    callback->Call(1, argv);
+
+    for (auto &entry : entries)
+    {
+        traceBuffer->record(TRACE_COMMAND_CALLBACK_ENDED, entry.name, entry.id);
+    }
+
+    if (completionCallback == nullptr)
+    {
+        completionCallback = callback;
+    }
+    else
+    {
+        delete callback;
+    }
+}
+
+void CommandQueue::completeEntries(std::deque<CommandEntry> &entries, CompletionBatch *batch)
+{
+    for (auto entry : entries)
+    {
+        static_cast<Baton *>(entry.req->data)->batch = batch;
+
+        if (batch->immediate)
+        {
+            traceBuffer->record(TRACE_COMMAND_CALLBACK_STARTED, entry.name, entry.id);
+            entry.after(entry.req, 0);
+            traceBuffer->record(TRACE_COMMAND_CALLBACK_ENDED, entry.name, entry.id);
+        }
+        else
+        {
+            // The callback is called when the batch is delivered
+            entry.after(entry.req, 0);
+        }
+
+        if (--outstanding == 0)
+        {
+            if (asyncCompleted != nullptr)
+            {
+                uv_unref(reinterpret_cast<uv_handle_t *>(asyncCompleted));
+            }
+
+            if (busyHandler)
+            {
+                busyHandler(false);
+            }
+        }
+    }
+}
+
+uint32_t CommandQueue::getDepth()
+{
+    uv_mutex_lock(&mutex);
+    auto depth = static_cast<uint32_t>(pending.size());
+    uv_mutex_unlock(&mutex);
+
+    return depth;
+}
+
+uint32_t CommandQueue::getMaxDepth()
+{
+    uv_mutex_lock(&mutex);
+    auto depth = maxDepth;
+    uv_mutex_unlock(&mutex);
+
+    return depth;
+}
+
+uint32_t CommandQueue::getCommandCount()
+{
+    uv_mutex_lock(&mutex);
+    auto count = commandCount;
+    uv_mutex_unlock(&mutex);
+
+    return count;
+}
+
+uint32_t CommandQueue::getTimedOutCount()
+{
+    uv_mutex_lock(&mutex);
+    auto count = timedOutCount;
+    uv_mutex_unlock(&mutex);
+
+    return count;
+}
+
+uint32_t CommandQueue::getCancelledCount()
+{
+    uv_mutex_lock(&mutex);
+    auto count = cancelledCount;
+    uv_mutex_unlock(&mutex);
+
+    return count;
+}
+
+double CommandQueue::getAverageCompletionBatchCount()
+{
+    auto averageCompletionBatchCount = 0.0;
+
+    if (completionBatchNumber != 0)
+    {
+        averageCompletionBatchCount = static_cast<double>(completionBatchEntryTotalCount) / completionBatchNumber;
+    }
+
+    return averageCompletionBatchCount;
+}
+
+double CommandQueue::getAverageWaitTime()
+{
+    auto averageWaitTime = 0.0;
+
+    uv_mutex_lock(&mutex);
+
+    if (commandCount != 0)
+    {
+        averageWaitTime = waitTimeTotal.count() / 1000.0 / commandCount;
+    }
+
+    uv_mutex_unlock(&mutex);
+
+    return averageWaitTime;
+}
+
+double CommandQueue::getMaxWaitTime()
+{
+    uv_mutex_lock(&mutex);
+    auto maxWaitTime = waitTimeMax.count() / 1000.0;
+    uv_mutex_unlock(&mutex);
+
+    return maxWaitTime;
+}
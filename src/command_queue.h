@@ -0,0 +1,196 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <nan.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+
+#include "common.h"
+#include "flight_recorder.h"
+#include "health_monitor.h"
+#include "trace_buffer.h"
+
+enum CommandKind
+{
+    // A single RPC call. Its duration is recorded as a round trip, deadlines and cancel apply to it.
+    COMMAND_KIND_RPC,
+
+    // Opens, closes or resets the transport. It always runs, so its completion handler sees what was done.
+    COMMAND_KIND_LIFECYCLE
+};
+
+struct CommandEntry
+{
+public:
+    uint32_t id;
+    const char *name;
+    uv_work_t *req;
+    uv_work_cb work;
+    uv_after_work_cb after;
+    std::chrono::steady_clock::time_point queued;
+
+    CommandKind kind;
+
+    bool hasDeadline;
+    std::chrono::steady_clock::time_point deadline;
+
+    // Set if the command was completed without running or its result was discarded
+    CommandAbortReason abortReason;
+};
+
+// Executes the blocking SoftDevice RPC calls of one adapter on a dedicated thread.
+//
+// Commands are executed one at a time in the order they are queued. The completion callbacks
+// are run on the NodeJS thread through a single async handle, so an adapter waiting for a
+// response from the connectivity chip does not occupy the libuv threadpool.
+class CommandQueue
+{
+public:
+    CommandQueue(uv_loop_t *loop, TraceBuffer *traceBuffer, FlightRecorder *flightRecorder, HealthMonitor *healthMonitor);
+    ~CommandQueue();
+
+    // Must be called from the NodeJS thread. Commands not started when stopping are completed with an error.
+    void start();
+    void stop();
+
+    // Must be called from the NodeJS thread. Stops like stop(), but frees the commands not delivered yet without
+    // calling into JavaScript, their callbacks are never called and their promises never settled. For teardown,
+    // when JavaScript may not run anymore.
+    void abandon();
+
+    // Called from the NodeJS thread with true when a command is queued while none is outstanding, and with false
+    // when the last outstanding command has been delivered or abandoned
+    void setBusyHandler(std::function<void(const bool busy)> handler);
+
+    // Must be called from the NodeJS thread, work is run on the command thread and after on the NodeJS thread.
+    // req->data must point to the Baton of the command, name is used for tracing. Returns the id of the command.
+    // Work that opens, closes or resets the transport must be queued as COMMAND_KIND_LIFECYCLE.
+    uint32_t enqueue(uv_work_t *req, uv_work_cb work, uv_after_work_cb after, const char *name, const CommandKind kind = COMMAND_KIND_RPC);
+
+    // Id of the last command queued, 0 if none. Must be called from the NodeJS thread.
+    uint32_t getLastId() const;
+
+    // Timeout applied to RPC commands when they are queued, 0 for none
+    void setDefaultTimeout(const uint32_t timeout);
+
+    // Sets the deadline of a queued or running command relative to now. A command that times out before it is
+    // started is completed without being run. A running RPC can not be interrupted, if it times out its result is
+    // replaced by a timeout error when it returns. Returns false if the command is not a queued or running RPC command.
+    bool setTimeout(const uint32_t id, const uint32_t timeout);
+
+    // Removes an RPC command that is not started yet, its callback is called with an error.
+    // Returns false if the command is running, completed, unknown or a lifecycle command.
+    bool cancel(const uint32_t id);
+
+    // If set, the callbacks of the commands completed in one wakeup are passed to this callback as one array
+    // of {id, callback, args} instead of being called one by one. Must be called from the NodeJS thread.
+    void setCompletionCallback(Nan::Callback *callback);
+
+    void onCompleted(uv_async_t *handle);
+    void onDeadline(uv_timer_t *handle);
+
+    // Statistics:
+    uint32_t getDepth();
+    uint32_t getMaxDepth();
+    uint32_t getCommandCount();
+    uint32_t getTimedOutCount();
+    uint32_t getCancelledCount();
+    double getAverageCompletionBatchCount();
+    double getAverageWaitTime();
+    double getMaxWaitTime();
+
+private:
+    static void threadMain(void *arg);
+    void run();
+
+    void completeEntries(std::deque<CommandEntry> &entries, CompletionBatch *batch);
+    void joinThread();
+    void closeHandles();
+
+    // Must be called with mutex locked
+    void abortEntry(CommandEntry &entry, const CommandAbortReason reason);
+    void startDeadlineTimer();
+
+    uv_loop_t *loop;
+    TraceBuffer *traceBuffer;
+    FlightRecorder *flightRecorder;
+    HealthMonitor *healthMonitor;
+    uv_thread_t thread;
+    uv_mutex_t mutex;
+    uv_cond_t condition;
+    uv_async_t *asyncCompleted;
+    uv_timer_t *deadlineTimer;
+
+    std::deque<CommandEntry> pending;
+    std::deque<CommandEntry> completed;
+
+    // The command being run by the command thread, protected by mutex
+    bool inFlight;
+    CommandEntry inFlightEntry;
+
+    bool running;
+
+    // Set while stop() completes the commands that were not started
+    bool stopping;
+
+    Nan::Callback *completionCallback;
+    std::function<void(const bool busy)> busyHandler;
+
+    // Only accessed from the NodeJS thread:
+    // Number of commands queued but not delivered to JavaScript yet
+    uint32_t outstanding;
+    uint32_t nextId;
+    uint32_t defaultTimeout;
+    uint32_t completionBatchNumber;
+    uint32_t completionBatchEntryTotalCount;
+
+    // Statistics, protected by mutex:
+    uint32_t maxDepth;
+
+    // Number of commands taken from the queue and the time they waited there
+    uint32_t commandCount;
+    std::chrono::microseconds waitTimeTotal;
+    std::chrono::microseconds waitTimeMax;
+
+    uint32_t timedOutCount;
+    uint32_t cancelledCount;
+};
+
+#endif // COMMAND_QUEUE_H
@@ -154,6 +154,120 @@ static name_map_t hci_status_map =
     NAME_MAP_ENTRY(BLE_HCI_CONN_FAILED_TO_BE_ESTABLISHED)
 };
 
+v8::Local<v8::Value> Baton::returnValue()
+{
+    Nan::EscapableHandleScope scope;
+
+    if (resolver == nullptr)
+    {
+        return scope.Escape(ConversionUtility::toJsNumber(id));
+    }
+
+    // The id is kept on the promise so that the command can still be cancelled
+    auto promise = Nan::New(*resolver)->GetPromise();
+    Utility::Set(promise, "commandId", id);
+
+    return scope.Escape(promise);
+}
+
+// Rejects with the error argument if it is set. Otherwise resolves with the remaining argument,
+// or an array of them if there are several. Only the error position is checked, other arguments may be errors.
+void Baton::settle(const int argc, v8::Local<v8::Value> argv[])
+{
+    auto context = Nan::GetCurrentContext();
+    auto promiseResolver = Nan::New(*resolver);
+
+    auto errorIndex = errorLast ? argc - 1 : 0;
+
+    if (argc > 0 && !argv[errorIndex]->IsUndefined() && !argv[errorIndex]->IsNull())
+    {
+        promiseResolver->Reject(context, argv[errorIndex]).FromJust();
+        return;
+    }
+
+    auto first = errorLast ? 0 : 1;
+    auto last = errorLast ? argc - 2 : argc - 1;
+
+    v8::Local<v8::Value> value = Nan::Undefined();
+
+    if (last == first)
+    {
+        value = argv[first];
+    }
+    else if (last > first)
+    {
+        auto values = Nan::New<v8::Array>(last - first + 1);
+
+        for (auto i = first; i <= last; ++i)
+        {
+            Nan::Set(values, i - first, argv[i]);
+        }
+
+        value = values;
+    }
+
+    promiseResolver->Resolve(context, value).FromJust();
+}
+
+void Baton::deliver(const int argc, v8::Local<v8::Value> argv[])
+{
+    if (abortReason != COMMAND_NOT_ABORTED || completedLate)
+    {
+        // Tell the caller why the command failed without reaching the SoftDevice or that its error arrived late
+        for (auto i = 0; i < argc; ++i)
+        {
+            if (!argv[i]->IsObject() || !Utility::Has(argv[i].As<v8::Object>(), "errno"))
+            {
+                continue;
+            }
+
+            auto error = argv[i].As<v8::Object>();
+
+            if (abortReason == COMMAND_CANCELLED)
+            {
+                Utility::Set(error, "cancelled", true);
+            }
+            else
+            {
+                Utility::Set(error, "timeoutStage", completedLate ? "inFlight" : "queued");
+            }
+        }
+    }
+
+    if (resolver != nullptr)
+    {
+        settle(argc, argv);
+
+        if (batch != nullptr)
+        {
+            batch->settledCount += 1;
+        }
+
+        return;
+    }
+
+    if (batch == nullptr || batch->immediate)
+    {
+        callback->Call(argc, argv);
+        return;
+    }
+
+    auto args = Nan::New<v8::Array>(argc);
+
+    for (auto i = 0; i < argc; ++i)
+    {
+        Nan::Set(args, i, argv[i]);
+    }
+
+    auto entry = Nan::New<v8::Object>();
+    Utility::Set(entry, "id", id);
+    Utility::Set(entry, "callback", callback->GetFunction());
+    Utility::Set(entry, "args", args);
+
+    Nan::Set(batch->entries, batch->count, entry);
+    batch->count += 1;
+}
+
 const std::string getCurrentTimeInMilliseconds()
 {
     auto current_time = std::chrono::system_clock::now();
@@ -576,6 +690,16 @@ v8::Local<v8::Function> ConversionUtility::getCallbackFunction(v8::Local<v8::Obj
     return ConversionUtility::getCallbackFunction(obj);
 }
 
+v8::Local<v8::Function> ConversionUtility::getOptionalCallbackFunction(v8::Local<v8::Value> js)
+{
+    if (js->IsUndefined())
+    {
+        return v8::Local<v8::Function>();
+    }
+
+    return ConversionUtility::getCallbackFunction(js);
+}
+
 v8::Local<v8::Function> ConversionUtility::getCallbackFunction(v8::Local<v8::Value> js)
 {
     Nan::EscapableHandleScope scope;
@@ -168,27 +168,95 @@ public:
     virtual const char *getEventName() = 0;
 };
 
+// Why a command was completed without running.
+// COMMAND_TIMEOUT_IN_FLIGHT is only recorded for commands that ran past their deadline, their result is delivered.
+enum CommandAbortReason
+{
+    COMMAND_NOT_ABORTED,
+    COMMAND_CANCELLED,
+    COMMAND_TIMEOUT_QUEUED,
+    COMMAND_TIMEOUT_IN_FLIGHT
+};
+
+// Callbacks of commands completed in the same wakeup, delivered to JavaScript in a single call
+struct CompletionBatch
+{
+public:
+    v8::Local<v8::Array> entries;
+    uint32_t count;
+
+    // Callbacks are called directly instead of being added to entries
+    bool immediate;
+
+    // Number of promises resolved or rejected, they need a microtask checkpoint to run their reactions
+    uint32_t settledCount;
+};
+
 struct Baton
 {
 public:
+    // If cb is empty the command settles a promise instead of calling a callback
     explicit Baton(v8::Local<v8::Function> cb)
     {
         req = new uv_work_t();
-        callback = new Nan::Callback(cb);
         req->data = static_cast<void*>(this);
+        id = 0;
+        batch = nullptr;
+        abortReason = COMMAND_NOT_ABORTED;
+        completedLate = false;
+        errorLast = false;
+
+        if (cb.IsEmpty())
+        {
+            callback = nullptr;
+            resolver = new Nan::Persistent<v8::Promise::Resolver>(v8::Promise::Resolver::New(Nan::GetCurrentContext()).ToLocalChecked());
+        }
+        else
+        {
+            callback = new Nan::Callback(cb);
+            resolver = nullptr;
+        }
     }
 
-    ~Baton()
+    // Batons are freed through this type when their command is abandoned
+    virtual ~Baton()
     {
         delete req;
         delete callback;
+
+        if (resolver != nullptr)
+        {
+            resolver->Reset();
+            delete resolver;
+        }
     }
 
+    // Calls the callback, or appends it to the batch if the command is completed as part of one.
+    // Settles the promise if the command was issued without a callback.
+    void deliver(const int argc, v8::Local<v8::Value> argv[]);
+
+    // Value returned to JavaScript when the command is issued: the promise of the command, or its id
+    v8::Local<v8::Value> returnValue();
+
     uv_work_t *req;
     Nan::Callback *callback;
+    Nan::Persistent<v8::Promise::Resolver> *resolver;
 
     int result;
     adapter_t *adapter;
+
+    uint32_t id;
+    CompletionBatch *batch;
+    CommandAbortReason abortReason;
+
+    // Set if the command ran past its deadline, its result is delivered as is
+    bool completedLate;
+
+    // Set by commands whose callback takes the error as its last argument instead of its first
+    bool errorLast;
+
+private:
+    void settle(const int argc, v8::Local<v8::Value> argv[]);
 };
 
 const std::string getCurrentTimeInMilliseconds();
@@ -328,6 +396,9 @@ public:
     static v8::Local<v8::Function> getCallbackFunction(v8::Local<v8::Object> js, const char *name);
     static v8::Local<v8::Function> getCallbackFunction(v8::Local<v8::Value> js);
 
+    // Returns an empty handle if js is undefined, the command then returns a promise
+    static v8::Local<v8::Function> getOptionalCallbackFunction(v8::Local<v8::Value> js);
+
     static uint8_t extractHexHelper(char text);
     static uint8_t *extractHex(v8::Local<v8::Value> js);
     static v8::Handle<v8::Value> encodeHex(const char *text, int length);
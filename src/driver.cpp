@@ -34,13 +34,20 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <algorithm>
+#include <vector>
 
 #include "sd_rpc.h"
 #include "adapter.h"
+#include "adapter_pool.h"
 
 #include "serialadapter.h"
 #include "driver.h"
@@ -52,9 +59,6 @@
 
 using namespace std;
 
-// Variable to use to handle callbacks while device is opened and the corresponding callbacks is not fully operational
-Adapter *adapterBeingOpened = nullptr;
-
 // Macro for keeping sanity in event switch case below
 #define COMMON_EVT_CASE(evt_enum, evt_to_js, params_name, event_array, event_array_idx, eventEntry) \
     case BLE_EVT_##evt_enum:                                                                                         \
@@ -113,74 +117,130 @@ static name_map_t uuid_type_name_map = {
 // This function is ran by the thread that the SoftDevice Driver has initiated
 void sd_rpc_on_log_event(adapter_t *adapter, sd_rpc_log_severity_t severity, const char *log_message)
 {
-    auto logEntry = new LogEntry();
-    logEntry->message = std::string(log_message);
-    logEntry->severity = severity;
-
-    auto jsAdapter = Adapter::getAdapter(adapter, adapterBeingOpened);
+    auto lease = Adapter::acquireAdapter(adapter);
+    auto jsAdapter = lease.get();
 
+    // Callbacks that race with the adapter being closed are dropped
     if (jsAdapter != nullptr)
     {
-        jsAdapter->appendLog(logEntry);
-    }
-    else
-    {
-        std::cerr << "No AddOn adapter to process log event." << std::endl;
-        std::terminate();
+        jsAdapter->appendLog(severity, log_message);
     }
 }
 
-void Adapter::appendLog(LogEntry *log)
+void Adapter::appendLog(sd_rpc_log_severity_t severity, const char *message)
 {
-    if (asyncLog != nullptr)
+    // The flight recorder keeps every line, also those over the rate limit
+    flightRecorder.record(FLIGHT_RECORD_LOG, static_cast<uint8_t>(severity), 0, 0, message);
+
+    // Only the first line of a batch is announced in the notification queue, later lines are picked up with it.
+    // If the queue is full the lines are picked up at the end of the next wakeup.
+    if (asyncNotification != nullptr && logBuffer.append(severity, message))
     {
-        logQueue.push(log);
-        uv_async_send(asyncLog);
+        Notification notification;
+        notification.kind = NOTIFICATION_LOG;
+        notification.event = nullptr;
+        notification.status = nullptr;
+
+        notificationQueue.push(notification, false);
+        uv_async_send(asyncNotification);
     }
 }
 
-// Now we are in the NodeJS thread. Call callbacks.
-void Adapter::onLogEvent(uv_async_t *handle)
+// This runs in the NodeJS thread
+void Adapter::deliverLogs()
 {
-    Nan::HandleScope scope;
+    logBuffer.take(logBatch);
 
-    while (!logQueue.wasEmpty())
+    if (logBatch.lines.empty() && logBatch.droppedCount == 0)
     {
-        LogEntry *logEntry;
-        logQueue.pop(logEntry);
+        return;
+    }
 
-        if (logCallback != nullptr)
-        {
-            v8::Local<v8::Value> argv[2];
-            argv[0] = ConversionUtility::toJsNumber(static_cast<int>(logEntry->severity));
-            argv[1] = ConversionUtility::toJsString(logEntry->message);
-            logCallback->Call(2, argv);
-        }
-        else
-        {
-            std::cerr << "Log event received, but no callback is registered." << std::endl;
-        }
+    if (logCallback == nullptr)
+    {
+        std::cerr << "Log event received, but no callback is registered." << std::endl;
+        return;
+    }
 
-        // Free memory for current entry, we remove the element from the deque when the iteration is done
-        delete logEntry;
+    // One call per wakeup, the lines are passed as parallel arrays
+    auto count = static_cast<uint32_t>(logBatch.lines.size());
+    v8::Local<v8::Array> severities = Nan::New<v8::Array>(count);
+    v8::Local<v8::Array> messages = Nan::New<v8::Array>(count);
+    v8::Local<v8::Array> timestamps = Nan::New<v8::Array>(count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto &line = logBatch.lines[i];
+        Nan::Set(severities, i, Nan::New<v8::Integer>(static_cast<int32_t>(line.severity)));
+        Nan::Set(messages, i, Nan::New<v8::String>(logBatch.text.data() + line.offset, static_cast<int>(line.length)).ToLocalChecked());
+        Nan::Set(timestamps, i, Nan::New<v8::Number>(line.timestamp));
     }
+
+    v8::Local<v8::Value> argv[4];
+    argv[0] = severities;
+    argv[1] = messages;
+    argv[2] = timestamps;
+    argv[3] = ConversionUtility::toJsNumber(logBatch.droppedCount);
+    logCallback->Call(4, argv);
 }
 
 // Sends events upstream
 void Adapter::dispatchEvents()
 {
     // Trigger callback in NodeJS thread to call NodeJS callbacks
-    if (asyncEvent != nullptr)
+    if (asyncNotification != nullptr)
     {
-        uv_async_send(asyncEvent);
+        uv_async_send(asyncNotification);
     }
     else
     {
-        std::cerr << "Adapter::dispatchEvents() asyncEvent is nullptr!" << std::endl;
+        std::cerr << "Adapter::dispatchEvents() asyncNotification is nullptr!" << std::endl;
         std::terminate();
     }
 }
 
+// Now we are in the NodeJS thread. Call callbacks.
+// Events, statuses and log lines are delivered in the order they were queued, consecutive events in one call.
+void Adapter::onNotification(uv_async_t *handle)
+{
+    Nan::HandleScope scope;
+
+    std::vector<EventEntry *> events;
+    Notification notification;
+
+    while (notificationQueue.pop(notification))
+    {
+        if (notification.kind == NOTIFICATION_EVENT)
+        {
+            events.push_back(notification.event);
+            continue;
+        }
+
+        if (!events.empty())
+        {
+            deliverEvents(events);
+            events.clear();
+        }
+
+        if (notification.kind == NOTIFICATION_STATUS)
+        {
+            deliverStatus(notification.status);
+        }
+        else
+        {
+            deliverLogs();
+        }
+    }
+
+    if (!events.empty())
+    {
+        deliverEvents(events);
+    }
+
+    // Lines whose announcement did not fit in the queue
+    deliverLogs();
+}
+
 void Adapter::eventIntervalCallback(uv_timer_t *handle)
 {
     dispatchEvents();
@@ -195,21 +255,195 @@ static void sd_rpc_on_event(adapter_t *adapter, ble_evt_t *event)
         return;
     }
 
-    auto jsAdapter = Adapter::getAdapter(adapter, adapterBeingOpened);
+    auto lease = Adapter::acquireAdapter(adapter);
+    auto jsAdapter = lease.get();
 
+    // Callbacks that race with the adapter being closed are dropped
     if (jsAdapter != nullptr)
     {
         jsAdapter->appendEvent(event);
     }
-    else
+}
+
+static const char *traceEventName(const uint16_t evt_id)
+{
+    if (evt_id >= BLE_GAP_EVT_BASE && evt_id <= BLE_GAP_EVT_LAST)
     {
-        std::cerr << "No AddOn adapter to process BLE event." << std::endl;
-        std::terminate();
+        return ConversionUtility::valueToString(evt_id, gap_event_name_map, "Unknown Gap Event");
+    }
+
+    if (evt_id >= BLE_GATTC_EVT_BASE && evt_id <= BLE_GATTC_EVT_LAST)
+    {
+        return ConversionUtility::valueToString(evt_id, gattc_event_name_map, "Unknown Gattc Event");
+    }
+
+    if (evt_id >= BLE_GATTS_EVT_BASE && evt_id <= BLE_GATTS_EVT_LAST)
+    {
+        return ConversionUtility::valueToString(evt_id, gatts_event_name_map, "Unknown Gatts Event");
+    }
+
+    return ConversionUtility::valueToString(evt_id, common_event_name_map, "Unknown Common Event");
+}
+
+// The address type is kept above the address, a public and a random address with the same bytes are different peers
+static uint64_t addressToKey(const uint64_t address, const uint8_t addrType)
+{
+    return (static_cast<uint64_t>(addrType) << (8 * BLE_GAP_ADDR_LEN)) | address;
+}
+
+static uint64_t addressToKey(const ble_gap_addr_t &address)
+{
+    uint64_t key = 0;
+
+    for (auto i = BLE_GAP_ADDR_LEN; i > 0; --i)
+    {
+        key = (key << 8) | address.addr[i - 1];
+    }
+
+    return addressToKey(key, address.addr_type);
+}
+
+// This runs in the driver thread
+void Adapter::updateLinkState(const ble_evt_t *event)
+{
+    std::lock_guard<std::mutex> lock(linkStateMutex);
+
+    switch (event->header.evt_id)
+    {
+        case BLE_GAP_EVT_ADV_REPORT:
+        {
+            auto &report = event->evt.gap_evt.params.adv_report;
+            auto key = addressToKey(report.peer_addr);
+            auto it = peerSightings.find(key);
+
+            if (it != peerSightings.end())
+            {
+                peerSightingAge.splice(peerSightingAge.begin(), peerSightingAge, it->second.age);
+            }
+            else
+            {
+                if (peerSightings.size() >= PEER_SIGHTINGS_MAX)
+                {
+                    peerSightings.erase(peerSightingAge.back());
+                    peerSightingAge.pop_back();
+                }
+
+                peerSightingAge.push_front(key);
+                it = peerSightings.emplace(key, PeerSighting()).first;
+                it->second.age = peerSightingAge.begin();
+            }
+
+            it->second.rssi = report.rssi;
+            it->second.heard = std::chrono::steady_clock::now();
+            break;
+        }
+        case BLE_GAP_EVT_CONNECTED:
+            connectionCount += 1;
+
+            if (event->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_CENTRAL && pendingConnectCount > 0)
+            {
+                pendingConnectCount -= 1;
+            }
+            break;
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (connectionCount > 0)
+            {
+                connectionCount -= 1;
+            }
+            break;
+        case BLE_GAP_EVT_TIMEOUT:
+            if (event->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_CONN && pendingConnectCount > 0)
+            {
+                pendingConnectCount -= 1;
+            }
+            break;
+        case BLE_GAP_EVT_RSSI_CHANGED:
+            // Moving average over the connections of the adapter
+            connectionRssi = connectionRssi == 0 ? event->evt.gap_evt.params.rssi_changed.rssi
+                : connectionRssi * 0.9 + event->evt.gap_evt.params.rssi_changed.rssi * 0.1;
+            break;
+        default:
+            break;
+    }
+}
+
+void Adapter::connectAttemptStarted()
+{
+    std::lock_guard<std::mutex> lock(linkStateMutex);
+    pendingConnectCount += 1;
+}
+
+void Adapter::connectAttemptEnded()
+{
+    std::lock_guard<std::mutex> lock(linkStateMutex);
+
+    if (pendingConnectCount > 0)
+    {
+        pendingConnectCount -= 1;
+    }
+}
+
+uint32_t Adapter::getConnectionCount()
+{
+    std::lock_guard<std::mutex> lock(linkStateMutex);
+    return connectionCount;
+}
+
+uint32_t Adapter::getPendingConnectCount()
+{
+    std::lock_guard<std::mutex> lock(linkStateMutex);
+    return pendingConnectCount;
+}
+
+double Adapter::getConnectionRssi()
+{
+    std::lock_guard<std::mutex> lock(linkStateMutex);
+    return connectionRssi;
+}
+
+bool Adapter::getPeerSighting(const uint64_t address, const int addrType, PeerSighting *sighting)
+{
+    std::lock_guard<std::mutex> lock(linkStateMutex);
+    auto found = false;
+
+    for (auto type = BLE_GAP_ADDR_TYPE_PUBLIC; type <= BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_NON_RESOLVABLE; type++)
+    {
+        if (addrType >= 0 && type != addrType)
+        {
+            continue;
+        }
+
+        auto it = peerSightings.find(addressToKey(address, static_cast<uint8_t>(type)));
+
+        if (it != peerSightings.end() && (!found || it->second.heard > sighting->heard))
+        {
+            *sighting = it->second;
+            found = true;
+        }
     }
+
+    return found;
+}
+
+void Adapter::resetLinkState()
+{
+    std::lock_guard<std::mutex> lock(linkStateMutex);
+
+    connectionCount = 0;
+    pendingConnectCount = 0;
+    connectionRssi = 0;
+    peerSightings.clear();
+    peerSightingAge.clear();
 }
 
 void Adapter::appendEvent(ble_evt_t *event)
 {
+    updateLinkState(event);
+
+    healthMonitor.recordEvent(event->header.evt_len);
+    flightRecorder.record(FLIGHT_RECORD_EVENT, 0, event->header.evt_id, 0,
+                          event, std::min<size_t>(sizeof(ble_evt_hdr_t) + event->header.evt_len, 512));
+
     eventCallbackCount += 1;
     eventCallbackBatchEventCounter += 1;
 
@@ -228,33 +462,84 @@ void Adapter::appendEvent(ble_evt_t *event)
     auto eventEntry = new EventEntry();
     eventEntry->event = static_cast<ble_evt_t*>(evt);
     eventEntry->timestamp = getCurrentTimeInMilliseconds();
+    eventEntry->traceId = 0;
+    eventEntry->traceName = nullptr;
+    eventEntry->autoReplied = false;
+
+    // Requests that need OOB data are left to JavaScript, it must set the OOB data before replying
+    if (event->header.evt_id == BLE_GAP_EVT_LESC_DHKEY_REQUEST && !event->evt.gap_evt.params.lesc_dhkey_request.oobd_req)
+    {
+        auto request = &event->evt.gap_evt.params.lesc_dhkey_request;
+        auto peerPk = request->p_pk_peer != nullptr ? request->p_pk_peer->pk : nullptr;
 
-    eventQueue.push(eventEntry);
+        eventEntry->autoReplied = lescResponder.submit(event->evt.gap_evt.conn_handle, peerPk);
+    }
 
-    // If the event interval is not set, send the events to NodeJS as soon as possible.
-    if (eventInterval == 0)
+    // Reconnecting bonded peers get their keys without waiting for JavaScript
+    if (event->header.evt_id == BLE_GAP_EVT_SEC_INFO_REQUEST)
+    {
+        eventEntry->autoReplied = replySecurityInfo(event->evt.gap_evt.conn_handle, &event->evt.gap_evt.params.sec_info_request);
+    }
+
+    if (traceBuffer.isEnabled())
+    {
+        static thread_local bool threadNamed = false;
+
+        if (!threadNamed)
+        {
+            traceBuffer.nameThread("driver");
+            threadNamed = true;
+        }
+
+        eventEntry->traceId = traceBuffer.nextEventId();
+        eventEntry->traceName = traceEventName(event->header.evt_id);
+        traceBuffer.record(TRACE_EVENT_RECEIVED, eventEntry->traceName, eventEntry->traceId);
+    }
+
+    // Do not wait for the event interval if the queue is full
+    if (eventInterval != 0 && notificationQueue.wasFull())
     {
         dispatchEvents();
     }
-}
 
-// Now we are in the NodeJS thread. Call callbacks.
-void Adapter::onRpcEvent(uv_async_t *handle)
-{
-    Nan::HandleScope scope;
+    auto traceId = eventEntry->traceId;
+    auto traceName = eventEntry->traceName;
 
-    if (eventQueue.wasEmpty())
+    Notification notification;
+    notification.kind = NOTIFICATION_EVENT;
+    notification.event = eventEntry;
+    notification.status = nullptr;
+
+    // Blocks the driver thread until there is room in the queue
+    if (!notificationQueue.push(notification, true))
     {
+        free(eventEntry->event);
+        delete eventEntry;
         return;
     }
 
+    // The entry may already be consumed by the NodeJS thread
+    if (traceId != 0)
+    {
+        traceBuffer.record(TRACE_EVENT_QUEUED, traceName, traceId);
+    }
+
+    // If the event interval is not set, send the events to NodeJS as soon as possible.
+    if (eventInterval == 0)
+    {
+        dispatchEvents();
+    }
+}
+
+// This runs in the NodeJS thread
+void Adapter::deliverEvents(std::vector<EventEntry *> &entries)
+{
     auto array = Nan::New<v8::Array>();
     auto arrayIndex = 0;
+    std::vector<std::pair<uint32_t, const char *>> tracedEvents;
 
-    while (!eventQueue.wasEmpty())
+    for (auto eventEntry : entries)
     {
-        EventEntry *eventEntry = nullptr;
-        eventQueue.pop(eventEntry);
 
         if (eventEntry == nullptr)
         {
@@ -262,6 +547,12 @@ void Adapter::onRpcEvent(uv_async_t *handle)
             std::terminate();
         }
 
+        if (eventEntry->traceId != 0)
+        {
+            traceBuffer.record(TRACE_EVENT_DISPATCHED, eventEntry->traceName, eventEntry->traceId);
+            tracedEvents.push_back(std::make_pair(eventEntry->traceId, eventEntry->traceName));
+        }
+
         auto event = eventEntry->event;
         if (eventEntry == nullptr)
         {
@@ -269,6 +560,15 @@ void Adapter::onRpcEvent(uv_async_t *handle)
             std::terminate();
         }
 
+        if (event->header.evt_id == BLE_GAP_EVT_CONNECTED)
+        {
+            connectionAddresses[event->evt.gap_evt.conn_handle] = event->evt.gap_evt.params.connected.peer_addr;
+        }
+        else if (event->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+        {
+            connectionAddresses.erase(event->evt.gap_evt.conn_handle);
+        }
+
         if (eventCallback != nullptr)
         {
             switch (event->header.evt_id)
@@ -330,6 +630,12 @@ void Adapter::onRpcEvent(uv_async_t *handle)
             }
 
             //Special extra handling of some events:
+            if (event->header.evt_id == BLE_GAP_EVT_LESC_DHKEY_REQUEST || event->header.evt_id == BLE_GAP_EVT_SEC_INFO_REQUEST)
+            {
+                v8::Local<v8::Object> obj = Utility::Get(array, arrayIndex)->ToObject();
+                Utility::Set(obj, "auto_replied", eventEntry->autoReplied);
+            }
+
             if (event->header.evt_id == BLE_GAP_EVT_AUTH_STATUS)
             {
                 auto keyset = getSecurityKey(event->evt.gap_evt.conn_handle);
@@ -338,10 +644,12 @@ void Adapter::onRpcEvent(uv_async_t *handle)
 
                 if (keyset != 0)
                 {
+                    Utility::Set(obj, "bond_store_pending", storeBond(event->evt.gap_evt.conn_handle, &event->evt.gap_evt.params.auth_status, keyset));
                     Utility::Set(obj, "keyset", static_cast<v8::Handle<v8::Value>>(GapSecKeyset(keyset)));
                 }
                 else
                 {
+                    Utility::Set(obj, "bond_store_pending", false);
                     Utility::Set(obj, "keyset", Nan::Null());
                 }
 
@@ -356,14 +664,16 @@ void Adapter::onRpcEvent(uv_async_t *handle)
         delete eventEntry;
     }
 
-    v8::Local<v8::Value> callback_value[1];
+    // Tells JavaScript whether rendering the events as debug log text is worth it
+    v8::Local<v8::Value> callback_value[2];
     callback_value[0] = array;
+    callback_value[1] = Nan::New<v8::Boolean>(hasDebugLogConsumers());
 
     auto start = chrono::high_resolution_clock::now();
 
     if (eventCallback != nullptr)
     {
-        eventCallback->Call(1, callback_value);
+        eventCallback->Call(2, callback_value);
     }
     else
     {
@@ -372,6 +682,11 @@ void Adapter::onRpcEvent(uv_async_t *handle)
 
     auto end = chrono::high_resolution_clock::now();
 
+    for (auto &tracedEvent : tracedEvents)
+    {
+        traceBuffer.record(TRACE_EVENT_HANDLED, tracedEvent.second, tracedEvent.first);
+    }
+
     auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
     addEventBatchStatistics(duration);
 }
@@ -383,48 +698,57 @@ static void sd_rpc_on_status(adapter_t *adapter, sd_rpc_app_status_t id, const c
     statusEntry->id = id;
     statusEntry->message = std::string(message);
 
-    auto jsAdapter = Adapter::getAdapter(adapter, adapterBeingOpened);
+    auto lease = Adapter::acquireAdapter(adapter);
+    auto jsAdapter = lease.get();
 
+    // Callbacks that race with the adapter being closed are dropped
     if (jsAdapter != nullptr)
     {
         jsAdapter->appendStatus(statusEntry);
     }
     else
     {
-        std::cerr << "No AddOn adapter to process BLE status event." << std::endl;
-        std::terminate();
+        delete statusEntry;
     }
 }
 
 void Adapter::appendStatus(StatusEntry *status)
 {
-    if (asyncStatus != nullptr)
+    healthMonitor.recordStatus(status->id);
+    flightRecorder.record(FLIGHT_RECORD_STATUS, 0, static_cast<uint32_t>(status->id), 0, status->message.c_str());
+
+    if (status->id == CONNECTION_ACTIVE)
     {
-        statusQueue.push(status);
-        uv_async_send(asyncStatus);
+        std::lock_guard<std::mutex> lock(statusMutex);
+        connectionActiveCount += 1;
+        statusCondition.notify_all();
     }
-}
 
-// Now we are in the NodeJS thread. Call callbacks.
-void Adapter::onStatusEvent(uv_async_t *handle)
-{
-    Nan::HandleScope scope;
+    Notification notification;
+    notification.kind = NOTIFICATION_STATUS;
+    notification.event = nullptr;
+    notification.status = status;
 
-    while (!statusQueue.wasEmpty())
+    if (asyncNotification == nullptr || !notificationQueue.push(notification, true))
     {
-        StatusEntry *statusEntry;
-        statusQueue.pop(statusEntry);
+        delete status;
+        return;
+    }
 
-        if (statusCallback != nullptr)
-        {
-            v8::Local<v8::Value> argv[1];
-            argv[0] = StatusMessage::getStatus(statusEntry->id, statusEntry->message, statusEntry->timestamp);
-            statusCallback->Call(1, argv);
-        }
+    uv_async_send(asyncNotification);
+}
 
-        // Free memory for current entry, we remove the element from the deque when the iteration is done
-        delete statusEntry;
+// This runs in the NodeJS thread
+void Adapter::deliverStatus(StatusEntry *statusEntry)
+{
+    if (statusCallback != nullptr)
+    {
+        v8::Local<v8::Value> argv[1];
+        argv[0] = StatusMessage::getStatus(statusEntry->id, statusEntry->message, statusEntry->timestamp);
+        statusCallback->Call(1, argv);
     }
+
+    delete statusEntry;
 }
 
 v8::Local<v8::Object> CommonTXCompleteEvent::ToJs()
@@ -505,7 +829,7 @@ NAN_METHOD(Adapter::EnableBLE)
         enableObject = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -517,6 +841,7 @@ NAN_METHOD(Adapter::EnableBLE)
 
     auto baton = new EnableBLEBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
 
     try
     {
@@ -529,7 +854,8 @@ NAN_METHOD(Adapter::EnableBLE)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, EnableBLE, reinterpret_cast<uv_after_work_cb>(AfterEnableBLE));
+    obj->commandQueue->enqueue(baton->req, EnableBLE, reinterpret_cast<uv_after_work_cb>(AfterEnableBLE), "EnableBLE");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -537,6 +863,18 @@ void Adapter::EnableBLE(uv_work_t *req)
 {
     auto baton = static_cast<EnableBLEBaton *>(req->data);
     baton->result = sd_ble_enable(baton->adapter, baton->enable_params, &baton->app_ram_base);
+
+    // Enabling the SoftDevice starts a new configuration
+    if (baton->result == NRF_SUCCESS)
+    {
+        clearConfiguration(baton->adapter);
+
+        auto enable_params = *baton->enable_params;
+        recordConfiguration(baton->adapter, "EnableBLE", [=](adapter_t *adapter) mutable {
+            uint32_t app_ram_base;
+            return sd_ble_enable(adapter, &enable_params, &app_ram_base);
+        });
+    }
 }
 
 // This runs in  Main Thread
@@ -545,6 +883,9 @@ void Adapter::AfterEnableBLE(uv_work_t *req)
     Nan::HandleScope scope;
     auto baton = static_cast<EnableBLEBaton *>(req->data);
 
+    // Enabling the SoftDevice clears its configuration
+    baton->mainObject->clearConfigurationCache();
+
     v8::Local<v8::Value> argv[3];
 
     if (baton->result != NRF_SUCCESS)
@@ -560,63 +901,277 @@ void Adapter::AfterEnableBLE(uv_work_t *req)
         argv[2] = ConversionUtility::toJsNumber(baton->app_ram_base);
     }
 
-    baton->callback->Call(3, argv);
+    baton->deliver(3, argv);
     delete baton->enable_params;
     delete baton;
 }
 
 // This function runs in the Main Thread
-NAN_METHOD(Adapter::Open)
+static std::vector<uint8_t> getInitScriptBytes(v8::Local<v8::Object> step, const char *name)
 {
-    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    std::string path;
-    v8::Local<v8::Object> options;
-    v8::Local<v8::Function> callback;
-    auto argumentcount = 0;
+    if (!Utility::Has(step, name) || Utility::IsNull(step, name))
+    {
+        return std::vector<uint8_t>();
+    }
 
-    try
+    // Throws unless the property is an array, checked before the cast below
+    auto bytes = ConversionUtility::getNativePointerToUint8(step, name);
+    v8::Local<v8::Array> array = v8::Local<v8::Array>::Cast(Utility::Get(step, name));
+    auto data = std::vector<uint8_t>(bytes, bytes + array->Length());
+    free(bytes);
+
+    return data;
+}
+
+// Converts one entry of the init script given to Open, the operations are the commands used to bring up
+// an adapter and take the same parameters as these commands
+static InitScriptStep getInitScriptStep(v8::Local<v8::Object> step)
+{
+    auto op = ConversionUtility::getNativeString(step, "op");
+    InitScriptStep result;
+
+    if (op == "setBleOption")
     {
-        path = ConversionUtility::getNativeString(info[argumentcount]);
-        argumentcount++;
+        auto opt_id = ConversionUtility::getNativeUint32(step, "optId");
+        std::unique_ptr<ble_opt_t> opt(BleOpt(ConversionUtility::getJsObject(step, "option")));
+        auto option = *opt;
 
-        options = ConversionUtility::getJsObject(info[argumentcount]);
-        argumentcount++;
+        result.name = "SetBleOption";
+        result.run = [=](OpenBaton *baton) {
+            auto error_code = sd_ble_opt_set(baton->adapter, opt_id, &option);
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
-        argumentcount++;
+            if (error_code == NRF_SUCCESS)
+            {
+                Adapter::recordConfiguration(baton->adapter, "SetBleOption", std::to_string(opt_id), [=](adapter_t *adapter) {
+                    return sd_ble_opt_set(adapter, opt_id, &option);
+                });
+            }
+
+            return error_code;
+        };
     }
-    catch (std::string error)
+    else if (op == "addVendorSpecificUUID")
     {
-        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
-        Nan::ThrowTypeError(message);
-        return;
-    }
+        std::unique_ptr<ble_uuid128_t> uuid(BleUUID128(ConversionUtility::getJsObject(step, "uuid")));
+        auto vs_uuid = *uuid;
 
-    auto baton = new OpenBaton(callback);
-    baton->mainObject = obj;
-    baton->path = path;
+        result.name = "AddVendorSpecificUUID";
+        result.run = [=](OpenBaton *baton) {
+            uint8_t uuid_type;
+            auto error_code = sd_ble_uuid_vs_add(baton->adapter, &vs_uuid, &uuid_type);
 
-    auto parameter = 0;
+            if (error_code == NRF_SUCCESS)
+            {
+                baton->vendor_uuids.push_back(std::make_pair(uuid_type, vs_uuid));
+                Adapter::recordConfiguration(baton->adapter, "AddVendorSpecificUUID", [=](adapter_t *adapter) {
+                    uint8_t replayedType;
+                    auto replayResult = sd_ble_uuid_vs_add(adapter, &vs_uuid, &replayedType);
+                    return (replayResult == NRF_SUCCESS && replayedType != uuid_type) ? static_cast<uint32_t>(NRF_ERROR_INVALID_STATE) : replayResult;
+                });
+            }
 
-    try
-    {
-        baton->baud_rate = ConversionUtility::getNativeUint32(options, "baudRate"); parameter++;
-        baton->parity = ToParityEnum(Utility::Get(options, "parity")->ToString()); parameter++;
-        baton->flow_control = ToFlowControlEnum(Utility::Get(options, "flowControl")->ToString()); parameter++;
-        baton->evt_interval = ConversionUtility::getNativeUint32(options, "eventInterval"); parameter++;
-        baton->log_level = ToLogSeverityEnum(Utility::Get(options, "logLevel")->ToString()); parameter++;
-        baton->retransmission_interval = ConversionUtility::getNativeUint32(options, "retransmissionInterval"); parameter++;
-        baton->response_timeout = ConversionUtility::getNativeUint32(options, "responseTimeout"); parameter++;
-        baton->enable_ble = ConversionUtility::getBool(options, "enableBLE"); parameter++;
-        baton->ble_enable_params = EnableParameters(ConversionUtility::getJsObject(options, "enableBLEParams")); parameter++;
+            return error_code;
+        };
     }
-    catch (std::string error)
+    else if (op == "gapSetAddress")
     {
-        std::stringstream errormessage;
-        errormessage << "A setup option was wrong. Option: ";
-        const char *_options[] = {
-            "baudrate",
-            "parity",
+        std::unique_ptr<ble_gap_addr_t> addr(GapAddr(ConversionUtility::getJsObject(step, "address")));
+        auto address = *addr;
+
+#if NRF_SD_BLE_API_VERSION <= 2
+        uint8_t addr_cycle_mode = Utility::Has(step, "cycleMode") ? ConversionUtility::getNativeUint8(step, "cycleMode") : BLE_GAP_ADDR_CYCLE_MODE_NONE;
+
+        result.name = "GapSetAddress";
+        result.run = [=](OpenBaton *baton) {
+            auto error_code = sd_ble_gap_address_set(baton->adapter, addr_cycle_mode, &address);
+
+            if (error_code == NRF_SUCCESS)
+            {
+                Adapter::recordConfiguration(baton->adapter, "GapSetAddress", "", [=](adapter_t *adapter) {
+                    return sd_ble_gap_address_set(adapter, addr_cycle_mode, &address);
+                });
+            }
+
+            return error_code;
+        };
+#elif NRF_SD_BLE_API_VERSION >= 3
+        result.name = "GapSetAddress";
+        result.run = [=](OpenBaton *baton) {
+            auto error_code = sd_ble_gap_addr_set(baton->adapter, &address);
+
+            if (error_code == NRF_SUCCESS)
+            {
+                Adapter::recordConfiguration(baton->adapter, "GapSetAddress", "", [=](adapter_t *adapter) {
+                    return sd_ble_gap_addr_set(adapter, &address);
+                });
+            }
+
+            return error_code;
+        };
+#endif
+    }
+    else if (op == "gapSetDeviceName")
+    {
+        std::unique_ptr<ble_gap_conn_sec_mode_t> sec_mode(GapConnSecMode(ConversionUtility::getJsObject(step, "connSecMode")));
+        auto conn_sec_mode = *sec_mode;
+        auto deviceName = ConversionUtility::getNativeString(step, "name");
+        auto name = std::vector<uint8_t>(deviceName.begin(), deviceName.end());
+
+        result.name = "GapSetDeviceName";
+        result.run = [=](OpenBaton *baton) {
+            auto error_code = sd_ble_gap_device_name_set(baton->adapter, &conn_sec_mode, name.data(), static_cast<uint16_t>(name.size()));
+
+            if (error_code == NRF_SUCCESS)
+            {
+                Adapter::recordConfiguration(baton->adapter, "GapSetDeviceName", "", [=](adapter_t *adapter) {
+                    return sd_ble_gap_device_name_set(adapter, &conn_sec_mode, name.data(), static_cast<uint16_t>(name.size()));
+                });
+            }
+
+            return error_code;
+        };
+    }
+    else if (op == "gapSetPPCP")
+    {
+        std::unique_ptr<ble_gap_conn_params_t> params(GapConnParams(ConversionUtility::getJsObject(step, "connParams")));
+        auto conn_params = *params;
+
+        result.name = "GapSetPPCP";
+        result.run = [=](OpenBaton *baton) {
+            auto error_code = sd_ble_gap_ppcp_set(baton->adapter, &conn_params);
+
+            if (error_code == NRF_SUCCESS)
+            {
+                Adapter::recordConfiguration(baton->adapter, "GapSetPPCP", "", [=](adapter_t *adapter) {
+                    return sd_ble_gap_ppcp_set(adapter, &conn_params);
+                });
+            }
+
+            return error_code;
+        };
+    }
+    else if (op == "gapSetAppearance")
+    {
+        auto appearance = ConversionUtility::getNativeUint16(step, "appearance");
+
+        result.name = "GapSetAppearance";
+        result.run = [=](OpenBaton *baton) {
+            auto error_code = sd_ble_gap_appearance_set(baton->adapter, appearance);
+
+            if (error_code == NRF_SUCCESS)
+            {
+                Adapter::recordConfiguration(baton->adapter, "GapSetAppearance", "", [=](adapter_t *adapter) {
+                    return sd_ble_gap_appearance_set(adapter, appearance);
+                });
+            }
+
+            return error_code;
+        };
+    }
+    else if (op == "gapSetTXPower")
+    {
+        auto tx_power = ConversionUtility::getNativeInt8(step, "txPower");
+
+        result.name = "GapSetTXPower";
+        result.run = [=](OpenBaton *baton) {
+            auto error_code = sd_ble_gap_tx_power_set(baton->adapter, tx_power);
+
+            if (error_code == NRF_SUCCESS)
+            {
+                Adapter::recordConfiguration(baton->adapter, "GapSetTXPower", "", [=](adapter_t *adapter) {
+                    return sd_ble_gap_tx_power_set(adapter, tx_power);
+                });
+            }
+
+            return error_code;
+        };
+    }
+    else if (op == "gapSetAdvertisingData")
+    {
+        auto data = getInitScriptBytes(step, "data");
+        auto sr_data = getInitScriptBytes(step, "scanResponse");
+
+        result.name = "GapSetAdvertisingData";
+        result.run = [=](OpenBaton *baton) {
+            auto apply = [=](adapter_t *adapter) {
+                return sd_ble_gap_adv_data_set(adapter,
+                    data.empty() ? nullptr : data.data(), static_cast<uint8_t>(data.size()),
+                    sr_data.empty() ? nullptr : sr_data.data(), static_cast<uint8_t>(sr_data.size()));
+            };
+            auto error_code = apply(baton->adapter);
+
+            if (error_code == NRF_SUCCESS)
+            {
+                Adapter::recordConfiguration(baton->adapter, "GapSetAdvertisingData", "", apply);
+            }
+
+            return error_code;
+        };
+    }
+    else
+    {
+        throw std::string("unknown op ") + op;
+    }
+
+    return result;
+}
+
+NAN_METHOD(Adapter::Open)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    std::string path;
+    v8::Local<v8::Object> options;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        path = ConversionUtility::getNativeString(info[argumentcount]);
+        argumentcount++;
+
+        options = ConversionUtility::getJsObject(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new OpenBaton(callback);
+    baton->mainObject = obj;
+    baton->path = path;
+    baton->failed_step = nullptr;
+    baton->init_script_time = 0;
+
+    uint32_t flightRecorderSize = FLIGHT_RECORDER_DEFAULT_SIZE;
+    uint32_t healthReportInterval = 0;
+
+    auto parameter = 0;
+
+    try
+    {
+        baton->baud_rate = ConversionUtility::getNativeUint32(options, "baudRate"); parameter++;
+        baton->parity = ToParityEnum(Utility::Get(options, "parity")->ToString()); parameter++;
+        baton->flow_control = ToFlowControlEnum(Utility::Get(options, "flowControl")->ToString()); parameter++;
+        baton->evt_interval = ConversionUtility::getNativeUint32(options, "eventInterval"); parameter++;
+        baton->log_level = ToLogSeverityEnum(Utility::Get(options, "logLevel")->ToString()); parameter++;
+        baton->retransmission_interval = ConversionUtility::getNativeUint32(options, "retransmissionInterval"); parameter++;
+        baton->response_timeout = ConversionUtility::getNativeUint32(options, "responseTimeout"); parameter++;
+        baton->enable_ble = ConversionUtility::getBool(options, "enableBLE"); parameter++;
+        baton->ble_enable_params = EnableParameters(ConversionUtility::getJsObject(options, "enableBLEParams")); parameter++;
+    }
+    catch (std::string error)
+    {
+        std::stringstream errormessage;
+        errormessage << "A setup option was wrong. Option: ";
+        const char *_options[] = {
+            "baudrate",
+            "parity",
             "flowcontrol",
             "eventInterval",
             "logLevel",
@@ -630,6 +1185,8 @@ NAN_METHOD(Adapter::Open)
         return;
     }
 
+    obj->logSeverityFilter = baton->log_level;
+
     try
     {
         baton->log_callback = new Nan::Callback(ConversionUtility::getCallbackFunction(options, "logCallback"));
@@ -663,7 +1220,75 @@ NAN_METHOD(Adapter::Open)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, Open, reinterpret_cast<uv_after_work_cb>(AfterOpen));
+    if (Utility::Has(options, "flightRecorderSize"))
+    {
+        try
+        {
+            flightRecorderSize = ConversionUtility::getNativeUint32(options, "flightRecorderSize");
+        }
+        catch (std::string error)
+        {
+            auto message = ErrorMessage::getStructErrorMessage("flightRecorderSize", error);
+            Nan::ThrowTypeError(message);
+            return;
+        }
+    }
+
+    if (Utility::Has(options, "healthReportInterval"))
+    {
+        try
+        {
+            healthReportInterval = ConversionUtility::getNativeUint32(options, "healthReportInterval");
+        }
+        catch (std::string error)
+        {
+            auto message = ErrorMessage::getStructErrorMessage("healthReportInterval", error);
+            Nan::ThrowTypeError(message);
+            return;
+        }
+    }
+
+    if (Utility::Has(options, "initScript") && !Utility::IsNull(options, "initScript"))
+    {
+        uint32_t index = 0;
+
+        try
+        {
+            auto script = Utility::Get(options, "initScript");
+
+            if (!script->IsArray())
+            {
+                throw std::string("array");
+            }
+
+            auto steps = v8::Local<v8::Array>::Cast(script);
+
+            for (; index < steps->Length(); ++index)
+            {
+                baton->init_script.push_back(getInitScriptStep(ConversionUtility::getJsObject(Utility::Get(steps, index))));
+            }
+        }
+        catch (std::string error)
+        {
+            std::stringstream errormessage;
+            errormessage << "Init script step " << index << " was wrong. Reason: " << error;
+            Nan::ThrowTypeError(errormessage.str().c_str());
+            return;
+        }
+    }
+
+    obj->flightRecorder.resize(flightRecorderSize);
+    obj->healthMonitor.reset();
+
+    // The handles must be created in the thread that owns the event loop of the adapter
+    obj->initNotificationHandling();
+    obj->initEventHandling(baton->event_callback, baton->evt_interval);
+    obj->initLogHandling(baton->log_callback);
+    obj->initStatusHandling(baton->status_callback);
+    obj->setHealthReportInterval(healthReportInterval);
+
+    obj->commandQueue->enqueue(baton->req, Open, reinterpret_cast<uv_after_work_cb>(AfterOpen), "Open", COMMAND_KIND_LIFECYCLE);
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -671,13 +1296,8 @@ void Adapter::Open(uv_work_t *req)
 {
     auto baton = static_cast<OpenBaton *>(req->data);
 
-    baton->mainObject->initEventHandling(baton->event_callback, baton->evt_interval);
-    baton->mainObject->initLogHandling(baton->log_callback);
-    baton->mainObject->initStatusHandling(baton->status_callback);
-
-    // Ensure that the correct adapter gets the callbacks as long as we have no reference to
-    // the driver adapter until after sd_rpc_open is called
-    adapterBeingOpened = baton->mainObject;
+    // Nothing learned from an earlier session of the adapter applies to this one
+    baton->mainObject->resetLinkState();
 
     auto path = baton->path.c_str();
 
@@ -687,7 +1307,31 @@ void Adapter::Open(uv_work_t *req)
     auto adapter = sd_rpc_adapter_create(serialization);
 
     baton->adapter = adapter;
-    baton->mainObject->adapter = adapter;
+
+    // Undoes the steps above when the adapter is not handed to the application
+    auto release = [&]() {
+        baton->mainObject->setInternalAdapter(nullptr);
+        baton->adapter = nullptr;
+
+        // Delete the adapter layer and all layers below
+        sd_rpc_adapter_delete(adapter);
+
+        // Free memory malloc'ed by the sd_rpc_create* functions
+        free(uart);
+        free(h5);
+        free(serialization);
+        free(adapter);
+    };
+
+    // Bind the adapter before sd_rpc_open, the driver may call back before sd_rpc_open returns.
+    // Adapters opened at the same time are routed by their own driver adapter and do not wait for each other.
+    if (!baton->mainObject->setInternalAdapter(adapter))
+    {
+        std::cerr << std::endl << "No room to register more open adapters." << std::endl;
+        baton->result = NRF_ERROR_NO_MEM;
+        release();
+        return;
+    }
 
     // Set the log level
     auto error_code = sd_rpc_log_handler_severity_filter_set(adapter, baton->log_level);
@@ -696,65 +1340,128 @@ void Adapter::Open(uv_work_t *req)
     {
         std::cerr << std::endl << "Failed to set log severity filter." << std::endl;
         baton->result = error_code;
+        release();
         return;
     }
 
     error_code = sd_rpc_open(adapter, sd_rpc_on_status, sd_rpc_on_event, sd_rpc_on_log_event);
 
-    // Let the normal log handling handle the rest of the log calls
-    adapterBeingOpened = nullptr;
-
     if (error_code != NRF_SUCCESS)
     {
         std::cerr << std::endl << "Failed to open the nRF5 BLE driver." << std::endl;
         baton->result = error_code;
-
-        // Delete the adapter layer and all layers below
-        sd_rpc_adapter_delete(adapter);
-
-        // Free memory malloc'ed by the sd_rpc_create* functions
-        free(uart);
-        free(h5);
-        free(serialization);
-        free(adapter);
-
+        release();
         return;
     }
 
+    // A new transport starts with an unconfigured SoftDevice
+    baton->mainObject->configurationJournal.clear();
+
     if (baton->enable_ble) {
         error_code = Adapter::enableBLE(adapter, baton->ble_enable_params);
 
         if (error_code == NRF_SUCCESS)
         {
-            baton->result = error_code;
-            return;
+            auto enable_params = *baton->ble_enable_params;
+            recordConfiguration(adapter, "EnableBLE", [=](adapter_t *target) mutable {
+                return Adapter::enableBLE(target, &enable_params);
+            });
         }
-
-        if (error_code == NRF_ERROR_INVALID_STATE)
+        else if (error_code == NRF_ERROR_INVALID_STATE)
         {
             std::cerr << "BLE stack already enabled" << std::endl;
-            return;
+            error_code = NRF_SUCCESS;
+        }
+    }
+
+    if (error_code == NRF_SUCCESS && !baton->init_script.empty())
+    {
+        error_code = runInitScript(baton);
+
+        if (error_code != NRF_SUCCESS)
+        {
+            // Startup is all or nothing, a partly configured adapter is not handed to the application
+            std::cerr << "Init script step " << baton->failed_step << " failed, closing the adapter." << std::endl;
+            sd_rpc_close(adapter);
+            baton->mainObject->configurationJournal.clear();
+            baton->vendor_uuids.clear();
+            release();
         }
     }
 
     baton->result = error_code;
 }
 
+// This runs in a worker thread (not Main Thread)
+uint32_t Adapter::runInitScript(OpenBaton *baton)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint32_t error_code = NRF_SUCCESS;
+
+    for (auto &step : baton->init_script)
+    {
+        error_code = step.run(baton);
+
+        if (error_code != NRF_SUCCESS)
+        {
+            baton->failed_step = step.name;
+            break;
+        }
+    }
+
+    baton->init_script_time = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count());
+
+    return error_code;
+}
+
 // This runs in  Main Thread
 void Adapter::AfterOpen(uv_work_t *req)
 {
     Nan::HandleScope scope;
     auto baton = static_cast<OpenBaton *>(req->data);
 
-    v8::Local<v8::Value> argv[1];
+    baton->mainObject->clearConfigurationCache();
+
+    v8::Local<v8::Value> argv[2];
+    argv[1] = Nan::Undefined();
 
     if (baton->result != NRF_SUCCESS)
     {
-        argv[0] = ErrorMessage::getErrorMessage(baton->result, "opening port");
+        if (baton->failed_step != nullptr)
+        {
+            std::stringstream operation;
+            operation << "running init script step " << baton->failed_step;
+            argv[0] = ErrorMessage::getErrorMessage(baton->result, operation.str());
+        }
+        else
+        {
+            argv[0] = ErrorMessage::getErrorMessage(baton->result, "opening port");
+        }
     }
     else
     {
         argv[0] = Nan::Undefined();
+
+        if (!baton->init_script.empty())
+        {
+            auto vendorUuidTypes = Nan::New<v8::Array>();
+            uint32_t index = 0;
+
+            for (auto &vendor_uuid : baton->vendor_uuids)
+            {
+                // Remember the bases so UUIDs of these types can be encoded and decoded locally
+                baton->mainObject->vendorUUIDBases[vendor_uuid.first] = vendor_uuid.second;
+                Nan::Set(vendorUuidTypes, index++, ConversionUtility::toJsNumber(vendor_uuid.first));
+            }
+
+            auto script = Nan::New<v8::Object>();
+            Utility::Set(script, "stepCount", static_cast<uint32_t>(baton->init_script.size()));
+            Utility::Set(script, "duration", baton->init_script_time);
+            Utility::Set(script, "vendorUuidTypes", vendorUuidTypes);
+
+            argv[1] = script;
+        }
     }
 
     if (baton->result != NRF_SUCCESS)
@@ -762,8 +1469,7 @@ void Adapter::AfterOpen(uv_work_t *req)
         baton->mainObject->cleanUpV8Resources();
     }
 
-
-    baton->callback->Call(1, argv);
+    baton->deliver(2, argv);
 
     delete baton;
 }
@@ -775,7 +1481,7 @@ NAN_METHOD(Adapter::Close)
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[0]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[0]);
     }
     catch (std::string error)
     {
@@ -788,13 +1494,17 @@ NAN_METHOD(Adapter::Close)
     baton->adapter = obj->adapter;
     baton->mainObject = obj;
 
-    uv_queue_work(uv_default_loop(), baton->req, Close, reinterpret_cast<uv_after_work_cb>(AfterClose));
+    obj->commandQueue->enqueue(baton->req, Close, reinterpret_cast<uv_after_work_cb>(AfterClose), "Close", COMMAND_KIND_LIFECYCLE);
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 void Adapter::Close(uv_work_t *req)
 {
     auto baton = static_cast<CloseBaton *>(req->data);
+    // No native replies may be sent while the adapter is closed
+    baton->mainObject->lescResponder.stop();
     baton->result = sd_rpc_close(baton->adapter);
+    baton->mainObject->resetLinkState();
 }
 
 void Adapter::AfterClose(uv_work_t *req)
@@ -802,9 +1512,14 @@ void Adapter::AfterClose(uv_work_t *req)
     Nan::HandleScope scope;
     auto baton = static_cast<CloseBaton *>(req->data);
 
-    baton->mainObject->cleanUpV8Resources();
+    // A close dropped when the command queue is stopped never closed the transport
+    if (baton->abortReason == COMMAND_NOT_ABORTED)
+    {
+        baton->mainObject->cleanUpV8Resources();
+        baton->mainObject->clearConfigurationCache();
+    }
 
-    if (baton->callback != nullptr)
+    if (baton->callback != nullptr || baton->resolver != nullptr)
     {
         v8::Local<v8::Value> argv[1];
 
@@ -817,7 +1532,7 @@ void Adapter::AfterClose(uv_work_t *req)
             argv[0] = Nan::Undefined();
         }
 
-        baton->callback->Call(1, argv);
+        baton->deliver(1, argv);
     }
 
     delete baton;
@@ -830,7 +1545,7 @@ NAN_METHOD(Adapter::ConnReset)
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[0]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[0]);
     }
     catch (std::string error)
     {
@@ -843,13 +1558,20 @@ NAN_METHOD(Adapter::ConnReset)
     baton->adapter = obj->adapter;
     baton->mainObject = obj;
 
-    uv_queue_work(uv_default_loop(), baton->req, ConnReset, reinterpret_cast<uv_after_work_cb>(AfterConnReset));
+    obj->commandQueue->enqueue(baton->req, ConnReset, reinterpret_cast<uv_after_work_cb>(AfterConnReset), "ConnReset", COMMAND_KIND_LIFECYCLE);
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 void Adapter::ConnReset(uv_work_t *req)
 {
-    auto baton = static_cast<CloseBaton *>(req->data);
+    auto baton = static_cast<ConnResetBaton *>(req->data);
     baton->result = sd_rpc_conn_reset(baton->adapter);
+
+    // The reset drops the connections of the chip
+    if (baton->result == NRF_SUCCESS)
+    {
+        baton->mainObject->resetLinkState();
+    }
 }
 
 void Adapter::AfterConnReset(uv_work_t *req)
@@ -857,9 +1579,13 @@ void Adapter::AfterConnReset(uv_work_t *req)
     Nan::HandleScope scope;
     auto baton = static_cast<ConnResetBaton *>(req->data);
 
-    baton->mainObject->cleanUpV8Resources();
+    if (baton->abortReason == COMMAND_NOT_ABORTED)
+    {
+        baton->mainObject->cleanUpV8Resources();
+        baton->mainObject->clearConfigurationCache();
+    }
 
-    if (baton->callback != nullptr)
+    if (baton->callback != nullptr || baton->resolver != nullptr)
     {
         v8::Local<v8::Value> argv[1];
 
@@ -872,26 +1598,880 @@ void Adapter::AfterConnReset(uv_work_t *req)
             argv[0] = Nan::Undefined();
         }
 
-        baton->callback->Call(1, argv);
+        baton->deliver(1, argv);
     }
 
     delete baton;
 }
 
-NAN_METHOD(Adapter::AddVendorSpecificUUID)
+void Adapter::recordConfiguration(adapter_t *adapter, const char *name, std::function<uint32_t(adapter_t *)> apply)
+{
+    auto obj = Adapter::getAdapter(adapter);
+
+    if (obj == nullptr)
+    {
+        return;
+    }
+
+    ConfigurationStep step;
+    step.name = name;
+    step.isSetter = false;
+    step.apply = apply;
+
+    obj->configurationJournal.push_back(step);
+}
+
+void Adapter::recordConfiguration(adapter_t *adapter, const char *name, const std::string &target, std::function<uint32_t(adapter_t *)> apply)
+{
+    auto obj = Adapter::getAdapter(adapter);
+
+    if (obj == nullptr)
+    {
+        return;
+    }
+
+    auto &journal = obj->configurationJournal;
+
+    // Values that are set repeatedly, like the value of a sensor characteristic, keep a single step
+    journal.erase(std::remove_if(journal.begin(), journal.end(), [&](const ConfigurationStep &step) {
+        return step.isSetter && step.target == target && strcmp(step.name, name) == 0;
+    }), journal.end());
+
+    ConfigurationStep step;
+    step.name = name;
+    step.isSetter = true;
+    step.target = target;
+    step.apply = apply;
+
+    journal.push_back(step);
+}
+
+void Adapter::clearConfiguration(adapter_t *adapter)
+{
+    auto obj = Adapter::getAdapter(adapter);
+
+    if (obj != nullptr)
+    {
+        obj->configurationJournal.clear();
+    }
+}
+
+NAN_METHOD(Adapter::Reinitialize)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint32_t resetTimeout;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        resetTimeout = ConversionUtility::getNativeUint32(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new ReinitializeBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->mainObject = obj;
+    baton->reset_timeout = resetTimeout;
+    baton->failed_step = nullptr;
+    baton->replayed_count = 0;
+    baton->reset_time = 0;
+    baton->replay_time = 0;
+
+    obj->commandQueue->enqueue(baton->req, Reinitialize, reinterpret_cast<uv_after_work_cb>(AfterReinitialize), "Reinitialize", COMMAND_KIND_LIFECYCLE);
+    info.GetReturnValue().Set(baton->returnValue());
+}
+
+// This runs in the command thread. The transport is kept open, only the connectivity chip is reset.
+void Adapter::Reinitialize(uv_work_t *req)
+{
+    auto baton = static_cast<ReinitializeBaton *>(req->data);
+    auto obj = baton->mainObject;
+    auto start = std::chrono::steady_clock::now();
+
+    uint32_t activeCount;
+
+    {
+        std::lock_guard<std::mutex> lock(obj->statusMutex);
+        activeCount = obj->connectionActiveCount;
+    }
+
+    baton->result = sd_rpc_conn_reset(baton->adapter);
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        return;
+    }
+
+    obj->resetLinkState();
+
+    // The chip is ready when the data link layer has resynchronized after the reset
+    {
+        std::unique_lock<std::mutex> lock(obj->statusMutex);
+
+        auto ready = obj->statusCondition.wait_for(lock, std::chrono::milliseconds(baton->reset_timeout), [&] {
+            return obj->connectionActiveCount != activeCount;
+        });
+
+        if (!ready)
+        {
+            baton->result = NRF_ERROR_TIMEOUT;
+            return;
+        }
+    }
+
+    auto reset = std::chrono::steady_clock::now();
+
+    for (auto &step : obj->configurationJournal)
+    {
+        baton->result = step.apply(baton->adapter);
+
+        if (baton->result != NRF_SUCCESS)
+        {
+            baton->failed_step = step.name;
+            return;
+        }
+
+        baton->replayed_count += 1;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    baton->reset_time = std::chrono::duration_cast<std::chrono::microseconds>(reset - start).count() / 1000.0;
+    baton->replay_time = std::chrono::duration_cast<std::chrono::microseconds>(end - reset).count() / 1000.0;
+}
+
+void Adapter::AfterReinitialize(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<ReinitializeBaton *>(req->data);
+    v8::Local<v8::Value> argv[2];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        // The SoftDevice is left partly configured
+        baton->mainObject->clearConfigurationCache();
+
+        std::string operation = "reinitializing connectivity device";
+
+        if (baton->failed_step != nullptr)
+        {
+            operation += std::string(", replaying ") + baton->failed_step;
+        }
+
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, operation);
+        argv[1] = Nan::Undefined();
+    }
+    else
+    {
+        // The replayed configuration matches the cached values, the cache is kept
+        auto timing = Nan::New<v8::Object>();
+        Utility::Set(timing, "resetTime", baton->reset_time);
+        Utility::Set(timing, "replayTime", baton->replay_time);
+        Utility::Set(timing, "timeToReady", baton->reset_time + baton->replay_time);
+        Utility::Set(timing, "replayedCount", baton->replayed_count);
+
+        argv[0] = Nan::Undefined();
+        argv[1] = timing;
+    }
+
+    baton->deliver(2, argv);
+    delete baton;
+}
+
+NAN_METHOD(Adapter::AddVendorSpecificUUID)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    v8::Local<v8::Object> uuid;
+    v8::Local<v8::Function> callback;
+
+    auto argumentcount = 0;
+
+    try
+    {
+        uuid = ConversionUtility::getJsObject(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new BleAddVendorSpcificUUIDBaton(callback);
+    baton->p_vs_uuid = BleUUID128(uuid);
+    baton->adapter = obj->adapter;
+    baton->mainObject = obj;
+
+    obj->commandQueue->enqueue(baton->req, AddVendorSpecificUUID, reinterpret_cast<uv_after_work_cb>(AfterAddVendorSpecificUUID), "AddVendorSpecificUUID");
+    info.GetReturnValue().Set(baton->returnValue());
+}
+
+void Adapter::AddVendorSpecificUUID(uv_work_t *req)
+{
+    auto baton = static_cast<BleAddVendorSpcificUUIDBaton *>(req->data);
+    baton->result = sd_ble_uuid_vs_add(baton->adapter, baton->p_vs_uuid, &baton->p_uuid_type);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        // Replayed in the same order, the base must get the same UUID type for the cached encodings to stay valid
+        auto vs_uuid = *baton->p_vs_uuid;
+        auto uuid_type = baton->p_uuid_type;
+        recordConfiguration(baton->adapter, "AddVendorSpecificUUID", [=](adapter_t *adapter) {
+            uint8_t replayedType;
+            auto result = sd_ble_uuid_vs_add(adapter, &vs_uuid, &replayedType);
+            return (result == NRF_SUCCESS && replayedType != uuid_type) ? static_cast<uint32_t>(NRF_ERROR_INVALID_STATE) : result;
+        });
+    }
+}
+
+void Adapter::AfterAddVendorSpecificUUID(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<BleAddVendorSpcificUUIDBaton *>(req->data);
+
+    v8::Local<v8::Value> argv[2];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "adding vendor specific 128-bit UUID");
+        argv[1] = Nan::Undefined();
+    }
+    else
+    {
+        // Remember the base so UUIDs of this type can be encoded and decoded locally
+        baton->mainObject->vendorUUIDBases[baton->p_uuid_type] = *baton->p_vs_uuid;
+
+        argv[0] = Nan::Undefined();
+        argv[1] = ConversionUtility::toJsNumber(baton->p_uuid_type);
+    }
+
+    baton->deliver(2, argv);
+    delete baton;
+}
+
+NAN_INLINE sd_rpc_parity_t ToParityEnum(const v8::Handle<v8::String>& v8str)
+{
+    sd_rpc_parity_t parity = SD_RPC_PARITY_NONE;
+
+    if (v8str->Equals(Nan::New("none").ToLocalChecked()))
+    {
+        parity = SD_RPC_PARITY_NONE;
+    }
+    else if (v8str->Equals(Nan::New("even").ToLocalChecked()))
+    {
+        parity = SD_RPC_PARITY_EVEN;
+    }
+
+    return parity;
+}
+
+NAN_INLINE sd_rpc_flow_control_t ToFlowControlEnum(const v8::Handle<v8::String>& v8str)
+{
+    sd_rpc_flow_control_t flow_control = SD_RPC_FLOW_CONTROL_NONE;
+
+    if (v8str->Equals(Nan::New("none").ToLocalChecked()))
+    {
+        flow_control = SD_RPC_FLOW_CONTROL_NONE;
+    }
+    else if (v8str->Equals(Nan::New("hw").ToLocalChecked()))
+    {
+        flow_control = SD_RPC_FLOW_CONTROL_HARDWARE;
+    }
+
+    return flow_control;
+}
+
+NAN_INLINE sd_rpc_log_severity_t ToLogSeverityEnum(const v8::Handle<v8::String>& v8str)
+{
+    sd_rpc_log_severity_t log_severity = SD_RPC_LOG_DEBUG;
+
+    if (v8str->Equals(Nan::New("trace").ToLocalChecked()))
+    {
+        log_severity = SD_RPC_LOG_TRACE;
+    }
+    else if (v8str->Equals(Nan::New("debug").ToLocalChecked()))
+    {
+        log_severity = SD_RPC_LOG_DEBUG;
+    }
+    else if (v8str->Equals(Nan::New("info").ToLocalChecked()))
+    {
+        log_severity = SD_RPC_LOG_INFO;
+    }
+    else if (v8str->Equals(Nan::New("error").ToLocalChecked()))
+    {
+        log_severity = SD_RPC_LOG_ERROR;
+    }
+    else if (v8str->Equals(Nan::New("fatal").ToLocalChecked()))
+    {
+        log_severity = SD_RPC_LOG_FATAL;
+    }
+
+    return log_severity;
+}
+
+NAN_METHOD(Adapter::GetVersion)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    v8::Local<v8::Function> callback;
+
+    try
+    {
+        callback = ConversionUtility::getOptionalCallbackFunction(info[0]);
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto version = new ble_version_t();
+    memset(version, 0, sizeof(ble_version_t));
+
+    auto baton = new GetVersionBaton(callback);
+    baton->errorLast = true;
+    baton->version = version;
+    baton->adapter = obj->adapter;
+
+    obj->commandQueue->enqueue(baton->req, GetVersion, reinterpret_cast<uv_after_work_cb>(AfterGetVersion), "GetVersion");
+    info.GetReturnValue().Set(baton->returnValue());
+
+    return;
+}
+
+void Adapter::GetVersion(uv_work_t *req)
+{
+    auto baton = static_cast<GetVersionBaton *>(req->data);
+    baton->result = sd_ble_version_get(baton->adapter, baton->version);
+}
+
+// This runs in Main Thread
+void Adapter::AfterGetVersion(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<GetVersionBaton *>(req->data);
+    v8::Local<v8::Value> argv[2];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = Nan::Undefined();
+        argv[1] = ErrorMessage::getErrorMessage(baton->result, "getting version.");
+    }
+    else
+    {
+        argv[0] = Version(baton->version).ToJs();
+        argv[1] = Nan::Undefined();
+    }
+
+    baton->deliver(2, argv);
+    delete baton->version;
+    delete baton;
+}
+
+NAN_METHOD(Adapter::EncodeUUID)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    v8::Local<v8::Object> uuid;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        uuid = ConversionUtility::getJsObject(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new BleUUIDEncodeBaton(callback);
+
+    try
+    {
+        baton->p_uuid = BleUUID(uuid);
+    }
+    catch (std::string error)
+    {
+        std::stringstream errormessage;
+        errormessage << "Could not process the UUID. Reason: " << error;
+        Nan::ThrowTypeError(errormessage.str().c_str());
+        return;
+    }
+
+    baton->uuid_le = new uint8_t[16];
+    baton->adapter = obj->adapter;
+
+    obj->commandQueue->enqueue(baton->req, EncodeUUID, reinterpret_cast<uv_after_work_cb>(AfterEncodeUUID), "EncodeUUID");
+    info.GetReturnValue().Set(baton->returnValue());
+
+    return;
+}
+
+void Adapter::EncodeUUID(uv_work_t *req)
+{
+    auto baton = static_cast<BleUUIDEncodeBaton *>(req->data);
+    baton->result = sd_ble_uuid_encode(baton->adapter, baton->p_uuid, &baton->uuid_le_len, baton->uuid_le);
+}
+
+// This runs in Main Thread
+void Adapter::AfterEncodeUUID(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<BleUUIDEncodeBaton *>(req->data);
+    v8::Local<v8::Value> argv[4];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "encoding UUID.");
+        argv[1] = Nan::Undefined();
+        argv[2] = Nan::Undefined();
+        argv[3] = Nan::Undefined();
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+        argv[1] = ConversionUtility::toJsNumber(baton->uuid_le_len);
+        argv[2] = ConversionUtility::toJsValueArray(baton->uuid_le, baton->uuid_le_len);
+        argv[3] = ConversionUtility::encodeHex(reinterpret_cast<char *>(baton->uuid_le), baton->uuid_le_len);
+    }
+
+    baton->deliver(4, argv);
+    delete baton->uuid_le;
+    delete baton;
+}
+
+NAN_METHOD(Adapter::DecodeUUID)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint8_t le_len;
+    v8::Local<v8::Value> uuid_le;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        le_len = ConversionUtility::getNativeUint8(info[argumentcount]);
+        argumentcount++;
+
+        uuid_le = info[argumentcount]->ToString();
+        argumentcount++;
+
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new BleUUIDDecodeBaton(callback);
+    baton->uuid_le_len = le_len;
+    baton->uuid_le = ConversionUtility::extractHex(uuid_le);
+    baton->p_uuid = new ble_uuid_t();
+    baton->adapter = obj->adapter;
+
+    obj->commandQueue->enqueue(baton->req, DecodeUUID, reinterpret_cast<uv_after_work_cb>(AfterDecodeUUID), "DecodeUUID");
+    info.GetReturnValue().Set(baton->returnValue());
+
+    return;
+}
+
+void Adapter::DecodeUUID(uv_work_t *req)
+{
+    auto baton = static_cast<BleUUIDDecodeBaton *>(req->data);
+    baton->result = sd_ble_uuid_decode(baton->adapter, baton->uuid_le_len, baton->uuid_le, baton->p_uuid);
+}
+
+// This runs in Main Thread
+void Adapter::AfterDecodeUUID(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<BleUUIDDecodeBaton *>(req->data);
+    v8::Local<v8::Value> argv[2];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "decoding UUID.");
+        argv[1] = Nan::Undefined();
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+        argv[1] = BleUUID(baton->p_uuid);
+    }
+
+    baton->deliver(2, argv);
+    delete baton->p_uuid;
+    delete baton->uuid_le;
+    delete baton;
+}
+
+// Byte offset of the 16-bit UUID within a 128-bit vendor specific UUID, little endian
+const auto VS_UUID_16_OFFSET = 12;
+
+bool Adapter::encodeUUIDLocal(const ble_uuid_t *uuid, uint8_t *uuid_le_len, uint8_t *uuid_le) const
+{
+    if (uuid->type == BLE_UUID_TYPE_BLE)
+    {
+        uuid_le[0] = static_cast<uint8_t>(uuid->uuid & 0xFF);
+        uuid_le[1] = static_cast<uint8_t>(uuid->uuid >> 8);
+        *uuid_le_len = 2;
+        return true;
+    }
+
+    auto base = vendorUUIDBases.find(uuid->type);
+
+    if (base == vendorUUIDBases.end())
+    {
+        return false;
+    }
+
+    memcpy(uuid_le, base->second.uuid128, 16);
+    uuid_le[VS_UUID_16_OFFSET] = static_cast<uint8_t>(uuid->uuid & 0xFF);
+    uuid_le[VS_UUID_16_OFFSET + 1] = static_cast<uint8_t>(uuid->uuid >> 8);
+    *uuid_le_len = 16;
+    return true;
+}
+
+bool Adapter::decodeUUIDLocal(const uint8_t uuid_le_len, const uint8_t *uuid_le, ble_uuid_t *uuid) const
+{
+    if (uuid_le_len == 2)
+    {
+        uuid->type = BLE_UUID_TYPE_BLE;
+        uuid->uuid = uint16_decode(uuid_le);
+        return true;
+    }
+
+    if (uuid_le_len != 16)
+    {
+        return false;
+    }
+
+    for (auto base : vendorUUIDBases)
+    {
+        auto match = true;
+
+        for (auto i = 0; i < 16 && match; ++i)
+        {
+            if (i == VS_UUID_16_OFFSET || i == VS_UUID_16_OFFSET + 1)
+            {
+                continue;
+            }
+
+            match = base.second.uuid128[i] == uuid_le[i];
+        }
+
+        if (match)
+        {
+            uuid->type = base.first;
+            uuid->uuid = uint16_decode(&uuid_le[VS_UUID_16_OFFSET]);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+NAN_METHOD(Adapter::EncodeUUIDSync)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    v8::Local<v8::Object> uuid;
+    ble_uuid_t *p_uuid;
+
+    try
+    {
+        uuid = ConversionUtility::getJsObject(info[0]);
+        p_uuid = BleUUID(uuid);
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    uint8_t uuid_le[16];
+    uint8_t uuid_le_len = 0;
+
+    auto found = obj->encodeUUIDLocal(p_uuid, &uuid_le_len, uuid_le);
+    delete p_uuid;
+
+    if (!found)
+    {
+        info.GetReturnValue().SetUndefined();
+        return;
+    }
+
+    auto encoded = Nan::New<v8::Object>();
+    Utility::Set(encoded, "length", uuid_le_len);
+    Utility::Set(encoded, "uuid", ConversionUtility::toJsValueArray(uuid_le, uuid_le_len));
+    Utility::Set(encoded, "hex", ConversionUtility::encodeHex(reinterpret_cast<char *>(uuid_le), uuid_le_len));
+
+    Utility::SetReturnValue(info, encoded);
+}
+
+NAN_METHOD(Adapter::DecodeUUIDSync)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint8_t le_len;
+    v8::Local<v8::Value> uuid_le;
+    auto argumentcount = 0;
+
+    try
+    {
+        le_len = ConversionUtility::getNativeUint8(info[argumentcount]);
+        argumentcount++;
+
+        uuid_le = info[argumentcount]->ToString();
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto uuid_le_native = ConversionUtility::extractHex(uuid_le);
+    ble_uuid_t uuid;
+
+    auto found = obj->decodeUUIDLocal(le_len, uuid_le_native, &uuid);
+    free(uuid_le_native);
+
+    if (!found)
+    {
+        info.GetReturnValue().SetUndefined();
+        return;
+    }
+
+    Utility::SetReturnValue(info, BleUUID(&uuid).ToJs());
+}
+
+NAN_METHOD(Adapter::GetStats)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto stats = Nan::New<v8::Object>();
+
+    Utility::Set(stats, "eventCallbackTotalTime", obj->getEventCallbackTotalTime());
+    Utility::Set(stats, "eventCallbackTotalCount", obj->getEventCallbackCount());
+    Utility::Set(stats, "eventCallbackBatchMaxCount", obj->getEventCallbackMaxCount());
+    Utility::Set(stats, "eventCallbackBatchAvgCount", obj->getAverageCallbackBatchCount());
+    Utility::Set(stats, "eventQueueFullCount", obj->getEventQueueFullCount());
+    Utility::Set(stats, "logDroppedCount", obj->getLogDroppedCount());
+
+    auto logDroppedBySeverity = Nan::New<v8::Array>();
+
+    for (auto severity = 0; severity < LOG_SEVERITY_COUNT; ++severity)
+    {
+        Nan::Set(logDroppedBySeverity, severity, ConversionUtility::toJsNumber(obj->getLogDroppedCount(static_cast<sd_rpc_log_severity_t>(severity))));
+    }
+
+    Utility::Set(stats, "logDroppedCountBySeverity", logDroppedBySeverity);
+    Utility::Set(stats, "commandQueueDepth", obj->commandQueue->getDepth());
+    Utility::Set(stats, "commandQueueMaxDepth", obj->commandQueue->getMaxDepth());
+    Utility::Set(stats, "commandTotalCount", obj->commandQueue->getCommandCount());
+    Utility::Set(stats, "commandWaitTimeAvg", obj->commandQueue->getAverageWaitTime());
+    Utility::Set(stats, "commandWaitTimeMax", obj->commandQueue->getMaxWaitTime());
+    Utility::Set(stats, "commandCompletionBatchAvgCount", obj->commandQueue->getAverageCompletionBatchCount());
+    Utility::Set(stats, "commandTimedOutCount", obj->commandQueue->getTimedOutCount());
+    Utility::Set(stats, "commandCancelledCount", obj->commandQueue->getCancelledCount());
+
+    Utility::SetReturnValue(info, stats);
+}
+
+NAN_METHOD(Adapter::SetCompletionCallback)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+
+    if (info[0]->IsUndefined() || info[0]->IsNull())
+    {
+        obj->commandQueue->setCompletionCallback(nullptr);
+        return;
+    }
+
+    v8::Local<v8::Function> callback;
+
+    try
+    {
+        callback = ConversionUtility::getCallbackFunction(info[0]);
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    obj->commandQueue->setCompletionCallback(new Nan::Callback(callback));
+}
+
+NAN_METHOD(Adapter::SetDefaultCommandTimeout)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint32_t timeout;
+
+    try
+    {
+        timeout = ConversionUtility::getNativeUint32(info[0]);
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    obj->commandQueue->setDefaultTimeout(timeout);
+}
+
+NAN_METHOD(Adapter::SetCommandTimeout)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint32_t id;
+    uint32_t timeout;
+    auto argumentcount = 0;
+
+    try
+    {
+        id = ConversionUtility::getNativeUint32(info[argumentcount]);
+        argumentcount++;
+
+        timeout = ConversionUtility::getNativeUint32(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    info.GetReturnValue().Set(obj->commandQueue->setTimeout(id, timeout));
+}
+
+NAN_METHOD(Adapter::GetLastCommandId)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    info.GetReturnValue().Set(ConversionUtility::toJsNumber(obj->commandQueue->getLastId()));
+}
+
+NAN_METHOD(Adapter::CancelCommand)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint32_t id;
+
+    try
+    {
+        id = ConversionUtility::getNativeUint32(info[0]);
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    info.GetReturnValue().Set(obj->commandQueue->cancel(id));
+}
+
+NAN_METHOD(Adapter::SetTracing)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    bool enabled;
+    uint32_t capacity = 0;
+    auto argumentcount = 0;
+
+    try
+    {
+        enabled = ConversionUtility::getBool(info[argumentcount]);
+        argumentcount++;
+
+        if (info.Length() > argumentcount && !info[argumentcount]->IsUndefined())
+        {
+            capacity = ConversionUtility::getNativeUint32(info[argumentcount]);
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    if (enabled)
+    {
+        obj->traceBuffer.enable(capacity);
+    }
+    else
+    {
+        obj->traceBuffer.disable();
+    }
+}
+
+NAN_METHOD(Adapter::SetLogRateLimit)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint8_t severity;
+    double linesPerSecond;
+    double burst;
+    auto argumentcount = 0;
+
+    try
+    {
+        severity = ConversionUtility::getNativeUint8(info[argumentcount]);
+        argumentcount++;
+
+        linesPerSecond = ConversionUtility::getNativeDouble(info[argumentcount]);
+        argumentcount++;
+
+        burst = linesPerSecond;
+
+        if (info.Length() > argumentcount && !info[argumentcount]->IsUndefined())
+        {
+            burst = ConversionUtility::getNativeDouble(info[argumentcount]);
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    obj->logBuffer.setRateLimit(static_cast<sd_rpc_log_severity_t>(severity), linesPerSecond, burst);
+}
+
+NAN_METHOD(Adapter::SetDebugLogListeners)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    v8::Local<v8::Object> uuid;
-    v8::Local<v8::Function> callback;
-
+    bool listening;
     auto argumentcount = 0;
 
     try
     {
-        uuid = ConversionUtility::getJsObject(info[argumentcount]);
-        argumentcount++;
-
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        listening = ConversionUtility::getBool(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -901,171 +2481,194 @@ NAN_METHOD(Adapter::AddVendorSpecificUUID)
         return;
     }
 
-    auto baton = new BleAddVendorSpcificUUIDBaton(callback);
-    baton->p_vs_uuid = BleUUID128(uuid);
-    baton->adapter = obj->adapter;
-
-    uv_queue_work(uv_default_loop(), baton->req, AddVendorSpecificUUID, reinterpret_cast<uv_after_work_cb>(AfterAddVendorSpecificUUID));
+    obj->debugLogListeners = listening;
 }
 
-void Adapter::AddVendorSpecificUUID(uv_work_t *req)
+bool Adapter::hasDebugLogConsumers() const
 {
-    auto baton = static_cast<BleAddVendorSpcificUUIDBaton *>(req->data);
-    baton->result = sd_ble_uuid_vs_add(baton->adapter, baton->p_vs_uuid, &baton->p_uuid_type);
+    return debugLogListeners && logCallback != nullptr && logSeverityFilter <= SD_RPC_LOG_DEBUG;
 }
 
-void Adapter::AfterAddVendorSpecificUUID(uv_work_t *req)
+// This runs in the NodeJS thread
+v8::Local<v8::Object> Adapter::getHealthReport()
 {
-    Nan::HandleScope scope;
-    auto baton = static_cast<BleAddVendorSpcificUUIDBaton *>(req->data);
-
-    v8::Local<v8::Value> argv[2];
+    Nan::EscapableHandleScope scope;
 
-    if (baton->result != NRF_SUCCESS)
-    {
-        argv[0] = ErrorMessage::getErrorMessage(baton->result, "adding vendor specific 128-bit UUID");
-        argv[1] = Nan::Undefined();
-    }
-    else
-    {
-        argv[0] = Nan::Undefined();
-        argv[1] = ConversionUtility::toJsNumber(baton->p_uuid_type);
-    }
+    HealthReport report;
+    healthMonitor.getReport(report);
+
+    auto obj = Nan::New<v8::Object>();
+
+    Utility::Set(obj, "roundTripCount", report.roundTripCount);
+    Utility::Set(obj, "roundTripP50", report.roundTripP50);
+    Utility::Set(obj, "roundTripP90", report.roundTripP90);
+    Utility::Set(obj, "roundTripP99", report.roundTripP99);
+    Utility::Set(obj, "roundTripMax", report.roundTripMax);
+    Utility::Set(obj, "sendRetriesExhaustedCount", report.sendRetriesExhaustedCount);
+    Utility::Set(obj, "unexpectedPacketCount", report.unexpectedPacketCount);
+    Utility::Set(obj, "encodeErrorCount", report.encodeErrorCount);
+    Utility::Set(obj, "decodeErrorCount", report.decodeErrorCount);
+    Utility::Set(obj, "sendErrorCount", report.sendErrorCount);
+    Utility::Set(obj, "ioErrorCount", report.ioErrorCount);
+    Utility::Set(obj, "resetCount", report.resetCount);
+    Utility::Set(obj, "eventCount", report.eventCount);
+    Utility::Set(obj, "eventBytes", static_cast<double>(report.eventBytes));
+    Utility::Set(obj, "timeSinceLastEvent", report.timeSinceLastEvent);
+    Utility::Set(obj, "notificationQueueDepth", static_cast<uint32_t>(notificationQueue.size()));
+    Utility::Set(obj, "commandQueueDepth", commandQueue->getDepth());
+    Utility::Set(obj, "logDroppedCount", getLogDroppedCount());
+    Utility::Set(obj, "uptime", report.uptime);
 
-    baton->callback->Call(2, argv);
-    delete baton;
+    return scope.Escape(obj);
 }
 
-NAN_INLINE sd_rpc_parity_t ToParityEnum(const v8::Handle<v8::String>& v8str)
+void Adapter::onHealthReportTimer(uv_timer_t *handle)
 {
-    sd_rpc_parity_t parity = SD_RPC_PARITY_NONE;
+    Nan::HandleScope scope;
 
-    if (v8str->Equals(Nan::New("none").ToLocalChecked()))
-    {
-        parity = SD_RPC_PARITY_NONE;
-    }
-    else if (v8str->Equals(Nan::New("even").ToLocalChecked()))
+    if (statusCallback == nullptr)
     {
-        parity = SD_RPC_PARITY_EVEN;
+        return;
     }
 
-    return parity;
+    auto status = Nan::New<v8::Object>();
+    Utility::Set(status, "id", HEALTH_REPORT);
+    Utility::Set(status, "name", "HEALTH_REPORT");
+    Utility::Set(status, "message", "Transport health report");
+    Utility::Set(status, "time", getCurrentTimeInMilliseconds());
+    Utility::Set(status, "health", static_cast<v8::Local<v8::Value>>(getHealthReport()));
+
+    v8::Local<v8::Value> argv[1];
+    argv[0] = status;
+    statusCallback->Call(1, argv);
 }
 
-NAN_INLINE sd_rpc_flow_control_t ToFlowControlEnum(const v8::Handle<v8::String>& v8str)
+NAN_METHOD(Adapter::GetHealthReport)
 {
-    sd_rpc_flow_control_t flow_control = SD_RPC_FLOW_CONTROL_NONE;
-
-    if (v8str->Equals(Nan::New("none").ToLocalChecked()))
-    {
-        flow_control = SD_RPC_FLOW_CONTROL_NONE;
-    }
-    else if (v8str->Equals(Nan::New("hw").ToLocalChecked()))
-    {
-        flow_control = SD_RPC_FLOW_CONTROL_HARDWARE;
-    }
-
-    return flow_control;
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    Utility::SetReturnValue(info, obj->getHealthReport());
 }
 
-NAN_INLINE sd_rpc_log_severity_t ToLogSeverityEnum(const v8::Handle<v8::String>& v8str)
+NAN_METHOD(Adapter::SetLescPrivateKey)
 {
-    sd_rpc_log_severity_t log_severity = SD_RPC_LOG_DEBUG;
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint8_t *sk = nullptr;
+    auto argumentcount = 0;
 
-    if (v8str->Equals(Nan::New("trace").ToLocalChecked()))
-    {
-        log_severity = SD_RPC_LOG_TRACE;
-    }
-    else if (v8str->Equals(Nan::New("debug").ToLocalChecked()))
-    {
-        log_severity = SD_RPC_LOG_DEBUG;
-    }
-    else if (v8str->Equals(Nan::New("info").ToLocalChecked()))
+    try
     {
-        log_severity = SD_RPC_LOG_INFO;
+        if (!info[argumentcount]->IsNull() && !info[argumentcount]->IsUndefined())
+        {
+            if (!info[argumentcount]->IsArray() || v8::Local<v8::Array>::Cast(info[argumentcount])->Length() != ECC_P256_SK_LEN)
+            {
+                throw std::string("array of 32 bytes");
+            }
+
+            sk = ConversionUtility::getNativePointerToUint8(info[argumentcount]);
+        }
+
+        argumentcount++;
     }
-    else if (v8str->Equals(Nan::New("error").ToLocalChecked()))
+    catch (std::string error)
     {
-        log_severity = SD_RPC_LOG_ERROR;
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
     }
-    else if (v8str->Equals(Nan::New("fatal").ToLocalChecked()))
+
+    obj->lescResponder.setPrivateKey(sk);
+
+    if (sk != nullptr)
     {
-        log_severity = SD_RPC_LOG_FATAL;
+        memset(sk, 0, ECC_P256_SK_LEN);
+        free(sk);
     }
-
-    return log_severity;
 }
 
-NAN_METHOD(Adapter::GetVersion)
+NAN_METHOD(Adapter::SetBondStore)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    std::string path;
     v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[0]);
+        if (!info[argumentcount]->IsNull() && !info[argumentcount]->IsUndefined())
+        {
+            path = ConversionUtility::getNativeString(info[argumentcount]);
+        }
+
+        argumentcount++;
+
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
+        argumentcount++;
     }
     catch (std::string error)
     {
-        auto message = ErrorMessage::getTypeErrorMessage(0, error);
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
         Nan::ThrowTypeError(message);
         return;
     }
 
-    auto version = new ble_version_t();
-    memset(version, 0, sizeof(ble_version_t));
-
-    auto baton = new GetVersionBaton(callback);
-    baton->version = version;
-    baton->adapter = obj->adapter;
-
-    uv_queue_work(uv_default_loop(), baton->req, GetVersion, reinterpret_cast<uv_after_work_cb>(AfterGetVersion));
+    auto baton = new BondStoreBaton(callback);
+    baton->mainObject = obj;
+    baton->path = path;
+    baton->remove = false;
+    baton->result = NRF_SUCCESS;
 
-    return;
-}
+    // The adapter must outlive the baton, a promise does not reference it
+    obj->Ref();
 
-void Adapter::GetVersion(uv_work_t *req)
-{
-    auto baton = static_cast<GetVersionBaton *>(req->data);
-    baton->result = sd_ble_version_get(baton->adapter, baton->version);
+    // The bond file is read and written on the bond store writer thread, waited for on the libuv threadpool
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, UpdateBondStore, reinterpret_cast<uv_after_work_cb>(AfterUpdateBondStore));
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
-// This runs in Main Thread
-void Adapter::AfterGetVersion(uv_work_t *req)
+NAN_METHOD(Adapter::GetBonds)
 {
-    Nan::HandleScope scope;
-    auto baton = static_cast<GetVersionBaton *>(req->data);
-    v8::Local<v8::Value> argv[2];
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto bonds = obj->bondStore.list();
+    auto array = Nan::New<v8::Array>(static_cast<uint32_t>(bonds.size()));
 
-    if (baton->result != NRF_SUCCESS)
-    {
-        argv[0] = Nan::Undefined();
-        argv[1] = ErrorMessage::getErrorMessage(baton->result, "getting version.");
-    }
-    else
+    for (size_t i = 0; i < bonds.size(); i++)
     {
-        argv[0] = Version(baton->version).ToJs();
-        argv[1] = Nan::Undefined();
+        auto &bond = bonds[i];
+
+        ble_gap_addr_t address;
+        memset(&address, 0, sizeof(address));
+        address.addr_type = bond.addrType;
+        memcpy(address.addr, bond.addr, BLE_GAP_ADDR_LEN);
+
+        // Keys stay native, JavaScript only learns what they are
+        auto key = bond.ownKeyValid ? &bond.ownKey : (bond.peerKeyValid ? &bond.peerKey : nullptr);
+
+        auto entry = Nan::New<v8::Object>();
+        Utility::Set(entry, "peer_addr", GapAddr(&address).ToJs());
+        Utility::Set(entry, "lesc", key != nullptr && key->lesc);
+        Utility::Set(entry, "auth", key != nullptr && key->auth);
+        Utility::Set(entry, "irk", bond.irkValid);
+        Nan::Set(array, static_cast<uint32_t>(i), entry);
+
+        memset(&bond, 0, sizeof(bond));
     }
 
-    baton->callback->Call(2, argv);
-    delete baton->version;
-    delete baton;
+    Utility::SetReturnValue(info, array);
 }
 
-NAN_METHOD(Adapter::EncodeUUID)
+NAN_METHOD(Adapter::DeleteBond)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    v8::Local<v8::Object> uuid;
+    std::unique_ptr<ble_gap_addr_t> address;
     v8::Local<v8::Function> callback;
     auto argumentcount = 0;
 
     try
     {
-        uuid = ConversionUtility::getJsObject(info[argumentcount]);
+        address.reset(GapAddr(ConversionUtility::getJsObject(info[argumentcount])));
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1075,75 +2678,94 @@ NAN_METHOD(Adapter::EncodeUUID)
         return;
     }
 
-    auto baton = new BleUUIDEncodeBaton(callback);
+    auto baton = new BondStoreBaton(callback);
+    baton->mainObject = obj;
+    baton->remove = true;
+    baton->address = *address;
+    baton->result = NRF_SUCCESS;
 
-    try
+    obj->Ref();
+
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, UpdateBondStore, reinterpret_cast<uv_after_work_cb>(AfterUpdateBondStore));
+    info.GetReturnValue().Set(baton->returnValue());
+}
+
+// This runs in a worker thread (not Main Thread)
+void Adapter::UpdateBondStore(uv_work_t *req)
+{
+    auto baton = static_cast<BondStoreBaton *>(req->data);
+    auto &bondStore = baton->mainObject->bondStore;
+    auto updated = true;
+
+    if (baton->remove)
     {
-        baton->p_uuid = BleUUID(uuid);
+        updated = bondStore.remove(baton->address.addr_type, baton->address.addr, baton->error);
     }
-    catch (std::string error)
+    else if (baton->path.empty())
     {
-        std::stringstream errormessage;
-        errormessage << "Could not process the UUID. Reason: " << error;
-        Nan::ThrowTypeError(errormessage.str().c_str());
-        return;
+        bondStore.close();
+    }
+    else
+    {
+        updated = bondStore.open(baton->path, baton->error);
     }
 
-    baton->uuid_le = new uint8_t[16];
-    baton->adapter = obj->adapter;
-
-    uv_queue_work(uv_default_loop(), baton->req, EncodeUUID, reinterpret_cast<uv_after_work_cb>(AfterEncodeUUID));
-
-    return;
-}
-
-void Adapter::EncodeUUID(uv_work_t *req)
-{
-    auto baton = static_cast<BleUUIDEncodeBaton *>(req->data);
-    baton->result = sd_ble_uuid_encode(baton->adapter, baton->p_uuid, &baton->uuid_le_len, baton->uuid_le);
+    baton->result = updated ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
 }
 
 // This runs in Main Thread
-void Adapter::AfterEncodeUUID(uv_work_t *req)
+void Adapter::AfterUpdateBondStore(uv_work_t *req)
 {
     Nan::HandleScope scope;
-    auto baton = static_cast<BleUUIDEncodeBaton *>(req->data);
-    v8::Local<v8::Value> argv[4];
+    auto baton = static_cast<BondStoreBaton *>(req->data);
+
+    v8::Local<v8::Value> argv[1];
 
     if (baton->result != NRF_SUCCESS)
     {
-        argv[0] = ErrorMessage::getErrorMessage(baton->result, "encoding UUID.");
-        argv[1] = Nan::Undefined();
-        argv[2] = Nan::Undefined();
-        argv[3] = Nan::Undefined();
+        argv[0] = v8::Exception::Error(Nan::New(baton->error).ToLocalChecked());
     }
     else
     {
         argv[0] = Nan::Undefined();
-        argv[1] = ConversionUtility::toJsNumber(baton->uuid_le_len);
-        argv[2] = ConversionUtility::toJsValueArray(baton->uuid_le, baton->uuid_le_len);
-        argv[3] = ConversionUtility::encodeHex(reinterpret_cast<char *>(baton->uuid_le), baton->uuid_le_len);
     }
 
-    baton->callback->Call(4, argv);
-    delete baton->uuid_le;
+    baton->mainObject->Unref();
+    baton->deliver(1, argv);
     delete baton;
 }
 
-NAN_METHOD(Adapter::DecodeUUID)
+NAN_METHOD(Adapter::SetHealthReportInterval)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    uint8_t le_len;
-    v8::Local<v8::Value> uuid_le;
-    v8::Local<v8::Function> callback;
+    uint32_t interval;
     auto argumentcount = 0;
 
     try
     {
-        le_len = ConversionUtility::getNativeUint8(info[argumentcount]);
+        interval = ConversionUtility::getNativeUint32(info[argumentcount]);
         argumentcount++;
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
 
-        uuid_le = info[argumentcount]->ToString();
+    obj->setHealthReportInterval(interval);
+}
+
+NAN_METHOD(Adapter::DumpFlightRecorder)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    std::string path;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        path = ConversionUtility::getNativeString(info[argumentcount]);
         argumentcount++;
 
         callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
@@ -1156,58 +2778,67 @@ NAN_METHOD(Adapter::DecodeUUID)
         return;
     }
 
-    auto baton = new BleUUIDDecodeBaton(callback);
-    baton->uuid_le_len = le_len;
-    baton->uuid_le = ConversionUtility::extractHex(uuid_le);
-    baton->p_uuid = new ble_uuid_t();
-    baton->adapter = obj->adapter;
-
-    uv_queue_work(uv_default_loop(), baton->req, DecodeUUID, reinterpret_cast<uv_after_work_cb>(AfterDecodeUUID));
+    auto baton = new FlightRecorderDumpBaton(callback);
+    baton->path = path;
+    baton->data = obj->flightRecorder.dump();
+    baton->result = 0;
 
-    return;
+    // Written on the libuv threadpool, the command thread may be the one that is stuck
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, WriteFlightRecorderDump, reinterpret_cast<uv_after_work_cb>(AfterWriteFlightRecorderDump));
 }
 
-void Adapter::DecodeUUID(uv_work_t *req)
+// This runs in a worker thread (not Main Thread)
+void Adapter::WriteFlightRecorderDump(uv_work_t *req)
 {
-    auto baton = static_cast<BleUUIDDecodeBaton *>(req->data);
-    baton->result = sd_ble_uuid_decode(baton->adapter, baton->uuid_le_len, baton->uuid_le, baton->p_uuid);
+    auto baton = static_cast<FlightRecorderDumpBaton *>(req->data);
+    auto file = fopen(baton->path.c_str(), "wb");
+
+    if (file == nullptr)
+    {
+        baton->result = errno;
+        return;
+    }
+
+    if (fwrite(baton->data.data(), 1, baton->data.size(), file) != baton->data.size())
+    {
+        baton->result = errno;
+    }
+
+    if (fclose(file) != 0 && baton->result == 0)
+    {
+        baton->result = errno;
+    }
 }
 
 // This runs in Main Thread
-void Adapter::AfterDecodeUUID(uv_work_t *req)
+void Adapter::AfterWriteFlightRecorderDump(uv_work_t *req)
 {
     Nan::HandleScope scope;
-    auto baton = static_cast<BleUUIDDecodeBaton *>(req->data);
+    auto baton = static_cast<FlightRecorderDumpBaton *>(req->data);
+
     v8::Local<v8::Value> argv[2];
 
-    if (baton->result != NRF_SUCCESS)
+    if (baton->result != 0)
     {
-        argv[0] = ErrorMessage::getErrorMessage(baton->result, "decoding UUID.");
+        std::stringstream message;
+        message << "Failed to write flight recorder to " << baton->path << ": " << strerror(baton->result);
+        argv[0] = v8::Exception::Error(Nan::New(message.str()).ToLocalChecked());
         argv[1] = Nan::Undefined();
     }
     else
     {
         argv[0] = Nan::Undefined();
-        argv[1] = BleUUID(baton->p_uuid);
+        argv[1] = ConversionUtility::toJsNumber(static_cast<uint32_t>(baton->data.size()));
     }
 
-    baton->callback->Call(2, argv);
-    delete baton->p_uuid;
-    delete baton->uuid_le;
+    baton->deliver(2, argv);
     delete baton;
 }
 
-NAN_METHOD(Adapter::GetStats)
+NAN_METHOD(Adapter::GetTrace)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    auto stats = Nan::New<v8::Object>();
-
-    Utility::Set(stats, "eventCallbackTotalTime", obj->getEventCallbackTotalTime());
-    Utility::Set(stats, "eventCallbackTotalCount", obj->getEventCallbackCount());
-    Utility::Set(stats, "eventCallbackBatchMaxCount", obj->getEventCallbackMaxCount());
-    Utility::Set(stats, "eventCallbackBatchAvgCount", obj->getAverageCallbackBatchCount());
-
-    Utility::SetReturnValue(info, stats);
+    info.GetReturnValue().Set(ConversionUtility::toJsString(obj->traceBuffer.toChromeTraceJson()));
 }
 
 NAN_METHOD(Adapter::ReplyUserMemory)
@@ -1226,7 +2857,7 @@ NAN_METHOD(Adapter::ReplyUserMemory)
         mem_block = ConversionUtility::getJsObjectOrNull(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1251,7 +2882,8 @@ NAN_METHOD(Adapter::ReplyUserMemory)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, ReplyUserMemory, reinterpret_cast<uv_after_work_cb>(AfterReplyUserMemory));
+    obj->commandQueue->enqueue(baton->req, ReplyUserMemory, reinterpret_cast<uv_after_work_cb>(AfterReplyUserMemory), "ReplyUserMemory");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 void Adapter::ReplyUserMemory(uv_work_t *req)
@@ -1276,7 +2908,7 @@ void Adapter::AfterReplyUserMemory(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton->p_block;
     delete baton;
 }
@@ -1300,7 +2932,7 @@ NAN_METHOD(Adapter::SetBleOption)
         optionObject = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1325,7 +2957,8 @@ NAN_METHOD(Adapter::SetBleOption)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, SetBleOption, reinterpret_cast<uv_after_work_cb>(AfterSetBleOption));
+    obj->commandQueue->enqueue(baton->req, SetBleOption, reinterpret_cast<uv_after_work_cb>(AfterSetBleOption), "SetBleOption");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1333,6 +2966,15 @@ void Adapter::SetBleOption(uv_work_t *req)
 {
     auto baton = static_cast<BleOptionBaton *>(req->data);
     baton->result = sd_ble_opt_set(baton->adapter, baton->opt_id, baton->p_opt);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        auto opt_id = baton->opt_id;
+        auto opt = *baton->p_opt;
+        recordConfiguration(baton->adapter, "SetBleOption", std::to_string(opt_id), [=](adapter_t *adapter) {
+            return sd_ble_opt_set(adapter, opt_id, &opt);
+        });
+    }
 }
 
 // This runs in  Main Thread
@@ -1352,7 +2994,7 @@ void Adapter::AfterSetBleOption(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -1373,7 +3015,7 @@ NAN_METHOD(Adapter::GetBleOption)
         optionId = ConversionUtility::getNativeUint32(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1388,7 +3030,8 @@ NAN_METHOD(Adapter::GetBleOption)
     baton->opt_id = optionId;
     baton->p_opt = new ble_opt_t();
 
-    uv_queue_work(uv_default_loop(), baton->req, GetBleOption, reinterpret_cast<uv_after_work_cb>(AfterGetBleOption));
+    obj->commandQueue->enqueue(baton->req, GetBleOption, reinterpret_cast<uv_after_work_cb>(AfterGetBleOption), "GetBleOption");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1429,7 +3072,7 @@ void Adapter::AfterGetBleOption(uv_work_t *req)
         argv[1] = optionValue;
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
     delete baton->p_opt;
     delete baton;
 }
@@ -1768,6 +3411,7 @@ extern "C" {
         init_gatts(target);
 
         Adapter::Init(target);
+        AdapterPool::Init(target);
 
         init_uecc(target);
     }
@@ -1775,6 +3419,8 @@ extern "C" {
     void init_adapter_list(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target)
     {
         Utility::SetMethod(target, "getAdapters", GetAdapterList);
+        Utility::SetMethod(target, "watchAdapters", WatchAdapters);
+        Utility::SetMethod(target, "unwatchAdapters", UnwatchAdapters);
     }
 
     void init_driver(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target)
@@ -2055,7 +3701,13 @@ extern "C" {
         NODE_DEFINE_CONSTANT(target, IO_RESOURCES_UNAVAILABLE);
         NODE_DEFINE_CONSTANT(target, RESET_PERFORMED);
         NODE_DEFINE_CONSTANT(target, CONNECTION_ACTIVE);
+        NODE_DEFINE_CONSTANT(target, HEALTH_REPORT);
     }
 }
 
+#ifdef NAN_MODULE_WORKER_ENABLED
+// The addon keeps no per-process JavaScript state and can be loaded by worker threads
+NAN_MODULE_WORKER_ENABLED(ble_driver, init)
+#else
 NODE_MODULE(ble_driver, init)
+#endif
@@ -37,7 +37,10 @@
 #ifndef BLE_DRIVER_JS_DRIVER_H
 #define BLE_DRIVER_JS_DRIVER_H
 
+#include <functional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <sd_rpc.h>
 #include "common.h"
@@ -230,6 +233,17 @@ public:
 
 ///// Start Batons ////////////////////////////////////////
 
+struct OpenBaton;
+
+// An operation of the init script given to Open. Runs on the command thread right after the BLE stack
+// is enabled, and records itself in the configuration journal when it succeeds, like the command it stands for.
+struct InitScriptStep
+{
+public:
+    const char *name;
+    std::function<uint32_t(OpenBaton *)> run;
+};
+
 struct OpenBaton : public Baton
 {
 public:
@@ -255,9 +269,38 @@ public:
     bool enable_ble; // Enable BLE or not when connecting, if not the developer must enable the BLE when state is active
     ble_enable_params_t *ble_enable_params; // If enable BLE is true, then use these params when enabling BLE
 
+    std::vector<InitScriptStep> init_script;
+    const char *failed_step; // Name of the init script step that failed, nullptr if the script succeeded
+    uint32_t init_script_time;
+    std::vector<std::pair<uint8_t, ble_uuid128_t>> vendor_uuids; // UUID types given to the bases added by the script
+
     Adapter *mainObject;
 };
 
+struct BondStoreBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(BondStoreBaton)
+    Adapter *mainObject;
+
+    // An empty path closes the store
+    std::string path;
+
+    // Set for deleteBond
+    bool remove;
+    ble_gap_addr_t address;
+
+    std::string error;
+};
+
+struct FlightRecorderDumpBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(FlightRecorderDumpBaton)
+    std::string path;
+    std::vector<uint8_t> data;
+};
+
 struct CloseBaton : public Baton
 {
 public:
@@ -272,12 +315,25 @@ public:
     Adapter *mainObject;
 };
 
+struct ReinitializeBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(ReinitializeBaton);
+    uint32_t reset_timeout;
+    const char *failed_step;
+    uint32_t replayed_count;
+    double reset_time;
+    double replay_time;
+    Adapter *mainObject;
+};
+
 struct EnableBLEBaton : public Baton
 {
 public:
     BATON_CONSTRUCTOR(EnableBLEBaton)
     ble_enable_params_t *enable_params;
     uint32_t app_ram_base;
+    Adapter *mainObject;
 };
 
 
@@ -295,6 +351,7 @@ public:
     BATON_CONSTRUCTOR(BleAddVendorSpcificUUIDBaton);
     ble_uuid128_t *p_vs_uuid;
     uint8_t p_uuid_type;
+    Adapter *mainObject;
 };
 
 class BleUUIDEncodeBaton : public Baton
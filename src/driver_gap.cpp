@@ -41,6 +41,7 @@
 #include <cstdio>
 #include <mutex>
 #include <memory>
+#include <vector>
 
 // stdout for debugging
 #include <iostream>
@@ -1504,7 +1505,7 @@ NAN_METHOD(Adapter::GapSetAddress)
         addressObject = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1530,8 +1531,12 @@ NAN_METHOD(Adapter::GapSetAddress)
         return;
     }
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetAddress, reinterpret_cast<uv_after_work_cb>(AfterGapSetAddress));
+    obj->addressCached = false;
+
+    obj->commandQueue->enqueue(baton->req, GapSetAddress, reinterpret_cast<uv_after_work_cb>(AfterGapSetAddress), "GapSetAddress");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 void Adapter::GapSetAddress(uv_work_t *req)
@@ -1542,6 +1547,21 @@ void Adapter::GapSetAddress(uv_work_t *req)
 #elif NRF_SD_BLE_API_VERSION >= 3
     baton->result = sd_ble_gap_addr_set(baton->adapter, baton->address);
 #endif
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        auto address = *baton->address;
+#if NRF_SD_BLE_API_VERSION <= 2
+        auto addr_cycle_mode = baton->addr_cycle_mode;
+        recordConfiguration(baton->adapter, "GapSetAddress", "", [=](adapter_t *adapter) {
+            return sd_ble_gap_address_set(adapter, addr_cycle_mode, &address);
+        });
+#elif NRF_SD_BLE_API_VERSION >= 3
+        recordConfiguration(baton->adapter, "GapSetAddress", "", [=](adapter_t *adapter) {
+            return sd_ble_gap_addr_set(adapter, &address);
+        });
+#endif
+    }
 }
 
 // This runs in Main Thread
@@ -1552,6 +1572,9 @@ void Adapter::AfterGapSetAddress(uv_work_t *req)
     auto baton = static_cast<GapAddressSetBaton *>(req->data);
     v8::Local<v8::Value> argv[1];
 
+    // A get queued before this call may have cached the previous address
+    baton->mainObject->addressCached = false;
+
     if (baton->result != NRF_SUCCESS)
     {
         argv[0] = ErrorMessage::getErrorMessage(baton->result, "setting address.");
@@ -1561,7 +1584,7 @@ void Adapter::AfterGapSetAddress(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
 
     delete baton;
 }
@@ -1578,7 +1601,7 @@ NAN_METHOD(Adapter::GapGetAddress)
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1591,10 +1614,13 @@ NAN_METHOD(Adapter::GapGetAddress)
     auto address = new ble_gap_addr_t();
 
     auto baton = new GapAddressGetBaton(callback);
+    baton->errorLast = true;
     baton->address = address;
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetAddress, reinterpret_cast<uv_after_work_cb>(AfterGapGetAddress));
+    obj->commandQueue->enqueue(baton->req, GapGetAddress, reinterpret_cast<uv_after_work_cb>(AfterGapGetAddress), "GapGetAddress");
+    info.GetReturnValue().Set(baton->returnValue());
 
     return;
 }
@@ -1625,14 +1651,36 @@ void Adapter::AfterGapGetAddress(uv_work_t *req)
     }
     else
     {
+        // Private addresses are cycled by the SoftDevice and can not be cached
+        if (baton->address->addr_type == BLE_GAP_ADDR_TYPE_PUBLIC ||
+            baton->address->addr_type == BLE_GAP_ADDR_TYPE_RANDOM_STATIC)
+        {
+            baton->mainObject->cachedAddress = *baton->address;
+            baton->mainObject->addressCached = true;
+        }
+
         argv[0] = GapAddr(baton->address).ToJs();
         argv[1] = Nan::Undefined();
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
+    delete baton->address;
     delete baton;
 }
 
+NAN_METHOD(Adapter::GapGetAddressSync)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+
+    if (!obj->addressCached)
+    {
+        info.GetReturnValue().SetUndefined();
+        return;
+    }
+
+    Utility::SetReturnValue(info, GapAddr(&obj->cachedAddress).ToJs());
+}
+
 #pragma endregion GapGetAddress
 
 #pragma region GapUpdateConnectionParameters
@@ -1653,7 +1701,7 @@ NAN_METHOD(Adapter::GapUpdateConnectionParameters)
         connParamsObject = ConversionUtility::getJsObjectOrNull(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1678,7 +1726,8 @@ NAN_METHOD(Adapter::GapUpdateConnectionParameters)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapUpdateConnectionParameters, reinterpret_cast<uv_after_work_cb>(AfterGapUpdateConnectionParameters));
+    obj->commandQueue->enqueue(baton->req, GapUpdateConnectionParameters, reinterpret_cast<uv_after_work_cb>(AfterGapUpdateConnectionParameters), "GapUpdateConnectionParameters");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1707,7 +1756,7 @@ void Adapter::AfterGapUpdateConnectionParameters(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -1731,7 +1780,7 @@ NAN_METHOD(Adapter::GapDisconnect)
         hci_status_code = ConversionUtility::getNativeUint8(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1746,7 +1795,8 @@ NAN_METHOD(Adapter::GapDisconnect)
     baton->hci_status_code = hci_status_code;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapDisconnect, reinterpret_cast<uv_after_work_cb>(AfterGapDisconnect));
+    obj->commandQueue->enqueue(baton->req, GapDisconnect, reinterpret_cast<uv_after_work_cb>(AfterGapDisconnect), "GapDisconnect");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1773,7 +1823,7 @@ void Adapter::AfterGapDisconnect(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -1793,7 +1843,7 @@ NAN_METHOD(Adapter::GapSetTXPower)
         tx_power = ConversionUtility::getNativeInt8(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1808,7 +1858,8 @@ NAN_METHOD(Adapter::GapSetTXPower)
     baton->tx_power = tx_power;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetTXPower, reinterpret_cast<uv_after_work_cb>(AfterGapSetTXPower));
+    obj->commandQueue->enqueue(baton->req, GapSetTXPower, reinterpret_cast<uv_after_work_cb>(AfterGapSetTXPower), "GapSetTXPower");
+    info.GetReturnValue().Set(baton->returnValue());
 
 }
 
@@ -1817,6 +1868,14 @@ void Adapter::GapSetTXPower(uv_work_t *req)
 {
     auto baton = static_cast<TXPowerBaton *>(req->data);
     baton->result = sd_ble_gap_tx_power_set(baton->adapter, baton->tx_power);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        auto tx_power = baton->tx_power;
+        recordConfiguration(baton->adapter, "GapSetTXPower", "", [=](adapter_t *adapter) {
+            return sd_ble_gap_tx_power_set(adapter, tx_power);
+        });
+    }
 }
 
 // This runs in Main Thread
@@ -1836,7 +1895,7 @@ void Adapter::AfterGapSetTXPower(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -1860,7 +1919,7 @@ NAN_METHOD(Adapter::GapSetDeviceName)
         dev_name = ConversionUtility::getNativePointerToUint8(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1888,8 +1947,12 @@ NAN_METHOD(Adapter::GapSetDeviceName)
     baton->dev_name = dev_name;
     baton->length = (uint16_t)length;
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetDeviceName, reinterpret_cast<uv_after_work_cb>(AfterGapSetDeviceName));
+    obj->deviceNameCached = false;
+
+    obj->commandQueue->enqueue(baton->req, GapSetDeviceName, reinterpret_cast<uv_after_work_cb>(AfterGapSetDeviceName), "GapSetDeviceName");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1897,6 +1960,15 @@ void Adapter::GapSetDeviceName(uv_work_t *req)
 {
     auto baton = static_cast<GapSetDeviceNameBaton *>(req->data);
     baton->result = sd_ble_gap_device_name_set(baton->adapter, baton->conn_sec_mode, baton->dev_name, baton->length);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        auto conn_sec_mode = *baton->conn_sec_mode;
+        auto name = std::vector<uint8_t>(baton->dev_name, baton->dev_name + baton->length);
+        recordConfiguration(baton->adapter, "GapSetDeviceName", "", [=](adapter_t *adapter) {
+            return sd_ble_gap_device_name_set(adapter, &conn_sec_mode, name.data(), static_cast<uint16_t>(name.size()));
+        });
+    }
 }
 
 // This runs in Main Thread
@@ -1908,6 +1980,9 @@ void Adapter::AfterGapSetDeviceName(uv_work_t *req)
     auto baton = static_cast<GapSetDeviceNameBaton *>(req->data);
     v8::Local<v8::Value> argv[1];
 
+    // A get queued before this call may have cached the previous name
+    baton->mainObject->deviceNameCached = false;
+
     if (baton->result != NRF_SUCCESS)
     {
         argv[0] = ErrorMessage::getErrorMessage(baton->result, "setting device name.");
@@ -1917,7 +1992,7 @@ void Adapter::AfterGapSetDeviceName(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     free(baton->dev_name);
     delete baton;
 }
@@ -1934,7 +2009,7 @@ NAN_METHOD(Adapter::GapGetDeviceName)
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1945,12 +2020,15 @@ NAN_METHOD(Adapter::GapGetDeviceName)
     }
 
     auto baton = new GapGetDeviceNameBaton(callback);
+    baton->errorLast = true;
 
     baton->length = 248; // Max length of Device name characteristic
     baton->dev_name = static_cast<uint8_t*>(malloc(baton->length));
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetDeviceName, reinterpret_cast<uv_after_work_cb>(AfterGapGetDeviceName));
+    obj->commandQueue->enqueue(baton->req, GapGetDeviceName, reinterpret_cast<uv_after_work_cb>(AfterGapGetDeviceName), "GapGetDeviceName");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1980,15 +2058,31 @@ void Adapter::AfterGapGetDeviceName(uv_work_t *req)
 
         v8::Local<v8::Value> dev_name = ConversionUtility::toJsString(reinterpret_cast<char *>(baton->dev_name));
 
+        baton->mainObject->cachedDeviceName = std::string(reinterpret_cast<char *>(baton->dev_name));
+        baton->mainObject->deviceNameCached = true;
+
         argv[0] = dev_name;
         argv[1] = Nan::Undefined();
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
     free(baton->dev_name);
     delete baton;
 }
 
+NAN_METHOD(Adapter::GapGetDeviceNameSync)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+
+    if (!obj->deviceNameCached)
+    {
+        info.GetReturnValue().SetUndefined();
+        return;
+    }
+
+    info.GetReturnValue().Set(ConversionUtility::toJsString(obj->cachedDeviceName));
+}
+
 #pragma endregion GapGetDeviceName
 
 #pragma region GapStartRSSI
@@ -2013,7 +2107,7 @@ NAN_METHOD(Adapter::GapStartRSSI)
         skip_count = ConversionUtility::getNativeUint8(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2029,7 +2123,8 @@ NAN_METHOD(Adapter::GapStartRSSI)
     baton->skip_count = skip_count;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStartRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapStartRSSI));
+    obj->commandQueue->enqueue(baton->req, GapStartRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapStartRSSI), "GapStartRSSI");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2056,7 +2151,7 @@ void Adapter::AfterGapStartRSSI(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -2076,7 +2171,7 @@ NAN_METHOD(Adapter::GapStopRSSI)
         conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2090,7 +2185,8 @@ NAN_METHOD(Adapter::GapStopRSSI)
     baton->conn_handle = conn_handle;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStopRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapStopRSSI));
+    obj->commandQueue->enqueue(baton->req, GapStopRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapStopRSSI), "GapStopRSSI");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2117,7 +2213,7 @@ void Adapter::AfterGapStopRSSI(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -2137,7 +2233,7 @@ NAN_METHOD(Adapter::GapStartScan)
         options = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2153,7 +2249,8 @@ NAN_METHOD(Adapter::GapStartScan)
     baton->scan_params = params;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStartScan, reinterpret_cast<uv_after_work_cb>(AfterGapStartScan));
+    obj->commandQueue->enqueue(baton->req, GapStartScan, reinterpret_cast<uv_after_work_cb>(AfterGapStartScan), "GapStartScan");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2180,7 +2277,7 @@ void Adapter::AfterGapStartScan(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -2196,7 +2293,7 @@ NAN_METHOD(Adapter::GapStopScan)
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2209,7 +2306,8 @@ NAN_METHOD(Adapter::GapStopScan)
     auto baton = new StopScanBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStopScan, reinterpret_cast<uv_after_work_cb>(AfterGapStopScan));
+    obj->commandQueue->enqueue(baton->req, GapStopScan, reinterpret_cast<uv_after_work_cb>(AfterGapStopScan), "GapStopScan");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2236,7 +2334,7 @@ void Adapter::AfterGapStopScan(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -2264,7 +2362,7 @@ NAN_METHOD(Adapter::GapConnect)
         conn_params = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2311,7 +2409,9 @@ NAN_METHOD(Adapter::GapConnect)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GapConnect, reinterpret_cast<uv_after_work_cb>(AfterGapConnect));
+    obj->connectAttemptStarted();
+    obj->commandQueue->enqueue(baton->req, GapConnect, reinterpret_cast<uv_after_work_cb>(AfterGapConnect), "GapConnect");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2332,13 +2432,20 @@ void Adapter::AfterGapConnect(uv_work_t *req)
     if (baton->result != NRF_SUCCESS)
     {
         argv[0] = ErrorMessage::getErrorMessage(baton->result, "connecting");
+
+        auto adapter = getAdapter(baton->adapter);
+
+        if (adapter != nullptr)
+        {
+            adapter->connectAttemptEnded();
+        }
     }
     else
     {
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -2354,7 +2461,7 @@ NAN_METHOD(Adapter::GapCancelConnect)
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2367,7 +2474,8 @@ NAN_METHOD(Adapter::GapCancelConnect)
     auto baton = new GapConnectCancelBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapCancelConnect, reinterpret_cast<uv_after_work_cb>(AfterGapCancelConnect));
+    obj->commandQueue->enqueue(baton->req, GapCancelConnect, reinterpret_cast<uv_after_work_cb>(AfterGapCancelConnect), "GapCancelConnect");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2391,10 +2499,17 @@ void Adapter::AfterGapCancelConnect(uv_work_t *req)
     }
     else
     {
+        auto adapter = getAdapter(baton->adapter);
+
+        if (adapter != nullptr)
+        {
+            adapter->connectAttemptEnded();
+        }
+
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -2413,7 +2528,7 @@ NAN_METHOD(Adapter::GapGetRSSI)
         conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2424,11 +2539,13 @@ NAN_METHOD(Adapter::GapGetRSSI)
     }
 
     auto baton = new GapGetRSSIBaton(callback);
+    baton->errorLast = true;
     baton->conn_handle = conn_handle;
     baton->rssi = 0;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapGetRSSI));
+    obj->commandQueue->enqueue(baton->req, GapGetRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapGetRSSI), "GapGetRSSI");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2461,7 +2578,7 @@ void Adapter::AfterGapGetRSSI(uv_work_t *req)
         argv[1] = Nan::Undefined();
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
     delete baton;
 }
 
@@ -2481,7 +2598,7 @@ NAN_METHOD(Adapter::GapStartAdvertising)
         adv_params = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2504,7 +2621,8 @@ NAN_METHOD(Adapter::GapStartAdvertising)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStartAdvertising, reinterpret_cast<uv_after_work_cb>(AfterGapStartAdvertising));
+    obj->commandQueue->enqueue(baton->req, GapStartAdvertising, reinterpret_cast<uv_after_work_cb>(AfterGapStartAdvertising), "GapStartAdvertising");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2532,7 +2650,7 @@ void Adapter::AfterGapStartAdvertising(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -2548,7 +2666,7 @@ NAN_METHOD(Adapter::GapStopAdvertising)
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2561,7 +2679,8 @@ NAN_METHOD(Adapter::GapStopAdvertising)
     auto baton = new GapStopAdvertisingBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStopAdvertising, reinterpret_cast<uv_after_work_cb>(AfterGapStopAdvertising));
+    obj->commandQueue->enqueue(baton->req, GapStopAdvertising, reinterpret_cast<uv_after_work_cb>(AfterGapStopAdvertising), "GapStopAdvertising");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2588,7 +2707,7 @@ void Adapter::AfterGapStopAdvertising(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -2608,7 +2727,7 @@ NAN_METHOD(Adapter::GapGetConnectionSecurity)
         conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2623,7 +2742,8 @@ NAN_METHOD(Adapter::GapGetConnectionSecurity)
     baton->conn_sec = new ble_gap_conn_sec_t();
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetConnectionSecurity, reinterpret_cast<uv_after_work_cb>(AfterGapGetConnectionSecurity));
+    obj->commandQueue->enqueue(baton->req, GapGetConnectionSecurity, reinterpret_cast<uv_after_work_cb>(AfterGapGetConnectionSecurity), "GapGetConnectionSecurity");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2652,7 +2772,7 @@ void Adapter::AfterGapGetConnectionSecurity(uv_work_t *req)
         argv[1] = GapConnSec(baton->conn_sec).ToJs();
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
     delete baton->conn_sec;
     delete baton;
 }
@@ -2681,7 +2801,7 @@ NAN_METHOD(Adapter::GapEncrypt)
         enc_info_object = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2717,7 +2837,8 @@ NAN_METHOD(Adapter::GapEncrypt)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapEncrypt, reinterpret_cast<uv_after_work_cb>(AfterGapEncrypt));
+    obj->commandQueue->enqueue(baton->req, GapEncrypt, reinterpret_cast<uv_after_work_cb>(AfterGapEncrypt), "GapEncrypt");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 void Adapter::GapEncrypt(uv_work_t *req)
@@ -2742,7 +2863,7 @@ void Adapter::AfterGapEncrypt(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 #pragma endregion GapEncrypt
@@ -2772,7 +2893,7 @@ NAN_METHOD(Adapter::GapReplySecurityParameters)
         sec_keyset_object = ConversionUtility::getJsObjectOrNull(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2849,7 +2970,8 @@ NAN_METHOD(Adapter::GapReplySecurityParameters)
 
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplySecurityParameters, reinterpret_cast<uv_after_work_cb>(AfterGapReplySecurityParameters));
+    obj->commandQueue->enqueue(baton->req, GapReplySecurityParameters, reinterpret_cast<uv_after_work_cb>(AfterGapReplySecurityParameters), "GapReplySecurityParameters");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2891,7 +3013,7 @@ void Adapter::AfterGapReplySecurityParameters(uv_work_t *req)
         }
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
     delete baton;
 }
 
@@ -2922,7 +3044,7 @@ NAN_METHOD(Adapter::GapReplySecurityInfo)
         sign_info_object = ConversionUtility::getJsObjectOrNull(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -2970,7 +3092,8 @@ NAN_METHOD(Adapter::GapReplySecurityInfo)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplySecurityInfo, reinterpret_cast<uv_after_work_cb>(AfterGapReplySecurityInfo));
+    obj->commandQueue->enqueue(baton->req, GapReplySecurityInfo, reinterpret_cast<uv_after_work_cb>(AfterGapReplySecurityInfo), "GapReplySecurityInfo");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 void Adapter::GapReplySecurityInfo(uv_work_t *req)
@@ -2995,7 +3118,7 @@ void Adapter::AfterGapReplySecurityInfo(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -3019,7 +3142,7 @@ NAN_METHOD(Adapter::GapAuthenticate)
         sec_params = ConversionUtility::getJsObjectOrNull(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3044,7 +3167,8 @@ NAN_METHOD(Adapter::GapAuthenticate)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapAuthenticate, reinterpret_cast<uv_after_work_cb>(AfterGapAuthenticate));
+    obj->commandQueue->enqueue(baton->req, GapAuthenticate, reinterpret_cast<uv_after_work_cb>(AfterGapAuthenticate), "GapAuthenticate");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3071,7 +3195,7 @@ void Adapter::AfterGapAuthenticate(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -3119,7 +3243,7 @@ NAN_METHOD(Adapter::GapSetAdvertisingData)
         }
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3136,7 +3260,8 @@ NAN_METHOD(Adapter::GapSetAdvertisingData)
     baton->srdlen = scan_response_length;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetAdvertisingData, reinterpret_cast<uv_after_work_cb>(AfterGapSetAdvertisingData));
+    obj->commandQueue->enqueue(baton->req, GapSetAdvertisingData, reinterpret_cast<uv_after_work_cb>(AfterGapSetAdvertisingData), "GapSetAdvertisingData");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3144,6 +3269,17 @@ void Adapter::GapSetAdvertisingData(uv_work_t *req)
 {
     auto baton = static_cast<GapSetAdvertisingDataBaton *>(req->data);
     baton->result = sd_ble_gap_adv_data_set(baton->adapter, baton->data, baton->dlen, baton->sr_data, baton->srdlen);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        auto data = std::vector<uint8_t>(baton->data, baton->data + baton->dlen);
+        auto sr_data = std::vector<uint8_t>(baton->sr_data, baton->sr_data + baton->srdlen);
+        recordConfiguration(baton->adapter, "GapSetAdvertisingData", "", [=](adapter_t *adapter) {
+            return sd_ble_gap_adv_data_set(adapter,
+                data.empty() ? nullptr : data.data(), static_cast<uint8_t>(data.size()),
+                sr_data.empty() ? nullptr : sr_data.data(), static_cast<uint8_t>(sr_data.size()));
+        });
+    }
 }
 
 // This runs in Main Thread
@@ -3163,7 +3299,7 @@ void Adapter::AfterGapSetAdvertisingData(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -3183,7 +3319,7 @@ NAN_METHOD(Adapter::GapSetPPCP)
         connectionParameters = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3207,7 +3343,8 @@ NAN_METHOD(Adapter::GapSetPPCP)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetPPCP, reinterpret_cast<uv_after_work_cb>(AfterGapSetPPCP));
+    obj->commandQueue->enqueue(baton->req, GapSetPPCP, reinterpret_cast<uv_after_work_cb>(AfterGapSetPPCP), "GapSetPPCP");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3215,6 +3352,14 @@ void Adapter::GapSetPPCP(uv_work_t *req)
 {
     auto baton = static_cast<GapSetPPCPBaton *>(req->data);
     baton->result = sd_ble_gap_ppcp_set(baton->adapter, baton->p_conn_params);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        auto conn_params = *baton->p_conn_params;
+        recordConfiguration(baton->adapter, "GapSetPPCP", "", [=](adapter_t *adapter) {
+            return sd_ble_gap_ppcp_set(adapter, &conn_params);
+        });
+    }
 }
 
 // This runs in Main Thread
@@ -3234,7 +3379,7 @@ void Adapter::AfterGapSetPPCP(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton->p_conn_params;
     delete baton;
 }
@@ -3251,7 +3396,7 @@ NAN_METHOD(Adapter::GapGetPPCP)
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3265,7 +3410,8 @@ NAN_METHOD(Adapter::GapGetPPCP)
     baton->p_conn_params = new ble_gap_conn_params_t();
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetPPCP, reinterpret_cast<uv_after_work_cb>(AfterGapGetPPCP));
+    obj->commandQueue->enqueue(baton->req, GapGetPPCP, reinterpret_cast<uv_after_work_cb>(AfterGapGetPPCP), "GapGetPPCP");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3294,7 +3440,7 @@ void Adapter::AfterGapGetPPCP(uv_work_t *req)
         argv[1] = GapConnParams(baton->p_conn_params);
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
     delete baton->p_conn_params;
     delete baton;
 }
@@ -3315,7 +3461,7 @@ NAN_METHOD(Adapter::GapSetAppearance)
         appearance = ConversionUtility::getNativeUint16(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3329,7 +3475,8 @@ NAN_METHOD(Adapter::GapSetAppearance)
     baton->appearance = appearance;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetAppearance, reinterpret_cast<uv_after_work_cb>(AfterGapSetAppearance));
+    obj->commandQueue->enqueue(baton->req, GapSetAppearance, reinterpret_cast<uv_after_work_cb>(AfterGapSetAppearance), "GapSetAppearance");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3337,6 +3484,14 @@ void Adapter::GapSetAppearance(uv_work_t *req)
 {
     auto baton = static_cast<GapSetAppearanceBaton *>(req->data);
     baton->result = sd_ble_gap_appearance_set(baton->adapter, baton->appearance);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        auto appearance = baton->appearance;
+        recordConfiguration(baton->adapter, "GapSetAppearance", "", [=](adapter_t *adapter) {
+            return sd_ble_gap_appearance_set(adapter, appearance);
+        });
+    }
 }
 
 // This runs in Main Thread
@@ -3356,7 +3511,7 @@ void Adapter::AfterGapSetAppearance(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 #pragma endregion GapSetAppearance
@@ -3370,7 +3525,7 @@ NAN_METHOD(Adapter::GapGetAppearance)
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3383,7 +3538,8 @@ NAN_METHOD(Adapter::GapGetAppearance)
     auto baton = new GapGetAppearanceBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetAppearance, reinterpret_cast<uv_after_work_cb>(AfterGapGetAppearance));
+    obj->commandQueue->enqueue(baton->req, GapGetAppearance, reinterpret_cast<uv_after_work_cb>(AfterGapGetAppearance), "GapGetAppearance");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3412,7 +3568,7 @@ void Adapter::AfterGapGetAppearance(uv_work_t *req)
         argv[1] = ConversionUtility::toJsNumber(baton->appearance);
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
     delete baton;
 }
 #pragma endregion GapGetAppearance
@@ -3445,7 +3601,7 @@ NAN_METHOD(Adapter::GapReplyAuthKey)
 
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3472,7 +3628,8 @@ NAN_METHOD(Adapter::GapReplyAuthKey)
     baton->key_type = key_type;
     baton->key = key;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplyAuthKey, reinterpret_cast<uv_after_work_cb>(AfterGapReplyAuthKey));
+    obj->commandQueue->enqueue(baton->req, GapReplyAuthKey, reinterpret_cast<uv_after_work_cb>(AfterGapReplyAuthKey), "GapReplyAuthKey");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3499,7 +3656,7 @@ void Adapter::AfterGapReplyAuthKey(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 #pragma endregion GapReplyAuthKey
@@ -3522,7 +3679,7 @@ NAN_METHOD(Adapter::GapReplyDHKeyLESC)
         key = ConversionUtility::getNativePointerToUint8(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3541,7 +3698,8 @@ NAN_METHOD(Adapter::GapReplyDHKeyLESC)
     baton->dhkey = dhkey;
     delete key;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplyDHKeyLESC, reinterpret_cast<uv_after_work_cb>(AfterGapReplyDHKeyLESC));
+    obj->commandQueue->enqueue(baton->req, GapReplyDHKeyLESC, reinterpret_cast<uv_after_work_cb>(AfterGapReplyDHKeyLESC), "GapReplyDHKeyLESC");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3568,7 +3726,7 @@ void Adapter::AfterGapReplyDHKeyLESC(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton->dhkey;
     delete baton;
 }
@@ -3592,7 +3750,7 @@ NAN_METHOD(Adapter::GapNotifyKeypress)
         kp_not = ConversionUtility::getNativeUint8(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3607,7 +3765,8 @@ NAN_METHOD(Adapter::GapNotifyKeypress)
     baton->conn_handle = conn_handle;
     baton->kp_not = kp_not;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapNotifyKeypress, reinterpret_cast<uv_after_work_cb>(AfterGapNotifyKeypress));
+    obj->commandQueue->enqueue(baton->req, GapNotifyKeypress, reinterpret_cast<uv_after_work_cb>(AfterGapNotifyKeypress), "GapNotifyKeypress");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3634,7 +3793,7 @@ void Adapter::AfterGapNotifyKeypress(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
 
     delete baton;
 }
@@ -3659,7 +3818,7 @@ NAN_METHOD(Adapter::GapGetLESCOOBData)
         key = ConversionUtility::getNativePointerToUint8(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3677,7 +3836,8 @@ NAN_METHOD(Adapter::GapGetLESCOOBData)
     baton->p_pk_own = p_pk_own;
     baton->p_oobd_own = new ble_gap_lesc_oob_data_t();
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetLESCOOBData, reinterpret_cast<uv_after_work_cb>(AfterGapGetLESCOOBData));
+    obj->commandQueue->enqueue(baton->req, GapGetLESCOOBData, reinterpret_cast<uv_after_work_cb>(AfterGapGetLESCOOBData), "GapGetLESCOOBData");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3706,7 +3866,7 @@ void Adapter::AfterGapGetLESCOOBData(uv_work_t *req)
         argv[1] = GapLescOobData(baton->p_oobd_own);
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
 
     delete baton->p_pk_own;
     delete baton->p_oobd_own;
@@ -3736,7 +3896,7 @@ NAN_METHOD(Adapter::GapSetLESCOOBData)
         p_oobd_peer = ConversionUtility::getJsObjectOrNull(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -3772,7 +3932,8 @@ NAN_METHOD(Adapter::GapSetLESCOOBData)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetLESCOOBData, reinterpret_cast<uv_after_work_cb>(AfterGapSetLESCOOBData));
+    obj->commandQueue->enqueue(baton->req, GapSetLESCOOBData, reinterpret_cast<uv_after_work_cb>(AfterGapSetLESCOOBData), "GapSetLESCOOBData");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3799,7 +3960,7 @@ void Adapter::AfterGapSetLESCOOBData(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
 
     delete baton->p_oobd_own;
     delete baton->p_oobd_peer;
@@ -40,6 +40,7 @@
 #include "ble.h"
 #include "ble_hci.h"
 #include "common.h"
+#include "adapter.h"
 
 #include <string>
 
@@ -489,6 +490,7 @@ public:
 #if NRF_SD_BLE_API_VERSION <= 2
     uint8_t addr_cycle_mode;
 #endif
+    Adapter *mainObject;
 };
 
 struct GapAddressGetBaton : Baton
@@ -496,6 +498,7 @@ struct GapAddressGetBaton : Baton
 public:
     BATON_CONSTRUCTOR(GapAddressGetBaton);
     ble_gap_addr_t *address;
+    Adapter *mainObject;
 };
 
 struct StartScanBaton : public Baton
@@ -525,6 +528,7 @@ public:
     ble_gap_conn_sec_mode_t *conn_sec_mode;
     uint8_t *dev_name;
     uint16_t length;
+    Adapter *mainObject;
 };
 
 struct GapGetDeviceNameBaton : public Baton
@@ -533,6 +537,7 @@ public:
     BATON_CONSTRUCTOR(GapGetDeviceNameBaton);
     uint8_t *dev_name;
     uint16_t length;
+    Adapter *mainObject;
 };
 
 struct GapConnectBaton : public Baton
@@ -416,7 +416,7 @@ NAN_METHOD(Adapter::GattcDiscoverPrimaryServices)
         service_uuid = ConversionUtility::getJsObjectOrNull(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -443,7 +443,8 @@ NAN_METHOD(Adapter::GattcDiscoverPrimaryServices)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverPrimaryServices, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverPrimaryServices));
+    obj->commandQueue->enqueue(baton->req, GattcDiscoverPrimaryServices, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverPrimaryServices), "GattcDiscoverPrimaryServices");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -470,7 +471,7 @@ void Adapter::AfterGattcDiscoverPrimaryServices(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
 
     delete baton;
 }
@@ -491,7 +492,7 @@ NAN_METHOD(Adapter::GattcDiscoverRelationship)
         handle_range = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -517,7 +518,8 @@ NAN_METHOD(Adapter::GattcDiscoverRelationship)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverRelationship, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverRelationship));
+    obj->commandQueue->enqueue(baton->req, GattcDiscoverRelationship, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverRelationship), "GattcDiscoverRelationship");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -544,7 +546,7 @@ void Adapter::AfterGattcDiscoverRelationship(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -564,7 +566,7 @@ NAN_METHOD(Adapter::GattcDiscoverCharacteristics)
         handle_range = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -590,7 +592,8 @@ NAN_METHOD(Adapter::GattcDiscoverCharacteristics)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverCharacteristics, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverCharacteristics));
+    obj->commandQueue->enqueue(baton->req, GattcDiscoverCharacteristics, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverCharacteristics), "GattcDiscoverCharacteristics");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -617,7 +620,7 @@ void Adapter::AfterGattcDiscoverCharacteristics(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -637,7 +640,7 @@ NAN_METHOD(Adapter::GattcDiscoverDescriptors)
         handle_range = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -663,7 +666,8 @@ NAN_METHOD(Adapter::GattcDiscoverDescriptors)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverDescriptors, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverDescriptors));
+    obj->commandQueue->enqueue(baton->req, GattcDiscoverDescriptors, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverDescriptors), "GattcDiscoverDescriptors");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -690,7 +694,7 @@ void Adapter::AfterGattcDiscoverDescriptors(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -714,7 +718,7 @@ NAN_METHOD(Adapter::GattcReadCharacteristicValueByUUID)
         handle_range = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -751,7 +755,8 @@ NAN_METHOD(Adapter::GattcReadCharacteristicValueByUUID)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcReadCharacteristicValueByUUID, reinterpret_cast<uv_after_work_cb>(AfterGattcReadCharacteristicValueByUUID));
+    obj->commandQueue->enqueue(baton->req, GattcReadCharacteristicValueByUUID, reinterpret_cast<uv_after_work_cb>(AfterGattcReadCharacteristicValueByUUID), "GattcReadCharacteristicValueByUUID");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -778,7 +783,7 @@ void Adapter::AfterGattcReadCharacteristicValueByUUID(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -802,7 +807,7 @@ NAN_METHOD(Adapter::GattcRead)
         offset = ConversionUtility::getNativeUint16(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -819,7 +824,8 @@ NAN_METHOD(Adapter::GattcRead)
     baton->handle = handle;
     baton->offset = offset;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcRead, reinterpret_cast<uv_after_work_cb>(AfterGattcRead));
+    obj->commandQueue->enqueue(baton->req, GattcRead, reinterpret_cast<uv_after_work_cb>(AfterGattcRead), "GattcRead");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -846,7 +852,7 @@ void Adapter::AfterGattcRead(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -869,7 +875,7 @@ NAN_METHOD(Adapter::GattcReadCharacteristicValues)
         handle_count = ConversionUtility::getNativeUint16(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -902,7 +908,8 @@ NAN_METHOD(Adapter::GattcReadCharacteristicValues)
     baton->p_handles = p_handles;
     baton->handle_count = handle_count;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcReadCharacteristicValues, reinterpret_cast<uv_after_work_cb>(AfterGattcReadCharacteristicValues));
+    obj->commandQueue->enqueue(baton->req, GattcReadCharacteristicValues, reinterpret_cast<uv_after_work_cb>(AfterGattcReadCharacteristicValues), "GattcReadCharacteristicValues");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -930,7 +937,7 @@ void Adapter::AfterGattcReadCharacteristicValues(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -950,7 +957,7 @@ NAN_METHOD(Adapter::GattcWrite)
         p_write_params = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -976,7 +983,8 @@ NAN_METHOD(Adapter::GattcWrite)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcWrite, reinterpret_cast<uv_after_work_cb>(AfterGattcWrite));
+    obj->commandQueue->enqueue(baton->req, GattcWrite, reinterpret_cast<uv_after_work_cb>(AfterGattcWrite), "GattcWrite");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1003,7 +1011,7 @@ void Adapter::AfterGattcWrite(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -1022,7 +1030,7 @@ NAN_METHOD(Adapter::GattcConfirmHandleValue)
         handle = ConversionUtility::getNativeUint16(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1038,7 +1046,8 @@ NAN_METHOD(Adapter::GattcConfirmHandleValue)
     baton->conn_handle = conn_handle;
     baton->handle = handle;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcConfirmHandleValue, reinterpret_cast<uv_after_work_cb>(AfterGattcConfirmHandleValue));
+    obj->commandQueue->enqueue(baton->req, GattcConfirmHandleValue, reinterpret_cast<uv_after_work_cb>(AfterGattcConfirmHandleValue), "GattcConfirmHandleValue");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1065,7 +1074,7 @@ void Adapter::AfterGattcConfirmHandleValue(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 
@@ -1085,7 +1094,7 @@ NAN_METHOD(Adapter::GattcExchangeMtuRequest)
         client_rx_mtu = ConversionUtility::getNativeUint16(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1101,7 +1110,8 @@ NAN_METHOD(Adapter::GattcExchangeMtuRequest)
     baton->conn_handle = conn_handle;
     baton->client_rx_mtu = client_rx_mtu;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcExchangeMtuRequest, reinterpret_cast<uv_after_work_cb>(AfterGattcExchangeMtuRequest));
+    obj->commandQueue->enqueue(baton->req, GattcExchangeMtuRequest, reinterpret_cast<uv_after_work_cb>(AfterGattcExchangeMtuRequest), "GattcExchangeMtuRequest");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1128,7 +1138,7 @@ void Adapter::AfterGattcExchangeMtuRequest(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 #endif
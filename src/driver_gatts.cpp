@@ -42,6 +42,8 @@
 #include "driver_gatt.h"
 
 #include <iostream>
+#include <memory>
+#include <vector>
 
 static name_map_t gatts_op_map =
 {
@@ -53,6 +55,118 @@ static name_map_t gatts_op_map =
 	NAME_MAP_ENTRY(BLE_GATTS_OP_EXEC_WRITE_REQ_NOW)
 };
 
+// Owns a copy of an attribute, including the structures it points to, for replay by Reinitialize
+struct GattsAttributeCopy
+{
+public:
+    explicit GattsAttributeCopy(const ble_gatts_attr_t *source) : attr(*source)
+    {
+        if (source->p_uuid != nullptr)
+        {
+            uuid = *source->p_uuid;
+            attr.p_uuid = &uuid;
+        }
+
+        if (source->p_attr_md != nullptr)
+        {
+            attr_md = *source->p_attr_md;
+            attr.p_attr_md = &attr_md;
+        }
+
+        if (source->p_value != nullptr)
+        {
+            value.assign(source->p_value, source->p_value + source->init_len);
+            attr.p_value = value.data();
+        }
+    }
+
+    ble_gatts_attr_t attr;
+
+private:
+    GattsAttributeCopy(const GattsAttributeCopy &) = delete;
+    GattsAttributeCopy &operator=(const GattsAttributeCopy &) = delete;
+
+    ble_uuid_t uuid;
+    ble_gatts_attr_md_t attr_md;
+    std::vector<uint8_t> value;
+};
+
+// Owns a copy of characteristic metadata, including the structures it points to, for replay by Reinitialize
+struct GattsCharacteristicMetadataCopy
+{
+public:
+    explicit GattsCharacteristicMetadataCopy(const ble_gatts_char_md_t *source) : char_md(*source)
+    {
+        if (source->p_char_user_desc != nullptr)
+        {
+            user_desc.assign(source->p_char_user_desc, source->p_char_user_desc + source->char_user_desc_size);
+            char_md.p_char_user_desc = user_desc.data();
+        }
+
+        if (source->p_char_pf != nullptr)
+        {
+            char_pf = *source->p_char_pf;
+            char_md.p_char_pf = &char_pf;
+        }
+
+        char_md.p_user_desc_md = copyMetadata(source->p_user_desc_md, user_desc_md);
+        char_md.p_cccd_md = copyMetadata(source->p_cccd_md, cccd_md);
+        char_md.p_sccd_md = copyMetadata(source->p_sccd_md, sccd_md);
+    }
+
+    ble_gatts_char_md_t char_md;
+
+private:
+    GattsCharacteristicMetadataCopy(const GattsCharacteristicMetadataCopy &) = delete;
+    GattsCharacteristicMetadataCopy &operator=(const GattsCharacteristicMetadataCopy &) = delete;
+
+    static ble_gatts_attr_md_t *copyMetadata(const ble_gatts_attr_md_t *source, ble_gatts_attr_md_t &target)
+    {
+        if (source == nullptr)
+        {
+            return nullptr;
+        }
+
+        target = *source;
+        return &target;
+    }
+
+    std::vector<uint8_t> user_desc;
+    ble_gatts_char_pf_t char_pf;
+    ble_gatts_attr_md_t user_desc_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_md_t sccd_md;
+};
+
+// Frees an attribute created by GattsAttribute::ToNative
+static void freeGattsAttribute(ble_gatts_attr_t *attribute)
+{
+    if (attribute == nullptr)
+    {
+        return;
+    }
+
+    delete attribute->p_uuid;
+    delete attribute->p_attr_md;
+    free(attribute->p_value);
+    delete attribute;
+}
+
+// Frees metadata created by GattsCharacteristicMetadata::ToNative
+static void freeGattsCharacteristicMetadata(ble_gatts_char_md_t *metadata)
+{
+    if (metadata == nullptr)
+    {
+        return;
+    }
+
+    delete metadata->p_char_pf;
+    delete metadata->p_user_desc_md;
+    delete metadata->p_cccd_md;
+    delete metadata->p_sccd_md;
+    delete metadata;
+}
+
 v8::Local<v8::Object> GattsEnableParameters::ToJs()
 {
     Nan::EscapableHandleScope scope;
@@ -401,7 +515,7 @@ NAN_METHOD(Adapter::GattsAddService)
         uuid = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -426,7 +540,8 @@ NAN_METHOD(Adapter::GattsAddService)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsAddService, reinterpret_cast<uv_after_work_cb>(AfterGattsAddService));
+    obj->commandQueue->enqueue(baton->req, GattsAddService, reinterpret_cast<uv_after_work_cb>(AfterGattsAddService), "GattsAddService");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -434,6 +549,19 @@ void Adapter::GattsAddService(uv_work_t *req)
 {
     auto baton = static_cast<GattsAddServiceBaton *>(req->data);
     baton->result = sd_ble_gatts_service_add(baton->adapter, baton->type, baton->p_uuid, &baton->p_handle);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        // The table is rebuilt in the same order, so the attributes must get the same handles again
+        auto type = baton->type;
+        auto uuid = *baton->p_uuid;
+        auto handle = baton->p_handle;
+        recordConfiguration(baton->adapter, "GattsAddService", [=](adapter_t *adapter) {
+            uint16_t replayedHandle;
+            auto result = sd_ble_gatts_service_add(adapter, type, &uuid, &replayedHandle);
+            return (result == NRF_SUCCESS && replayedHandle != handle) ? static_cast<uint32_t>(NRF_ERROR_INVALID_STATE) : result;
+        });
+    }
 }
 
 // This runs in Main Thread
@@ -455,7 +583,7 @@ void Adapter::AfterGattsAddService(uv_work_t *req)
         argv[1] = ConversionUtility::toJsNumber(baton->p_handle);
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
     delete baton;
 }
 
@@ -479,7 +607,7 @@ NAN_METHOD(Adapter::GattsAddCharacteristic)
         attributeStructure = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -515,7 +643,8 @@ NAN_METHOD(Adapter::GattsAddCharacteristic)
 
     baton->p_handles = new ble_gatts_char_handles_t();
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsAddCharacteristic, reinterpret_cast<uv_after_work_cb>(AfterGattsAddCharacteristic));
+    obj->commandQueue->enqueue(baton->req, GattsAddCharacteristic, reinterpret_cast<uv_after_work_cb>(AfterGattsAddCharacteristic), "GattsAddCharacteristic");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -523,6 +652,20 @@ void Adapter::GattsAddCharacteristic(uv_work_t *req)
 {
     auto baton = static_cast<GattsAddCharacteristicBaton *>(req->data);
     baton->result = sd_ble_gatts_characteristic_add(baton->adapter, baton->service_handle, baton->p_char_md, baton->p_attr_char_value, baton->p_handles);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        // The baton structures are freed after the command, the journal keeps its own copies
+        auto service_handle = baton->service_handle;
+        auto char_md = std::make_shared<GattsCharacteristicMetadataCopy>(baton->p_char_md);
+        auto attr_char_value = std::make_shared<GattsAttributeCopy>(baton->p_attr_char_value);
+        auto value_handle = baton->p_handles->value_handle;
+        recordConfiguration(baton->adapter, "GattsAddCharacteristic", [=](adapter_t *adapter) {
+            ble_gatts_char_handles_t handles;
+            auto result = sd_ble_gatts_characteristic_add(adapter, service_handle, &char_md->char_md, &attr_char_value->attr, &handles);
+            return (result == NRF_SUCCESS && handles.value_handle != value_handle) ? static_cast<uint32_t>(NRF_ERROR_INVALID_STATE) : result;
+        });
+    }
 }
 
 // This runs in Main Thread
@@ -544,8 +687,10 @@ void Adapter::AfterGattsAddCharacteristic(uv_work_t *req)
         argv[1] = GattsCharacteristicDefinitionHandles(baton->p_handles).ToJs();
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
 
+    freeGattsCharacteristicMetadata(baton->p_char_md);
+    freeGattsAttribute(baton->p_attr_char_value);
     delete baton->p_handles;
     delete baton;
 }
@@ -566,7 +711,7 @@ NAN_METHOD(Adapter::GattsAddDescriptor)
         attributeStructure = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -591,7 +736,8 @@ NAN_METHOD(Adapter::GattsAddDescriptor)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsAddDescriptor, reinterpret_cast<uv_after_work_cb>(AfterGattsAddDescriptor));
+    obj->commandQueue->enqueue(baton->req, GattsAddDescriptor, reinterpret_cast<uv_after_work_cb>(AfterGattsAddDescriptor), "GattsAddDescriptor");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -599,6 +745,18 @@ void Adapter::GattsAddDescriptor(uv_work_t *req)
 {
     auto baton = static_cast<GattsAddDescriptorBaton *>(req->data);
     baton->result = sd_ble_gatts_descriptor_add(baton->adapter, baton->char_handle, baton->p_attr, &baton->p_handle);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        auto char_handle = baton->char_handle;
+        auto attr = std::make_shared<GattsAttributeCopy>(baton->p_attr);
+        auto handle = baton->p_handle;
+        recordConfiguration(baton->adapter, "GattsAddDescriptor", [=](adapter_t *adapter) {
+            uint16_t replayedHandle;
+            auto result = sd_ble_gatts_descriptor_add(adapter, char_handle, &attr->attr, &replayedHandle);
+            return (result == NRF_SUCCESS && replayedHandle != handle) ? static_cast<uint32_t>(NRF_ERROR_INVALID_STATE) : result;
+        });
+    }
 }
 
 // This runs in Main Thread
@@ -620,9 +778,9 @@ void Adapter::AfterGattsAddDescriptor(uv_work_t *req)
         argv[1] = ConversionUtility::toJsNumber(baton->p_handle);
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
 
-    delete baton->p_attr;
+    freeGattsAttribute(baton->p_attr);
     delete baton;
 }
 
@@ -642,7 +800,7 @@ NAN_METHOD(Adapter::GattsHVX)
         hvx_params = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -667,7 +825,8 @@ NAN_METHOD(Adapter::GattsHVX)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsHVX, reinterpret_cast<uv_after_work_cb>(AfterGattsHVX));
+    obj->commandQueue->enqueue(baton->req, GattsHVX, reinterpret_cast<uv_after_work_cb>(AfterGattsHVX), "GattsHVX");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -696,7 +855,7 @@ void Adapter::AfterGattsHVX(uv_work_t *req)
         argv[1] = ConversionUtility::toJsNumber(*baton->p_hvx_params->p_len);
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
 
     delete baton->p_hvx_params->p_len;
     delete baton->p_hvx_params;
@@ -735,7 +894,7 @@ NAN_METHOD(Adapter::GattsSystemAttributeSet)
         flags = ConversionUtility::getNativeUint32(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -761,7 +920,8 @@ NAN_METHOD(Adapter::GattsSystemAttributeSet)
     baton->len = len;
     baton->flags = flags;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsSystemAttributeSet, reinterpret_cast<uv_after_work_cb>(AfterGattsSystemAttributeSet));
+    obj->commandQueue->enqueue(baton->req, GattsSystemAttributeSet, reinterpret_cast<uv_after_work_cb>(AfterGattsSystemAttributeSet), "GattsSystemAttributeSet");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -788,7 +948,7 @@ void Adapter::AfterGattsSystemAttributeSet(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
 
     delete baton->p_sys_attr_data;
     delete baton;
@@ -814,7 +974,7 @@ NAN_METHOD(Adapter::GattsSetValue)
         value = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -840,7 +1000,8 @@ NAN_METHOD(Adapter::GattsSetValue)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsSetValue, reinterpret_cast<uv_after_work_cb>(AfterGattsSetValue));
+    obj->commandQueue->enqueue(baton->req, GattsSetValue, reinterpret_cast<uv_after_work_cb>(AfterGattsSetValue), "GattsSetValue");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -848,6 +1009,22 @@ void Adapter::GattsSetValue(uv_work_t *req)
 {
     auto baton = static_cast<GattsSetValueBaton *>(req->data);
     baton->result = sd_ble_gatts_value_set(baton->adapter, baton->conn_handle, baton->handle, baton->p_value);
+
+    // Values of the local table are restored, values of a connection are lost with the connection
+    if (baton->result == NRF_SUCCESS && baton->conn_handle == BLE_CONN_HANDLE_INVALID && baton->p_value->p_value != nullptr)
+    {
+        auto handle = baton->handle;
+        auto offset = baton->p_value->offset;
+        auto value = std::vector<uint8_t>(baton->p_value->p_value, baton->p_value->p_value + baton->p_value->len);
+        auto target = std::to_string(handle) + ":" + std::to_string(offset) + ":" + std::to_string(value.size());
+        recordConfiguration(baton->adapter, "GattsSetValue", target, [=](adapter_t *adapter) mutable {
+            ble_gatts_value_t gatts_value;
+            gatts_value.len = static_cast<uint16_t>(value.size());
+            gatts_value.offset = offset;
+            gatts_value.p_value = value.data();
+            return sd_ble_gatts_value_set(adapter, BLE_CONN_HANDLE_INVALID, handle, &gatts_value);
+        });
+    }
 }
 
 // This runs in Main Thread
@@ -869,7 +1046,7 @@ void Adapter::AfterGattsSetValue(uv_work_t *req)
         argv[1] = GattsValue(baton->p_value);
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
 
     delete baton->p_value;
     delete baton;
@@ -895,7 +1072,7 @@ NAN_METHOD(Adapter::GattsGetValue)
         value = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -921,7 +1098,8 @@ NAN_METHOD(Adapter::GattsGetValue)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsGetValue, reinterpret_cast<uv_after_work_cb>(AfterGattsGetValue));
+    obj->commandQueue->enqueue(baton->req, GattsGetValue, reinterpret_cast<uv_after_work_cb>(AfterGattsGetValue), "GattsGetValue");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -950,7 +1128,7 @@ void Adapter::AfterGattsGetValue(uv_work_t *req)
         argv[1] = GattsValue(baton->p_value);
     }
 
-    baton->callback->Call(2, argv);
+    baton->deliver(2, argv);
 
     delete baton->p_value;
     delete baton;
@@ -972,7 +1150,7 @@ NAN_METHOD(Adapter::GattsReplyReadWriteAuthorize)
         params = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -997,7 +1175,8 @@ NAN_METHOD(Adapter::GattsReplyReadWriteAuthorize)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsReplyReadWriteAuthorize, reinterpret_cast<uv_after_work_cb>(AfterGattsReplyReadWriteAuthorize));
+    obj->commandQueue->enqueue(baton->req, GattsReplyReadWriteAuthorize, reinterpret_cast<uv_after_work_cb>(AfterGattsReplyReadWriteAuthorize), "GattsReplyReadWriteAuthorize");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1024,7 +1203,7 @@ void Adapter::AfterGattsReplyReadWriteAuthorize(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
 
     delete baton->p_rw_authorize_reply_params;
     delete baton;
@@ -1046,7 +1225,7 @@ NAN_METHOD(Adapter::GattsExchangeMtuReply)
         server_rx_mtu = ConversionUtility::getNativeUint16(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1062,7 +1241,8 @@ NAN_METHOD(Adapter::GattsExchangeMtuReply)
     baton->conn_handle = conn_handle;
     baton->server_rx_mtu = server_rx_mtu;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsExchangeMtuReply, reinterpret_cast<uv_after_work_cb>(AfterGattsExchangeMtuReply));
+    obj->commandQueue->enqueue(baton->req, GattsExchangeMtuReply, reinterpret_cast<uv_after_work_cb>(AfterGattsExchangeMtuReply), "GattsExchangeMtuReply");
+    info.GetReturnValue().Set(baton->returnValue());
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1089,7 +1269,7 @@ void Adapter::AfterGattsExchangeMtuReply(uv_work_t *req)
         argv[0] = Nan::Undefined();
     }
 
-    baton->callback->Call(1, argv);
+    baton->deliver(1, argv);
     delete baton;
 }
 #endif
@@ -35,74 +35,85 @@
  */
 
 #include "driver_uecc.h"
-#include "uECC/uECC.h"
 #include "nrf_error.h"
 #include <iostream>
 #include <cstdlib>
-#include <time.h>
+#include <cstring>
+#include <sstream>
 
-#include "common.h"
-
-#define ECC_P256_SK_LEN 32
-#define ECC_P256_PK_LEN 64
-
-int rng(uint8_t *dest, unsigned size)
+// Copies a key given as an array of bytes, throws if it does not have the length of the key
+static void getKey(v8::Local<v8::Value> js, uint8_t *key, const size_t length)
 {
-    for (unsigned i = 0; i < size; ++i)
+    auto bytes = ConversionUtility::getNativePointerToUint8(js);
+
+    if (v8::Local<v8::Array>::Cast(js)->Length() != length)
     {
-        dest[i] = rand() % 256;
+        free(bytes);
+        throw std::string("array of ") + std::to_string(length) + " bytes";
     }
 
-    return 1;
+    memcpy(key, bytes, length);
+    free(bytes);
 }
 
-static uint8_t m_be_keys[ECC_P256_SK_LEN * 3];
+// The random number generator is set up on first use, kept for compatibility
+NAN_METHOD(ECCInit)
+{
+}
 
-static void reverse(uint8_t* p_dst, uint8_t* p_src, uint32_t len)
+NAN_METHOD(ECCSetKeypairPoolSize)
 {
-    uint32_t i, j;
+    uint32_t size;
+    auto argumentcount = 0;
 
-    for (i = len - 1, j = 0; j < len; i--, j++)
+    try
     {
-        p_dst[j] = p_src[i];
+        size = ConversionUtility::getNativeUint32(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
     }
-}
-
-static bool isEccInitialized = false;
 
-NAN_METHOD(ECCInit)
-{
-    if (!isEccInitialized)
+    if (size > ECC_P256_KEYPAIR_POOL_MAX_SIZE)
     {
-        srand ((unsigned int)time(NULL));
-        uECC_set_rng(rng);
-        isEccInitialized = true;
+        std::stringstream message;
+        message << "Key pair pool size must be at most " << ECC_P256_KEYPAIR_POOL_MAX_SIZE;
+        Nan::ThrowRangeError(message.str().c_str());
+        return;
     }
+
+    eccP256SetKeypairPoolSize(size);
 }
 
-NAN_METHOD(ECCP256GenerateKeypair)
+NAN_METHOD(ECCGetKeypairPoolStats)
 {
-    const struct uECC_Curve_t * p_curve;
+    EccP256KeypairPoolStats stats;
+    eccP256GetKeypairPoolStats(stats);
 
+    v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
+    Utility::Set(retObject, "size", static_cast<uint32_t>(stats.size));
+    Utility::Set(retObject, "available", static_cast<uint32_t>(stats.available));
+    Utility::Set(retObject, "hitCount", stats.hitCount);
+    Utility::Set(retObject, "missCount", stats.missCount);
+
+    info.GetReturnValue().Set(retObject);
+}
+
+NAN_METHOD(ECCP256GenerateKeypair)
+{
     uint8_t p_le_sk[ECC_P256_SK_LEN];   // Out
     uint8_t p_le_pk[ECC_P256_PK_LEN];   // Out
 
-    p_curve = uECC_secp256r1();
-    int ret = uECC_make_key((uint8_t *)&m_be_keys[ECC_P256_SK_LEN], (uint8_t *)&m_be_keys[0], p_curve);
-
-    if (!ret)
+    if (!eccP256GenerateKeypair(p_le_sk, p_le_pk))
     {
         Nan::ThrowTypeError("NRF_ERROR_INTERNAL");
         return;
     }
 
-    /* convert to little endian bytes and store in p_le_sk */
-    reverse(&p_le_sk[0], &m_be_keys[0], ECC_P256_SK_LEN);
-    /* convert to little endian bytes in 2 passes, store in p_le_pk */
-    reverse(&p_le_pk[0], &m_be_keys[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
-    reverse(&p_le_pk[ECC_P256_SK_LEN], &m_be_keys[ECC_P256_SK_LEN * 2], ECC_P256_SK_LEN);
-
-
     v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
     Utility::Set(retObject, "sk", ConversionUtility::toJsValueArray(p_le_sk, ECC_P256_SK_LEN));
     Utility::Set(retObject, "pk", ConversionUtility::toJsValueArray(p_le_pk, ECC_P256_PK_LEN));
@@ -112,14 +123,13 @@ NAN_METHOD(ECCP256GenerateKeypair)
 
 NAN_METHOD(ECCP256ComputePublicKey)
 {
-    const struct uECC_Curve_t * p_curve;
-    uint8_t *p_le_sk;   // In
+    uint8_t p_le_sk[ECC_P256_SK_LEN];   // In
     uint8_t p_le_pk[ECC_P256_PK_LEN];   // Out
     auto argumentcount = 0;
 
     try
     {
-        p_le_sk = ConversionUtility::getNativePointerToUint8(info[0]);
+        getKey(info[argumentcount], p_le_sk, ECC_P256_SK_LEN);
         argumentcount++;
     }
     catch (std::string error)
@@ -129,47 +139,60 @@ NAN_METHOD(ECCP256ComputePublicKey)
         return;
     }
 
-    if (p_le_sk == nullptr)
+    if (!eccP256ComputePublicKey(p_le_sk, p_le_pk))
     {
-        Nan::ThrowTypeError("NRF_ERROR_NULL");
+        Nan::ThrowTypeError("NRF_ERROR_INTERNAL");
         return;
     }
 
-    p_curve = uECC_secp256r1();
+    v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
+    Utility::Set(retObject, "pk", ConversionUtility::toJsValueArray(p_le_pk, ECC_P256_PK_LEN));
 
-    reverse(&m_be_keys[0], (uint8_t *)p_le_sk, ECC_P256_SK_LEN);
+    info.GetReturnValue().Set(retObject);
+}
 
-    //int ret = uECC_compute_public_key(p_le_sk, (uint8_t *)p_le_pk, p_curve);
-    int ret = uECC_compute_public_key((uint8_t *)&m_be_keys[0], (uint8_t *)&m_be_keys[ECC_P256_SK_LEN], p_curve);
+NAN_METHOD(ECCP256ComputeSharedSecret)
+{
+    uint8_t p_le_sk[ECC_P256_SK_LEN];  // In
+    uint8_t p_le_pk[ECC_P256_PK_LEN];  // In
+    uint8_t p_le_ss[ECC_P256_SK_LEN];  // Out
+    auto argumentcount = 0;
 
-    if (!ret)
+    try
     {
-        Nan::ThrowTypeError("NRF_ERROR_INTERNAL");
+        getKey(info[argumentcount], p_le_sk, ECC_P256_SK_LEN);
+        argumentcount++;
+
+        getKey(info[argumentcount], p_le_pk, ECC_P256_PK_LEN);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
         return;
     }
 
-    /* convert to little endian bytes in 2 passes, store in m_be_keys */
-    reverse(&p_le_pk[0], &m_be_keys[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
-    reverse(&p_le_pk[ECC_P256_SK_LEN], &m_be_keys[ECC_P256_SK_LEN * 2], ECC_P256_SK_LEN);
+    if (!eccP256ComputeSharedSecret(p_le_sk, p_le_pk, p_le_ss))
+    {
+        Nan::ThrowTypeError("NRF_ERROR_INTERNAL");
+        return;
+    }
 
     v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
-    Utility::Set(retObject, "pk", ConversionUtility::toJsValueArray(p_le_pk, ECC_P256_PK_LEN));
+    Utility::Set(retObject, "ss", ConversionUtility::toJsValueArray(p_le_ss, ECC_P256_SK_LEN));
 
     info.GetReturnValue().Set(retObject);
 }
 
-NAN_METHOD(ECCP256ComputeSharedSecret)
+NAN_METHOD(ECCP256GenerateKeypairAsync)
 {
-    const struct uECC_Curve_t * p_curve;
-    uint8_t *p_le_sk;  // In
-    uint8_t *p_le_pk;  // In
-    uint8_t p_le_ss[ECC_P256_SK_LEN];  // Out
+    v8::Local<v8::Function> callback;
     auto argumentcount = 0;
 
     try
     {
-        p_le_sk = ConversionUtility::getNativePointerToUint8(info[0]);
-        p_le_pk = ConversionUtility::getNativePointerToUint8(info[1]);
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -179,31 +202,168 @@ NAN_METHOD(ECCP256ComputeSharedSecret)
         return;
     }
 
-    p_curve = uECC_secp256r1();
+    auto baton = new EccGenerateKeypairBaton(callback);
 
-    /* convert to big endian bytes and store in m_be_keys */
-    reverse(&m_be_keys[0], (uint8_t *)p_le_sk, ECC_P256_SK_LEN);
-    reverse(&m_be_keys[ECC_P256_SK_LEN], (uint8_t *)&p_le_pk[0], ECC_P256_SK_LEN);
-    reverse(&m_be_keys[ECC_P256_SK_LEN * 2], (uint8_t *)&p_le_pk[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, ECCP256GenerateKeypairAsync, reinterpret_cast<uv_after_work_cb>(AfterECCP256GenerateKeypairAsync));
+    info.GetReturnValue().Set(baton->returnValue());
+}
+
+// This runs in a worker thread (not Main Thread)
+void ECCP256GenerateKeypairAsync(uv_work_t *req)
+{
+    auto baton = static_cast<EccGenerateKeypairBaton *>(req->data);
+    baton->result = eccP256GenerateKeypair(baton->sk, baton->pk) ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+}
 
-    int ret = uECC_shared_secret((uint8_t *)&m_be_keys[ECC_P256_SK_LEN], (uint8_t *)&m_be_keys[0], p_le_ss, p_curve);
+// This runs in Main Thread
+void AfterECCP256GenerateKeypairAsync(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<EccGenerateKeypairBaton *>(req->data);
+    v8::Local<v8::Value> argv[2];
 
-    if (!ret)
+    if (baton->result != NRF_SUCCESS)
     {
-        Nan::ThrowTypeError("NRF_ERROR_INTERNAL");
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "generating keypair");
+        argv[1] = Nan::Undefined();
+    }
+    else
+    {
+        v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
+        Utility::Set(retObject, "sk", ConversionUtility::toJsValueArray(baton->sk, ECC_P256_SK_LEN));
+        Utility::Set(retObject, "pk", ConversionUtility::toJsValueArray(baton->pk, ECC_P256_PK_LEN));
+
+        argv[0] = Nan::Undefined();
+        argv[1] = retObject;
+    }
+
+    baton->deliver(2, argv);
+    delete baton;
+}
+
+NAN_METHOD(ECCP256ComputePublicKeyAsync)
+{
+    uint8_t p_le_sk[ECC_P256_SK_LEN];
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        getKey(info[argumentcount], p_le_sk, ECC_P256_SK_LEN);
+        argumentcount++;
+
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
         return;
     }
 
-    /* convert to little endian bytes and store in m_be_keys */
-    reverse(&m_be_keys[0], &p_le_ss[0], ECC_P256_SK_LEN);
+    auto baton = new EccComputePublicKeyBaton(callback);
+    memcpy(baton->sk, p_le_sk, ECC_P256_SK_LEN);
 
-    /* copy back the little endian bytes to p_le_pk */
-    memcpy(p_le_ss, m_be_keys, ECC_P256_SK_LEN);
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, ECCP256ComputePublicKeyAsync, reinterpret_cast<uv_after_work_cb>(AfterECCP256ComputePublicKeyAsync));
+    info.GetReturnValue().Set(baton->returnValue());
+}
 
-    v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
-    Utility::Set(retObject, "ss", ConversionUtility::toJsValueArray(p_le_ss, ECC_P256_SK_LEN));
+// This runs in a worker thread (not Main Thread)
+void ECCP256ComputePublicKeyAsync(uv_work_t *req)
+{
+    auto baton = static_cast<EccComputePublicKeyBaton *>(req->data);
+    baton->result = eccP256ComputePublicKey(baton->sk, baton->pk) ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+}
 
-    info.GetReturnValue().Set(retObject);
+// This runs in Main Thread
+void AfterECCP256ComputePublicKeyAsync(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<EccComputePublicKeyBaton *>(req->data);
+    v8::Local<v8::Value> argv[2];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "computing public key");
+        argv[1] = Nan::Undefined();
+    }
+    else
+    {
+        v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
+        Utility::Set(retObject, "pk", ConversionUtility::toJsValueArray(baton->pk, ECC_P256_PK_LEN));
+
+        argv[0] = Nan::Undefined();
+        argv[1] = retObject;
+    }
+
+    baton->deliver(2, argv);
+    delete baton;
+}
+
+NAN_METHOD(ECCP256ComputeSharedSecretAsync)
+{
+    uint8_t p_le_sk[ECC_P256_SK_LEN];
+    uint8_t p_le_pk[ECC_P256_PK_LEN];
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        getKey(info[argumentcount], p_le_sk, ECC_P256_SK_LEN);
+        argumentcount++;
+
+        getKey(info[argumentcount], p_le_pk, ECC_P256_PK_LEN);
+        argumentcount++;
+
+        callback = ConversionUtility::getOptionalCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new EccComputeSharedSecretBaton(callback);
+    memcpy(baton->sk, p_le_sk, ECC_P256_SK_LEN);
+    memcpy(baton->pk, p_le_pk, ECC_P256_PK_LEN);
+
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, ECCP256ComputeSharedSecretAsync, reinterpret_cast<uv_after_work_cb>(AfterECCP256ComputeSharedSecretAsync));
+    info.GetReturnValue().Set(baton->returnValue());
+}
+
+// This runs in a worker thread (not Main Thread)
+void ECCP256ComputeSharedSecretAsync(uv_work_t *req)
+{
+    auto baton = static_cast<EccComputeSharedSecretBaton *>(req->data);
+    baton->result = eccP256ComputeSharedSecret(baton->sk, baton->pk, baton->ss) ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+}
+
+// This runs in Main Thread
+void AfterECCP256ComputeSharedSecretAsync(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<EccComputeSharedSecretBaton *>(req->data);
+    v8::Local<v8::Value> argv[2];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "computing shared secret");
+        argv[1] = Nan::Undefined();
+    }
+    else
+    {
+        v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
+        Utility::Set(retObject, "ss", ConversionUtility::toJsValueArray(baton->ss, ECC_P256_SK_LEN));
+
+        argv[0] = Nan::Undefined();
+        argv[1] = retObject;
+    }
+
+    baton->deliver(2, argv);
+    delete baton;
 }
 
 extern "C" {
@@ -213,5 +373,10 @@ extern "C" {
         Utility::SetMethod(target, "eccGenerateKeypair", ECCP256GenerateKeypair);
         Utility::SetMethod(target, "eccComputePublicKey", ECCP256ComputePublicKey);
         Utility::SetMethod(target, "eccComputeSharedSecret", ECCP256ComputeSharedSecret);
+        Utility::SetMethod(target, "eccGenerateKeypairAsync", ECCP256GenerateKeypairAsync);
+        Utility::SetMethod(target, "eccComputePublicKeyAsync", ECCP256ComputePublicKeyAsync);
+        Utility::SetMethod(target, "eccComputeSharedSecretAsync", ECCP256ComputeSharedSecretAsync);
+        Utility::SetMethod(target, "eccSetKeypairPoolSize", ECCSetKeypairPoolSize);
+        Utility::SetMethod(target, "eccGetKeypairPoolStats", ECCGetKeypairPoolStats);
     }
 }
@@ -38,12 +38,48 @@
 #define DRIVER_UECC_H
 
 #include <nan.h>
+#include <cstdint>
+
+#include "common.h"
+#include "ecc_p256.h"
+
+struct EccGenerateKeypairBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(EccGenerateKeypairBaton)
+    uint8_t sk[ECC_P256_SK_LEN];
+    uint8_t pk[ECC_P256_PK_LEN];
+};
+
+struct EccComputePublicKeyBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(EccComputePublicKeyBaton)
+    uint8_t sk[ECC_P256_SK_LEN];
+    uint8_t pk[ECC_P256_PK_LEN];
+};
+
+struct EccComputeSharedSecretBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(EccComputeSharedSecretBaton)
+    uint8_t sk[ECC_P256_SK_LEN];
+    uint8_t pk[ECC_P256_PK_LEN];
+    uint8_t ss[ECC_P256_SK_LEN];
+};
 
 NAN_METHOD(ECCInit);
+NAN_METHOD(ECCSetKeypairPoolSize);
+NAN_METHOD(ECCGetKeypairPoolStats);
 NAN_METHOD(ECCP256GenerateKeypair);
 NAN_METHOD(ECCP256ComputePublicKey);
 NAN_METHOD(ECCP256ComputeSharedSecret);
 
+// Run on the libuv threadpool, the result is passed to a callback or settles a promise
+METHOD_DEFINITIONS(ECCP256GenerateKeypairAsync)
+METHOD_DEFINITIONS(ECCP256ComputePublicKeyAsync)
+METHOD_DEFINITIONS(ECCP256ComputeSharedSecretAsync)
+
 extern "C" {
     void init_uecc(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target);
 }
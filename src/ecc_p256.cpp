@@ -0,0 +1,214 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ecc_p256.h"
+#include "keypair_pool.h"
+#include "uECC/uECC.h"
+
+#include <mutex>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <bcrypt.h>
+#elif defined(__APPLE__)
+#include <sys/random.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Fills dest from the random number generator of the operating system, returns 0 on failure
+static int rng(uint8_t *dest, unsigned size)
+{
+#if defined(_WIN32)
+    return BCRYPT_SUCCESS(BCryptGenRandom(nullptr, dest, size, BCRYPT_USE_SYSTEM_PREFERRED_RNG)) ? 1 : 0;
+#elif defined(__APPLE__)
+    // getentropy is limited to 256 bytes per call
+    while (size > 0)
+    {
+        auto length = size < 256 ? size : 256;
+
+        if (getentropy(dest, length) != 0)
+        {
+            return 0;
+        }
+
+        dest += length;
+        size -= length;
+    }
+
+    return 1;
+#elif defined(__linux__)
+    // The syscall is used directly, the getrandom wrapper needs glibc 2.25
+    while (size > 0)
+    {
+        auto length = syscall(SYS_getrandom, dest, size, 0);
+
+        if (length < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return 0;
+        }
+
+        dest += length;
+        size -= static_cast<unsigned>(length);
+    }
+
+    return 1;
+#else
+#error "No random number generator for this platform"
+#endif
+}
+
+static void reverse(uint8_t* p_dst, const uint8_t* p_src, uint32_t len)
+{
+    uint32_t i, j;
+
+    for (i = len - 1, j = 0; j < len; i--, j++)
+    {
+        p_dst[j] = p_src[i];
+    }
+}
+
+static std::once_flag eccInitialized;
+
+static void eccInit()
+{
+    std::call_once(eccInitialized, []() {
+        uECC_set_rng(rng);
+    });
+}
+
+// The uECC functions work on big endian keys, the buffers are on the stack of each call
+static bool generateKeypair(uint8_t *le_sk, uint8_t *le_pk)
+{
+    uint8_t be_keys[ECC_P256_SK_LEN * 3];
+
+    eccInit();
+
+    if (!uECC_make_key(&be_keys[ECC_P256_SK_LEN], &be_keys[0], uECC_secp256r1()))
+    {
+        return false;
+    }
+
+    /* convert to little endian bytes and store in le_sk */
+    reverse(&le_sk[0], &be_keys[0], ECC_P256_SK_LEN);
+    /* convert to little endian bytes in 2 passes, store in le_pk */
+    reverse(&le_pk[0], &be_keys[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
+    reverse(&le_pk[ECC_P256_SK_LEN], &be_keys[ECC_P256_SK_LEN * 2], ECC_P256_SK_LEN);
+
+    return true;
+}
+
+// Shared by all adapters. Never deleted, its thread may be generating a key pair when the process exits.
+static KeypairPool *keypairPool = new KeypairPool(generateKeypair);
+
+bool eccP256GenerateKeypair(uint8_t *le_sk, uint8_t *le_pk)
+{
+    return keypairPool->take(le_sk, le_pk);
+}
+
+bool eccP256ComputePublicKey(const uint8_t *le_sk, uint8_t *le_pk)
+{
+    uint8_t be_keys[ECC_P256_SK_LEN * 3];
+
+    eccInit();
+
+    reverse(&be_keys[0], le_sk, ECC_P256_SK_LEN);
+
+    if (!uECC_compute_public_key(&be_keys[0], &be_keys[ECC_P256_SK_LEN], uECC_secp256r1()))
+    {
+        return false;
+    }
+
+    /* convert to little endian bytes in 2 passes, store in le_pk */
+    reverse(&le_pk[0], &be_keys[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
+    reverse(&le_pk[ECC_P256_SK_LEN], &be_keys[ECC_P256_SK_LEN * 2], ECC_P256_SK_LEN);
+
+    return true;
+}
+
+bool eccP256ComputeSharedSecret(const uint8_t *le_sk, const uint8_t *le_pk, uint8_t *le_ss)
+{
+    uint8_t be_keys[ECC_P256_SK_LEN * 3];
+    uint8_t be_ss[ECC_P256_SK_LEN];
+
+    eccInit();
+
+    /* convert to big endian bytes and store in be_keys */
+    reverse(&be_keys[0], le_sk, ECC_P256_SK_LEN);
+    reverse(&be_keys[ECC_P256_SK_LEN], &le_pk[0], ECC_P256_SK_LEN);
+    reverse(&be_keys[ECC_P256_SK_LEN * 2], &le_pk[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
+
+    // A point off the curve would leak bits of the private key through the shared secret
+    if (!uECC_valid_public_key(&be_keys[ECC_P256_SK_LEN], uECC_secp256r1()))
+    {
+        return false;
+    }
+
+    if (!uECC_shared_secret(&be_keys[ECC_P256_SK_LEN], &be_keys[0], be_ss, uECC_secp256r1()))
+    {
+        return false;
+    }
+
+    /* convert to little endian bytes and store in le_ss */
+    reverse(le_ss, be_ss, ECC_P256_SK_LEN);
+
+    return true;
+}
+
+bool eccP256Random(uint8_t *dest, const size_t size)
+{
+    return rng(dest, static_cast<unsigned>(size)) != 0;
+}
+
+void eccP256SetKeypairPoolSize(const size_t size)
+{
+    keypairPool->setSize(size);
+}
+
+void eccP256GetKeypairPoolStats(EccP256KeypairPoolStats &stats)
+{
+    stats.size = keypairPool->getSize();
+    stats.available = keypairPool->getAvailable();
+    stats.hitCount = keypairPool->getHitCount();
+    stats.missCount = keypairPool->getMissCount();
+}
@@ -0,0 +1,74 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ECC_P256_H
+#define ECC_P256_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define ECC_P256_SK_LEN 32
+#define ECC_P256_PK_LEN 64
+
+// Largest key pair pool, each key pair takes 96 bytes and generating one takes milliseconds
+#define ECC_P256_KEYPAIR_POOL_MAX_SIZE 1024
+
+// Keys and secrets are little endian, as used by the SoftDevice. The functions are thread safe.
+// Key pairs are taken from the key pair pool if it has any.
+bool eccP256GenerateKeypair(uint8_t *le_sk, uint8_t *le_pk);
+bool eccP256ComputePublicKey(const uint8_t *le_sk, uint8_t *le_pk);
+// Fails for a peer public key that is not a point on the curve, see CVE-2018-5383
+bool eccP256ComputeSharedSecret(const uint8_t *le_sk, const uint8_t *le_pk, uint8_t *le_ss);
+
+// Fills dest from the random number generator of the operating system
+bool eccP256Random(uint8_t *dest, const size_t size);
+
+// Number of key pairs generated ahead of time, 0 generates them when needed.
+// The size must not exceed ECC_P256_KEYPAIR_POOL_MAX_SIZE.
+void eccP256SetKeypairPoolSize(const size_t size);
+
+struct EccP256KeypairPoolStats
+{
+public:
+    size_t size;
+    size_t available;
+    uint32_t hitCount;
+    uint32_t missCount;
+};
+
+void eccP256GetKeypairPoolStats(EccP256KeypairPoolStats &stats);
+
+#endif // ECC_P256_H
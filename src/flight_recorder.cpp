@@ -0,0 +1,183 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "flight_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    void put16(uint8_t *out, const uint16_t value)
+    {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void put32(uint8_t *out, const uint32_t value)
+    {
+        put16(out, static_cast<uint16_t>(value));
+        put16(out + 2, static_cast<uint16_t>(value >> 16));
+    }
+
+    void put64(uint8_t *out, const uint64_t value)
+    {
+        put32(out, static_cast<uint32_t>(value));
+        put32(out + 4, static_cast<uint32_t>(value >> 32));
+    }
+}
+
+const size_t FlightRecorder::headerLength;
+const size_t FlightRecorder::maxPayloadLength;
+
+FlightRecorder::FlightRecorder()
+    : head(0), tail(0), overwrittenCount(0), enabled(false)
+{
+    epoch = std::chrono::steady_clock::now();
+    epochWallClock = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void FlightRecorder::resize(const size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Records of a previous session are kept when the adapter is opened again with the same size
+    if (capacity == ring.size())
+    {
+        return;
+    }
+
+    ring.assign(capacity, 0);
+    ring.shrink_to_fit();
+    head = 0;
+    tail = 0;
+    overwrittenCount = 0;
+    enabled = capacity > headerLength + maxPayloadLength;
+}
+
+bool FlightRecorder::isEnabled() const
+{
+    return enabled;
+}
+
+// Must be called with mutex locked
+void FlightRecorder::write(const uint8_t *data, const size_t length)
+{
+    auto capacity = ring.size();
+    auto position = static_cast<size_t>(head % capacity);
+    auto first = std::min(length, capacity - position);
+
+    std::memcpy(ring.data() + position, data, first);
+    std::memcpy(ring.data(), data + first, length - first);
+
+    head += length;
+}
+
+void FlightRecorder::record(const FlightRecordType type, const uint8_t flags, const uint32_t code, const uint32_t value,
+                            const void *payload, const size_t payloadLength)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    auto timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+    auto length = std::min(payloadLength, maxPayloadLength);
+
+    uint8_t header[headerLength];
+    put16(header, static_cast<uint16_t>(headerLength + length));
+    header[2] = static_cast<uint8_t>(type);
+    header[3] = flags;
+    put32(header + 4, code);
+    put32(header + 8, value);
+    put64(header + 12, static_cast<uint64_t>(timestamp));
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!enabled)
+    {
+        return;
+    }
+
+    auto capacity = ring.size();
+
+    // Drop the oldest records until the new one fits
+    while (head + headerLength + length - tail > capacity)
+    {
+        auto position = static_cast<size_t>(tail % capacity);
+        auto oldLength = static_cast<uint16_t>(ring[position] | (ring[(position + 1) % capacity] << 8));
+        tail += oldLength;
+        overwrittenCount += 1;
+    }
+
+    write(header, headerLength);
+    write(static_cast<const uint8_t *>(payload), length);
+}
+
+void FlightRecorder::record(const FlightRecordType type, const uint8_t flags, const uint32_t code, const uint32_t value,
+                            const char *text)
+{
+    record(type, flags, code, value, text, text == nullptr ? 0 : std::strlen(text));
+}
+
+std::vector<uint8_t> FlightRecorder::dump()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto length = static_cast<size_t>(head - tail);
+    std::vector<uint8_t> output(24 + length);
+
+    std::memcpy(output.data(), "BLEFLT01", 8);
+    put32(output.data() + 8, static_cast<uint32_t>(length));
+    put32(output.data() + 12, overwrittenCount);
+
+    uint64_t wallClock;
+    static_assert(sizeof(wallClock) == sizeof(epochWallClock), "double must be 64 bits");
+    std::memcpy(&wallClock, &epochWallClock, sizeof(wallClock));
+    put64(output.data() + 16, wallClock);
+
+    if (length > 0)
+    {
+        auto capacity = ring.size();
+        auto position = static_cast<size_t>(tail % capacity);
+        auto first = std::min(length, capacity - position);
+
+        std::memcpy(output.data() + 24, ring.data() + position, first);
+        std::memcpy(output.data() + 24 + first, ring.data(), length - first);
+    }
+
+    return output;
+}
@@ -0,0 +1,108 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum FlightRecordType
+{
+    FLIGHT_RECORD_EVENT = 1,
+    FLIGHT_RECORD_COMMAND_ISSUED = 2,
+    FLIGHT_RECORD_COMMAND_COMPLETED = 3,
+    FLIGHT_RECORD_LOG = 4,
+    FLIGHT_RECORD_STATUS = 5
+};
+
+// Always-on record of what happened to one adapter, written out after a failure.
+//
+// Records are appended to a fixed size byte ring by the NodeJS, command and driver threads, the oldest records
+// are overwritten when the ring is full. A record is a 20 byte little endian header followed by its payload:
+//
+//   uint16 length     Length of the record including the header
+//   uint8  type       FlightRecordType
+//   uint8  flags      Log severity, or abort reason of a completed command
+//   uint32 code       Event id, command id or status id
+//   uint32 value      Result of a completed command
+//   uint64 timestamp  Microseconds since the recorder was created
+//
+// The payload is the raw ble_evt_t of an event, the name of a command, or the message of a log line or status.
+// A dump starts with a 24 byte header: the magic "BLEFLT01", uint32 length of the records that follow,
+// uint32 number of records overwritten, and the wall clock time of timestamp 0 as a double in milliseconds
+// since the epoch. api/util/flightRecorder.js decodes dumps.
+class FlightRecorder
+{
+public:
+    FlightRecorder();
+
+    // Clears the ring and sets its size in bytes if the size changes, 0 disables recording
+    void resize(const size_t capacity);
+    bool isEnabled() const;
+
+    void record(const FlightRecordType type, const uint8_t flags, const uint32_t code, const uint32_t value,
+                const void *payload, const size_t payloadLength);
+    void record(const FlightRecordType type, const uint8_t flags, const uint32_t code, const uint32_t value,
+                const char *text);
+
+    // Copies the header and the records, oldest first, in the dump format
+    std::vector<uint8_t> dump();
+
+    static const size_t headerLength = 20;
+    static const size_t maxPayloadLength = 4096;
+
+private:
+    void write(const uint8_t *data, const size_t length);
+
+    std::vector<uint8_t> ring;
+    uint64_t head; // Total bytes written
+    uint64_t tail; // Position of the oldest record, in total bytes written
+    uint32_t overwrittenCount;
+    std::atomic<bool> enabled;
+
+    std::chrono::steady_clock::time_point epoch;
+    double epochWallClock;
+
+    std::mutex mutex;
+};
+
+#endif // FLIGHT_RECORDER_H
@@ -0,0 +1,172 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "health_monitor.h"
+
+#include <algorithm>
+
+namespace
+{
+    double percentile(const std::vector<uint32_t> &sorted, const double fraction)
+    {
+        if (sorted.empty())
+        {
+            return 0;
+        }
+
+        auto index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+        return sorted[index] / 1000.0;
+    }
+}
+
+HealthMonitor::HealthMonitor()
+{
+    roundTrips.reserve(HEALTH_ROUND_TRIP_SAMPLES);
+    reset();
+}
+
+void HealthMonitor::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    roundTrips.clear();
+    roundTripCount = 0;
+
+    sendRetriesExhaustedCount = 0;
+    unexpectedPacketCount = 0;
+    encodeErrorCount = 0;
+    decodeErrorCount = 0;
+    sendErrorCount = 0;
+    ioErrorCount = 0;
+    resetCount = 0;
+
+    eventCount = 0;
+    eventBytes = 0;
+    eventReceived = false;
+    started = std::chrono::steady_clock::now();
+}
+
+void HealthMonitor::recordRoundTrip(const std::chrono::microseconds duration)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto sample = static_cast<uint32_t>(std::min<int64_t>(duration.count(), UINT32_MAX));
+
+    if (roundTrips.size() < HEALTH_ROUND_TRIP_SAMPLES)
+    {
+        roundTrips.push_back(sample);
+    }
+    else
+    {
+        roundTrips[roundTripCount % HEALTH_ROUND_TRIP_SAMPLES] = sample;
+    }
+
+    roundTripCount++;
+}
+
+void HealthMonitor::recordEvent(const size_t length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    eventCount++;
+    eventBytes += length;
+    eventReceived = true;
+    lastEvent = std::chrono::steady_clock::now();
+}
+
+void HealthMonitor::recordStatus(const sd_rpc_app_status_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    switch (id)
+    {
+        case PKT_SEND_MAX_RETRIES_REACHED:
+            sendRetriesExhaustedCount++;
+            break;
+        case PKT_UNEXPECTED:
+            unexpectedPacketCount++;
+            break;
+        case PKT_ENCODE_ERROR:
+            encodeErrorCount++;
+            break;
+        case PKT_DECODE_ERROR:
+            decodeErrorCount++;
+            break;
+        case PKT_SEND_ERROR:
+            sendErrorCount++;
+            break;
+        case IO_RESOURCES_UNAVAILABLE:
+            ioErrorCount++;
+            break;
+        case RESET_PERFORMED:
+            resetCount++;
+            break;
+        default:
+            break;
+    }
+}
+
+void HealthMonitor::getReport(HealthReport &report)
+{
+    std::vector<uint32_t> sorted;
+    auto now = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        sorted = roundTrips;
+
+        report.roundTripCount = roundTripCount;
+        report.sendRetriesExhaustedCount = sendRetriesExhaustedCount;
+        report.unexpectedPacketCount = unexpectedPacketCount;
+        report.encodeErrorCount = encodeErrorCount;
+        report.decodeErrorCount = decodeErrorCount;
+        report.sendErrorCount = sendErrorCount;
+        report.ioErrorCount = ioErrorCount;
+        report.resetCount = resetCount;
+        report.eventCount = eventCount;
+        report.eventBytes = eventBytes;
+        report.timeSinceLastEvent = eventReceived ? std::chrono::duration<double, std::milli>(now - lastEvent).count() : -1;
+        report.uptime = std::chrono::duration<double, std::milli>(now - started).count();
+    }
+
+    std::sort(sorted.begin(), sorted.end());
+
+    report.roundTripP50 = percentile(sorted, 0.5);
+    report.roundTripP90 = percentile(sorted, 0.9);
+    report.roundTripP99 = percentile(sorted, 0.99);
+    report.roundTripMax = sorted.empty() ? 0 : sorted.back() / 1000.0;
+}
@@ -0,0 +1,119 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HEALTH_MONITOR_H
+#define HEALTH_MONITOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "sd_rpc.h"
+
+// Number of recent RPC round trips the percentiles of a health report are computed from
+const auto HEALTH_ROUND_TRIP_SAMPLES = 256;
+
+struct HealthReport
+{
+public:
+    // Round trip of the RPC calls, from sending the command to receiving its response, in milliseconds
+    uint32_t roundTripCount;
+    double roundTripP50;
+    double roundTripP90;
+    double roundTripP99;
+    double roundTripMax;
+
+    // Transport errors reported by the driver on the status channel
+    uint32_t sendRetriesExhaustedCount;
+    uint32_t unexpectedPacketCount;
+    uint32_t encodeErrorCount;
+    uint32_t decodeErrorCount;
+    uint32_t sendErrorCount;
+    uint32_t ioErrorCount;
+    uint32_t resetCount;
+
+    uint32_t eventCount;
+    uint64_t eventBytes;
+
+    // Milliseconds since the last event, or -1 if no event has been received
+    double timeSinceLastEvent;
+
+    // Milliseconds since the monitor was reset when the adapter was opened
+    double uptime;
+};
+
+// Collects the health of the link to the connectivity chip of one adapter.
+//
+// Round trips are recorded by the command thread, events and statuses by the driver threads.
+// The counters are cumulative from the last reset, the round trip percentiles cover the
+// most recent HEALTH_ROUND_TRIP_SAMPLES calls.
+class HealthMonitor
+{
+public:
+    HealthMonitor();
+
+    void reset();
+
+    void recordRoundTrip(const std::chrono::microseconds duration);
+    void recordEvent(const size_t length);
+    void recordStatus(const sd_rpc_app_status_t id);
+
+    void getReport(HealthReport &report);
+
+private:
+    std::vector<uint32_t> roundTrips; // Microseconds, used as a ring
+    uint32_t roundTripCount;
+
+    uint32_t sendRetriesExhaustedCount;
+    uint32_t unexpectedPacketCount;
+    uint32_t encodeErrorCount;
+    uint32_t decodeErrorCount;
+    uint32_t sendErrorCount;
+    uint32_t ioErrorCount;
+    uint32_t resetCount;
+
+    uint32_t eventCount;
+    uint64_t eventBytes;
+    bool eventReceived;
+    std::chrono::steady_clock::time_point lastEvent;
+    std::chrono::steady_clock::time_point started;
+
+    std::mutex mutex;
+};
+
+#endif // HEALTH_MONITOR_H
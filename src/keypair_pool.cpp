@@ -0,0 +1,198 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "keypair_pool.h"
+
+#include <chrono>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Lets the refill run only when the CPU is not needed for anything else
+static void lowerThreadPriority()
+{
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#elif defined(__linux__)
+    // The nice value of a thread is set through its thread id on Linux
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+}
+
+KeypairPool::KeypairPool(GenerateFunction generate)
+    : generate(generate), size(0), running(false), hitCount(0), missCount(0)
+{
+}
+
+KeypairPool::~KeypairPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+
+    condition.notify_one();
+
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+
+    memset(keypairs.data(), 0, keypairs.size() * sizeof(Keypair));
+}
+
+void KeypairPool::setSize(const size_t newSize)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size = newSize;
+
+    while (keypairs.size() > size)
+    {
+        memset(&keypairs.back(), 0, sizeof(Keypair));
+        keypairs.pop_back();
+    }
+
+    keypairs.reserve(size);
+
+    if (size > 0 && !running)
+    {
+        running = true;
+        worker = std::thread(&KeypairPool::run, this);
+    }
+
+    condition.notify_one();
+}
+
+bool KeypairPool::take(uint8_t *sk, uint8_t *pk)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!keypairs.empty())
+        {
+            auto &keypair = keypairs.back();
+            memcpy(sk, keypair.sk, KEYPAIR_POOL_SK_LEN);
+            memcpy(pk, keypair.pk, KEYPAIR_POOL_PK_LEN);
+            memset(&keypair, 0, sizeof(Keypair));
+            keypairs.pop_back();
+
+            hitCount++;
+            condition.notify_one();
+            return true;
+        }
+
+        if (size > 0)
+        {
+            missCount++;
+        }
+    }
+
+    return generate(sk, pk);
+}
+
+size_t KeypairPool::getSize()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return size;
+}
+
+size_t KeypairPool::getAvailable()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return keypairs.size();
+}
+
+uint32_t KeypairPool::getHitCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return hitCount;
+}
+
+uint32_t KeypairPool::getMissCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return missCount;
+}
+
+// This runs in the key pair pool thread
+void KeypairPool::run()
+{
+    lowerThreadPriority();
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (running)
+    {
+        condition.wait(lock, [this] { return !running || keypairs.size() < size; });
+
+        if (!running)
+        {
+            break;
+        }
+
+        lock.unlock();
+
+        Keypair keypair;
+        auto generated = generate(keypair.sk, keypair.pk);
+
+        lock.lock();
+
+        // The size may have been reduced while the key pair was generated
+        if (generated && keypairs.size() < size)
+        {
+            keypairs.push_back(keypair);
+        }
+
+        memset(&keypair, 0, sizeof(Keypair));
+
+        if (!generated)
+        {
+            // Do not spin if the generator keeps failing, takers generate their own key pairs meanwhile
+            condition.wait_for(lock, std::chrono::seconds(1));
+        }
+    }
+}
@@ -0,0 +1,96 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef KEYPAIR_POOL_H
+#define KEYPAIR_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define KEYPAIR_POOL_SK_LEN 32
+#define KEYPAIR_POOL_PK_LEN 64
+
+// Key pairs generated ahead of time on a low priority thread.
+//
+// Taking a key pair is O(1). The pool is refilled up to its size in the background after each take,
+// if it is empty the key pair is generated by the caller. A size of 0 disables the pool.
+class KeypairPool
+{
+public:
+    // Generates one little endian key pair, returns false on failure
+    typedef bool (*GenerateFunction)(uint8_t *sk, uint8_t *pk);
+
+    explicit KeypairPool(GenerateFunction generate);
+    ~KeypairPool();
+
+    void setSize(const size_t size);
+
+    bool take(uint8_t *sk, uint8_t *pk);
+
+    // Statistics:
+    size_t getSize();
+    size_t getAvailable();
+    uint32_t getHitCount();
+    uint32_t getMissCount();
+
+private:
+    struct Keypair
+    {
+        uint8_t sk[KEYPAIR_POOL_SK_LEN];
+        uint8_t pk[KEYPAIR_POOL_PK_LEN];
+    };
+
+    void run();
+
+    GenerateFunction generate;
+
+    std::vector<Keypair> keypairs;
+    size_t size;
+    bool running;
+    std::thread worker;
+
+    uint32_t hitCount;
+    uint32_t missCount;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+};
+
+#endif // KEYPAIR_POOL_H
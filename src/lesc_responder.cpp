@@ -0,0 +1,171 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "lesc_responder.h"
+
+#include <cstring>
+
+#include "nrf_error.h"
+
+LescResponder::LescResponder()
+    : enabled(false), running(false)
+{
+}
+
+LescResponder::~LescResponder()
+{
+    stop();
+    memset(privateKey, 0, sizeof(privateKey));
+}
+
+void LescResponder::setHandlers(ReplyFunction replyFunction, ResultFunction resultFunction)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    reply = replyFunction;
+    result = resultFunction;
+}
+
+void LescResponder::setPrivateKey(const uint8_t *sk)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (sk == nullptr)
+    {
+        enabled = false;
+        memset(privateKey, 0, sizeof(privateKey));
+        return;
+    }
+
+    memcpy(privateKey, sk, sizeof(privateKey));
+    enabled = true;
+}
+
+bool LescResponder::submit(const uint16_t connHandle, const uint8_t *peerPk)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!enabled || !reply || peerPk == nullptr)
+    {
+        return false;
+    }
+
+    // The key is copied so that a request is answered with the key that was set when it arrived
+    Request request;
+    request.connHandle = connHandle;
+    memcpy(request.sk, privateKey, sizeof(request.sk));
+    memcpy(request.pk, peerPk, sizeof(request.pk));
+    requests.push_back(request);
+
+    // stop() has joined the previous worker, if any
+    if (!running)
+    {
+        running = true;
+        worker = std::thread(&LescResponder::run, this);
+    }
+
+    condition.notify_one();
+    return true;
+}
+
+void LescResponder::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        requests.clear();
+    }
+
+    condition.notify_one();
+
+    if (worker.joinable() && worker.get_id() != std::this_thread::get_id())
+    {
+        worker.join();
+    }
+}
+
+// This runs in the LESC worker thread
+void LescResponder::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        condition.wait(lock, [this] { return !running || !requests.empty(); });
+
+        if (!running)
+        {
+            break;
+        }
+
+        auto request = requests.front();
+        requests.pop_front();
+
+        auto replyFunction = reply;
+        auto resultFunction = result;
+
+        lock.unlock();
+
+        uint8_t dhkey[ECC_P256_SK_LEN];
+        uint32_t errorCode;
+
+        if (eccP256ComputeSharedSecret(request.sk, request.pk, dhkey))
+        {
+            errorCode = replyFunction(request.connHandle, dhkey);
+        }
+        else
+        {
+            // The peer key is invalid. A random DHKey fails the DHKey check of the pairing now instead of
+            // leaving it to the SMP timeout, and tells the peer nothing about the private key.
+            errorCode = NRF_ERROR_INVALID_DATA;
+
+            if (eccP256Random(dhkey, sizeof(dhkey)))
+            {
+                replyFunction(request.connHandle, dhkey);
+            }
+        }
+
+        memset(dhkey, 0, sizeof(dhkey));
+        memset(request.sk, 0, sizeof(request.sk));
+
+        if (resultFunction)
+        {
+            resultFunction(request.connHandle, errorCode);
+        }
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,101 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LESC_RESPONDER_H
+#define LESC_RESPONDER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "ecc_p256.h"
+
+// Answers LE Secure Connections DHKey requests of one adapter without involving JavaScript.
+//
+// Requests are submitted by the driver thread. A worker thread computes the shared secret with the
+// private key set by JavaScript and replies to the SoftDevice, so pairing does not wait for the event loop.
+class LescResponder
+{
+public:
+    // Sends the DHKey to the SoftDevice, returns the result of the RPC
+    typedef std::function<uint32_t(const uint16_t connHandle, const uint8_t *dhkey)> ReplyFunction;
+
+    // Called on the worker thread with the result of the reply, or NRF_ERROR_INVALID_DATA if the peer public key
+    // was invalid and the pairing was failed with a random DHKey
+    typedef std::function<void(const uint16_t connHandle, const uint32_t result)> ResultFunction;
+
+    LescResponder();
+    ~LescResponder();
+
+    void setHandlers(ReplyFunction reply, ResultFunction result);
+
+    // Sets the little endian private key used for the replies, nullptr disables them
+    void setPrivateKey(const uint8_t *sk);
+
+    // Returns false if replies are disabled, the request is then left to JavaScript
+    bool submit(const uint16_t connHandle, const uint8_t *peerPk);
+
+    // Discards the requests not answered yet and stops the worker thread
+    void stop();
+
+private:
+    struct Request
+    {
+        uint16_t connHandle;
+        uint8_t sk[ECC_P256_SK_LEN];
+        uint8_t pk[ECC_P256_PK_LEN];
+    };
+
+    void run();
+
+    ReplyFunction reply;
+    ResultFunction result;
+
+    bool enabled;
+    uint8_t privateKey[ECC_P256_SK_LEN];
+
+    std::deque<Request> requests;
+    bool running;
+    std::thread worker;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+};
+
+#endif // LESC_RESPONDER_H
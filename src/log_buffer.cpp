@@ -0,0 +1,173 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "log_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    size_t severityIndex(const sd_rpc_log_severity_t severity)
+    {
+        auto index = static_cast<size_t>(severity);
+        return index < LOG_SEVERITY_COUNT ? index : LOG_SEVERITY_COUNT - 1;
+    }
+}
+
+LogBuffer::LogBuffer(const size_t maxLines, const size_t maxText)
+    : maxLines(maxLines), maxText(maxText), closed(true)
+{
+    pending.droppedCount = 0;
+    pending.lines.reserve(maxLines);
+    pending.text.reserve(maxText);
+
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto i = 0; i < LOG_SEVERITY_COUNT; ++i)
+    {
+        buckets[i].rate = 0;
+        buckets[i].burst = 0;
+        buckets[i].tokens = 0;
+        buckets[i].refilled = now;
+        droppedCount[i] = 0;
+    }
+}
+
+bool LogBuffer::takeToken(TokenBucket &bucket, const std::chrono::steady_clock::time_point now)
+{
+    if (bucket.rate <= 0)
+    {
+        return true;
+    }
+
+    auto elapsed = std::chrono::duration<double>(now - bucket.refilled).count();
+    bucket.tokens = std::min(bucket.burst, bucket.tokens + elapsed * bucket.rate);
+    bucket.refilled = now;
+
+    if (bucket.tokens < 1)
+    {
+        return false;
+    }
+
+    bucket.tokens -= 1;
+    return true;
+}
+
+bool LogBuffer::append(const sd_rpc_log_severity_t severity, const char *message)
+{
+    auto index = severityIndex(severity);
+    auto length = std::strlen(message);
+    auto timestamp = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (closed)
+    {
+        return false;
+    }
+
+    if (!takeToken(buckets[index], std::chrono::steady_clock::now())
+        || pending.lines.size() >= maxLines
+        || pending.text.size() + length > maxText)
+    {
+        droppedCount[index] += 1;
+        pending.droppedCount += 1;
+        return false;
+    }
+
+    LogLine line;
+    line.severity = severity;
+    line.timestamp = timestamp;
+    line.offset = pending.text.size();
+    line.length = length;
+
+    pending.text.insert(pending.text.end(), message, message + length);
+    pending.lines.push_back(line);
+
+    return pending.lines.size() == 1;
+}
+
+void LogBuffer::take(LogBatch &batch)
+{
+    batch.clear();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::swap(batch, pending);
+}
+
+void LogBuffer::setRateLimit(const sd_rpc_log_severity_t severity, const double linesPerSecond, const double burst)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &bucket = buckets[severityIndex(severity)];
+
+    bucket.rate = linesPerSecond;
+    bucket.burst = std::max(1.0, burst);
+    bucket.tokens = bucket.burst;
+    bucket.refilled = std::chrono::steady_clock::now();
+}
+
+void LogBuffer::open()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = false;
+}
+
+void LogBuffer::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    pending.clear();
+}
+
+uint32_t LogBuffer::getDroppedCount(const sd_rpc_log_severity_t severity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return droppedCount[severityIndex(severity)];
+}
+
+uint32_t LogBuffer::getDroppedCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t total = 0;
+
+    for (auto count : droppedCount)
+    {
+        total += count;
+    }
+
+    return total;
+}
@@ -0,0 +1,124 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "sd_rpc.h"
+
+// Number of sd_rpc_log_severity_t values, SD_RPC_LOG_TRACE to SD_RPC_LOG_FATAL
+const auto LOG_SEVERITY_COUNT = 6;
+
+struct LogLine
+{
+public:
+    sd_rpc_log_severity_t severity;
+    double timestamp; // Milliseconds since the epoch
+    size_t offset;    // Of the message in the text of the batch
+    size_t length;
+};
+
+// Lines collected between two wakeups of the NodeJS thread. The messages share one character
+// arena, and the batch is handed back and forth between producer and consumer so that the
+// capacity of the vectors is kept instead of allocating per line.
+struct LogBatch
+{
+public:
+    std::vector<LogLine> lines;
+    std::vector<char> text;
+    uint32_t droppedCount; // Lines dropped since the previous batch
+
+    void clear()
+    {
+        lines.clear();
+        text.clear();
+        droppedCount = 0;
+    }
+};
+
+// Collects the log lines of one adapter from the driver threads for delivery in batches.
+//
+// Each severity has a token bucket: a line takes one token, tokens are refilled at the configured
+// rate up to the burst size, and a line finding the bucket empty is dropped and counted. Lines are
+// also dropped when the pending batch is full. A rate of 0 does not limit the severity.
+class LogBuffer
+{
+public:
+    LogBuffer(const size_t maxLines, const size_t maxText);
+
+    // Returns true if the batch was empty, the consumer must then be woken up
+    bool append(const sd_rpc_log_severity_t severity, const char *message);
+
+    // Swaps the pending lines into batch, batch is cleared and becomes the new pending batch
+    void take(LogBatch &batch);
+
+    void setRateLimit(const sd_rpc_log_severity_t severity, const double linesPerSecond, const double burst);
+
+    void open();
+    void close();
+
+    uint32_t getDroppedCount(const sd_rpc_log_severity_t severity);
+    uint32_t getDroppedCount();
+
+private:
+    struct TokenBucket
+    {
+        double rate;
+        double burst;
+        double tokens;
+        std::chrono::steady_clock::time_point refilled;
+    };
+
+    bool takeToken(TokenBucket &bucket, const std::chrono::steady_clock::time_point now);
+
+    const size_t maxLines;
+    const size_t maxText;
+    bool closed;
+
+    LogBatch pending;
+    TokenBucket buckets[LOG_SEVERITY_COUNT];
+    uint32_t droppedCount[LOG_SEVERITY_COUNT];
+
+    std::mutex mutex;
+};
+
+#endif // LOG_BUFFER_H
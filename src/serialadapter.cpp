@@ -42,16 +42,48 @@ NAN_METHOD(GetAdapterList)
     auto baton = new AdapterListBaton(callback);
     strcpy(baton->errorString, "");
 
-    uv_queue_work(uv_default_loop(), baton->req, GetAdapterList, reinterpret_cast<uv_after_work_cb>(AfterGetAdapterList));
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, GetAdapterList, reinterpret_cast<uv_after_work_cb>(AfterGetAdapterList));
 }
 
 void GetAdapterList(uv_work_t *req)
 {
     auto baton = static_cast<AdapterListBaton*>(req->data);
 
+#if defined(__linux__)
+    EnumCachedSerialPorts(baton->results);
+#else
     EnumSerialPorts(baton->results);
+#endif
 }
 
+v8::Local<v8::Object> AdapterListItemToJs(SerialPortDesc *adapterItem)
+{
+    Nan::EscapableHandleScope scope;
+
+    v8::Local<v8::Object> item = Nan::New<v8::Object>();
+    Utility::Set(item, "comName", adapterItem->comName);
+    Utility::Set(item, "manufacturer", adapterItem->manufacturer);
+    Utility::Set(item, "serialNumber", adapterItem->serialNumber);
+    Utility::Set(item, "pnpId", adapterItem->pnpId);
+    Utility::Set(item, "locationId", adapterItem->locationId);
+    Utility::Set(item, "vendorId", adapterItem->vendorId);
+    Utility::Set(item, "productId", adapterItem->productId);
+
+    return scope.Escape(item);
+}
+
+#if !defined(__linux__)
+// Hot-plug events are only available from udev, other platforms poll GetAdapterList
+NAN_METHOD(WatchAdapters)
+{
+    Nan::ThrowError("Watching adapters is not supported on this platform");
+}
+
+NAN_METHOD(UnwatchAdapters)
+{
+}
+#endif
+
 void AfterGetAdapterList(uv_work_t* req) 
 {
     Nan::HandleScope scope;
@@ -71,15 +103,7 @@ void AfterGetAdapterList(uv_work_t* req)
 
         for(auto adapterItem : baton->results) 
         {
-            v8::Local<v8::Object> item = Nan::New<v8::Object>();
-            Utility::Set(item, "comName", adapterItem->comName);
-            Utility::Set(item, "manufacturer", adapterItem->manufacturer);
-            Utility::Set(item, "serialNumber", adapterItem->serialNumber);
-            Utility::Set(item, "pnpId", adapterItem->pnpId);
-            Utility::Set(item, "locationId", adapterItem->locationId);
-            Utility::Set(item, "vendorId", adapterItem->vendorId);
-            Utility::Set(item, "productId", adapterItem->productId);
-            results->Set(i++, item);
+            results->Set(i++, AdapterListItemToJs(adapterItem));
         }
 
         argv[0] = Nan::Undefined();
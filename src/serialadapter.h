@@ -41,6 +41,17 @@
 
 METHOD_DEFINITIONS(GetAdapterList);
 
+// Calls back with ('added' | 'removed', adapter) as serial ports are plugged in or out, adapter has the fields of GetAdapterList
+NAN_METHOD(WatchAdapters);
+NAN_METHOD(UnwatchAdapters);
+
+v8::Local<v8::Object> AdapterListItemToJs(SerialPortDesc *adapterItem);
+
+#if defined(__linux__)
+// Adds copies of the known adapter serial ports to results, kept up to date from udev
+void EnumCachedSerialPorts(std::list<SerialPortDesc *> &results);
+#endif
+
 struct AdapterListBaton : Baton
 {
 public:
@@ -38,135 +38,423 @@
 
 #include <libudev.h>
 
-#include <vector>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
 #include <cstring>
 #include <cassert>
+#include <cerrno>
 
-#include <sys/param.h>
-
-using namespace std;
+const char* SEGGER_VENDOR_ID = "1366";
+const char* NXP_VENDOR_ID = "0d28";
 
-typedef struct serial_device_t
+// Watches udev for J-Link and mbed serial ports being plugged in or out.
+// The known ports are kept by device node, a removed device cannot be queried for its USB attributes anymore.
+struct AdapterWatcher
 {
-    char port[MAXPATHLEN];
-    char locationId[MAXPATHLEN];
-    char vendorId[MAXPATHLEN];
-    char productId[MAXPATHLEN];
-    char manufacturer[MAXPATHLEN];
-    char serialNumber[MAXPATHLEN];
-} serial_device_t;
+    bool watching;
+    struct udev *udev_ctx;
+    struct udev_monitor *monitor;
+    uv_poll_t poll;
+    Nan::Callback *callback;
+    std::map<std::string, SerialPortDesc *> ports;
+};
+
+// The addon may be loaded by several worker threads, each watches with its own event loop and callback
+static std::map<v8::Isolate *, AdapterWatcher *> adapterWatchers;
+static std::mutex adapterWatchersMutex;
+
+// Result of GetAdapterList, scanned once and then kept up to date from a udev monitor of its own.
+// The monitor is drained on each call, so a call costs a copy of the known ports instead of a scan.
+struct AdapterCache
+{
+    std::mutex mutex;
+    struct udev *udev_ctx = nullptr;
+    struct udev_monitor *monitor = nullptr;
+    std::map<std::string, SerialPortDesc *> ports;
+};
 
-const char* SEGGER_VENDOR_ID = "1366";
-const char* NXP_VENDOR_ID = "0d28";
+static AdapterCache adapterCache;
 
-typedef vector<serial_device_t*> adapter_list_t;
+// Events queued between two calls of GetAdapterList are kept by the monitor socket until then
+#define ADAPTER_CACHE_RECEIVE_BUFFER_SIZE (1024 * 1024)
 
-static adapter_list_t* GetAdapters()
+static std::string getSysattr(struct udev_device *device, const char *name)
 {
-    // Setup return value
-    adapter_list_t* devices = new adapter_list_t();
+    auto value = udev_device_get_sysattr_value(device, name);
+    return value == nullptr ? std::string() : std::string(value);
+}
 
-    // Setup udev related variables
-    struct udev *udev_ctx = udev_new();
-    assert(udev_ctx != NULL);
+// Returns the description of a tty device if it is a serial port of a supported adapter, nullptr otherwise
+static SerialPortDesc *toSerialPortDesc(struct udev_device *tty)
+{
+    auto devname = udev_device_get_devnode(tty);
 
-    struct udev_enumerate *udev_enum = udev_enumerate_new(udev_ctx);
-    assert(udev_enum != NULL);
+    // The parent is owned by the tty device
+    auto usb = udev_device_get_parent_with_subsystem_devtype(tty, "usb", "usb_device");
 
-    udev_enumerate_add_match_subsystem(udev_enum, "tty");
-    udev_enumerate_scan_devices(udev_enum);
+    if (devname == nullptr || usb == nullptr)
+    {
+        return nullptr;
+    }
 
-    struct udev_list_entry *udev_devices = udev_enumerate_get_list_entry(udev_enum);
-    struct udev_list_entry *udev_entry;
-    struct udev_device *udev_dev;
+    auto vendorId = getSysattr(usb, "idVendor");
 
-    udev_list_entry_foreach(udev_entry, udev_devices)
+    // Only add SEGGER and ARM (even though VENDOR_ID is NXPs...) devices to list
+    if (vendorId != SEGGER_VENDOR_ID && vendorId != NXP_VENDOR_ID)
     {
-        const char *path = udev_list_entry_get_name(udev_entry);
+        return nullptr;
+    }
 
-        udev_dev = udev_device_new_from_syspath(udev_ctx, path);
-        const char *devname = udev_device_get_devnode(udev_dev);
+    auto manufacturer = getSysattr(usb, "manufacturer");
 
-        udev_dev = udev_device_get_parent_with_subsystem_devtype(
-            udev_dev,
-            "usb",
-            "usb_device"
-        );
+    if (manufacturer != "SEGGER"
+        && strcasecmp(manufacturer.c_str(), "arm") != 0
+        && strcasecmp(manufacturer.c_str(), "mbed") != 0)
+    {
+        return nullptr;
+    }
 
-        const char *idVendor = udev_device_get_sysattr_value(udev_dev, "idVendor");
+    auto desc = new SerialPortDesc();
+    desc->comName = devname;
+    desc->locationId = udev_device_get_syspath(tty);
+    desc->vendorId = vendorId;
+    desc->productId = getSysattr(usb, "idProduct");
+    desc->manufacturer = manufacturer;
+    desc->serialNumber = getSysattr(usb, "serial");
+
+    return desc;
+}
 
-        // Only add SEGGER and ARM (even though VENDOR_ID is NXPs...) devices to list
-        if (idVendor != NULL && ((strcmp(idVendor, SEGGER_VENDOR_ID) == 0) || (strcmp(idVendor, NXP_VENDOR_ID) == 0)))
+static void scanAdapters(struct udev *udev_ctx, std::map<std::string, SerialPortDesc *> &ports)
+{
+    auto udev_enum = udev_enumerate_new(udev_ctx);
+    assert(udev_enum != nullptr);
+
+    // Let udev filter on the properties of its database instead of reading the USB attributes of every tty.
+    // Property matches are or'ed together and and'ed with the subsystem.
+    udev_enumerate_add_match_subsystem(udev_enum, "tty");
+    udev_enumerate_add_match_property(udev_enum, "ID_VENDOR_ID", SEGGER_VENDOR_ID);
+    udev_enumerate_add_match_property(udev_enum, "ID_VENDOR_ID", NXP_VENDOR_ID);
+    udev_enumerate_scan_devices(udev_enum);
+
+    struct udev_list_entry *udev_entry;
+
+    udev_list_entry_foreach(udev_entry, udev_enumerate_get_list_entry(udev_enum))
+    {
+        auto tty = udev_device_new_from_syspath(udev_ctx, udev_list_entry_get_name(udev_entry));
+
+        if (tty == nullptr)
         {
-            serial_device_t *serial_device = (serial_device_t*)malloc(sizeof(serial_device_t));
-            memset(serial_device, 0, sizeof(serial_device_t));
+            continue;
+        }
 
-            strcpy(serial_device->vendorId, idVendor);
-            strcpy(serial_device->port, devname);
-            strcpy(serial_device->locationId, path);
-            strcpy(serial_device->productId, udev_device_get_sysattr_value(udev_dev, "idProduct"));
-            strcpy(serial_device->manufacturer, udev_device_get_sysattr_value(udev_dev,"manufacturer"));
-            strcpy(serial_device->serialNumber, udev_device_get_sysattr_value(udev_dev, "serial"));
+        auto desc = toSerialPortDesc(tty);
 
-            devices->push_back(serial_device);
+        if (desc != nullptr)
+        {
+            ports[desc->comName] = desc;
         }
 
-        udev_device_unref(udev_dev);
+        udev_device_unref(tty);
     }
 
     udev_enumerate_unref(udev_enum);
-    udev_unref(udev_ctx);
+}
+
+static void emitAdapterChange(AdapterWatcher *watcher, const char *action, SerialPortDesc *desc)
+{
+    Nan::HandleScope scope;
+
+    v8::Local<v8::Value> argv[2];
+    argv[0] = Nan::New(action).ToLocalChecked();
+    argv[1] = AdapterListItemToJs(desc);
 
-    return devices;
+    watcher->callback->Call(2, argv);
 }
 
-void GetAdapterList(uv_work_t* req)
+static void onAdapterWatchReadable(uv_poll_t *handle, int status, int events)
 {
-    AdapterListBaton* data = static_cast<AdapterListBaton*>(req->data);
+    auto watcher = static_cast<AdapterWatcher *>(handle->data);
+
+    if (status < 0)
+    {
+        std::cerr << "Error polling the udev monitor: " << uv_strerror(status) << std::endl;
+        return;
+    }
 
-    adapter_list_t* devices = GetAdapters();
+    // The monitor socket is non-blocking, drain every queued device. The callback may stop watching.
+    struct udev_device *tty;
 
-    for (auto device : *devices)
+    while (watcher->watching && (tty = udev_monitor_receive_device(watcher->monitor)) != nullptr)
     {
-        if ((strcmp(device->manufacturer,"SEGGER") == 0)
-            || (strcasecmp(device->manufacturer, "arm") == 0)
-            || (strcasecmp(device->manufacturer, "mbed") == 0))
+        auto action = udev_device_get_action(tty);
+        auto devname = udev_device_get_devnode(tty);
+
+        if (action != nullptr && devname != nullptr)
         {
-            AdapterListResultItem* resultItem = new AdapterListResultItem();
+            auto known = watcher->ports.find(devname);
 
-            resultItem->comName = device->port;
+            if (strcmp(action, "add") == 0 && known == watcher->ports.end())
+            {
+                auto desc = toSerialPortDesc(tty);
 
-            if (device->locationId != NULL)
+                if (desc != nullptr)
+                {
+                    watcher->ports[desc->comName] = desc;
+                    emitAdapterChange(watcher, "added", desc);
+                }
+            }
+            else if (strcmp(action, "remove") == 0 && known != watcher->ports.end())
             {
-                resultItem->locationId = device->locationId;
+                auto desc = known->second;
+                watcher->ports.erase(known);
+                emitAdapterChange(watcher, "removed", desc);
+                delete desc;
             }
+        }
+
+        udev_device_unref(tty);
+    }
+}
+
+static void onAdapterWatchClosed(uv_handle_t *handle)
+{
+    auto watcher = static_cast<AdapterWatcher *>(handle->data);
+
+    for (auto &port : watcher->ports)
+    {
+        delete port.second;
+    }
+
+    udev_monitor_unref(watcher->monitor);
+    udev_unref(watcher->udev_ctx);
+    delete watcher->callback;
+    delete watcher;
+}
+
+// Must be called from the thread of the watcher, after it is removed from adapterWatchers
+static void stopAdapterWatcher(AdapterWatcher *watcher)
+{
+    watcher->watching = false;
+
+    uv_poll_stop(&watcher->poll);
+    uv_close(reinterpret_cast<uv_handle_t *>(&watcher->poll), onAdapterWatchClosed);
+}
+
+static AdapterWatcher *removeAdapterWatcher(v8::Isolate *isolate)
+{
+    std::lock_guard<std::mutex> lock(adapterWatchersMutex);
+    auto it = adapterWatchers.find(isolate);
+
+    if (it == adapterWatchers.end())
+    {
+        return nullptr;
+    }
+
+    auto watcher = it->second;
+    adapterWatchers.erase(it);
+    return watcher;
+}
+
+#if NODE_MODULE_VERSION >= 64
+// Stops watching when the worker thread of the watcher is terminated without calling UnwatchAdapters
+static void adapterWatcherCleanup(void *arg)
+{
+    auto watcher = removeAdapterWatcher(static_cast<v8::Isolate *>(arg));
+
+    if (watcher != nullptr)
+    {
+        stopAdapterWatcher(watcher);
+    }
+}
+#endif
+
+NAN_METHOD(WatchAdapters)
+{
+    if (!info[0]->IsFunction())
+    {
+        Nan::ThrowTypeError("First argument must be a function");
+        return;
+    }
+
+    auto isolate = v8::Isolate::GetCurrent();
+
+    {
+        std::lock_guard<std::mutex> lock(adapterWatchersMutex);
+
+        if (adapterWatchers.find(isolate) != adapterWatchers.end())
+        {
+            Nan::ThrowError("Adapters are already watched");
+            return;
+        }
+    }
+
+    auto udev_ctx = udev_new();
+    assert(udev_ctx != nullptr);
+
+    auto monitor = udev_monitor_new_from_netlink(udev_ctx, "udev");
+
+    if (monitor == nullptr)
+    {
+        udev_unref(udev_ctx);
+        Nan::ThrowError("Failed to create udev monitor");
+        return;
+    }
+
+    udev_monitor_filter_add_match_subsystem_devtype(monitor, "tty", nullptr);
+
+    if (udev_monitor_enable_receiving(monitor) < 0)
+    {
+        udev_monitor_unref(monitor);
+        udev_unref(udev_ctx);
+        Nan::ThrowError("Failed to enable receiving on udev monitor");
+        return;
+    }
+
+    auto watcher = new AdapterWatcher();
+    watcher->watching = true;
+    watcher->udev_ctx = udev_ctx;
+    watcher->monitor = monitor;
+    watcher->callback = new Nan::Callback(info[0].As<v8::Function>());
+    watcher->poll.data = watcher;
+
+    // Scan after the monitor is receiving, a port plugged in meanwhile is then either scanned or reported
+    scanAdapters(udev_ctx, watcher->ports);
+
+    uv_poll_init(Nan::GetCurrentEventLoop(), &watcher->poll, udev_monitor_get_fd(monitor));
+    uv_poll_start(&watcher->poll, UV_READABLE, onAdapterWatchReadable);
+
+    // Watching adapters alone does not keep the process alive
+    uv_unref(reinterpret_cast<uv_handle_t *>(&watcher->poll));
+
+    {
+        std::lock_guard<std::mutex> lock(adapterWatchersMutex);
+        adapterWatchers[isolate] = watcher;
+    }
+
+#if NODE_MODULE_VERSION >= 64
+    node::AddEnvironmentCleanupHook(isolate, adapterWatcherCleanup, isolate);
+#endif
+}
+
+NAN_METHOD(UnwatchAdapters)
+{
+    auto isolate = v8::Isolate::GetCurrent();
+    auto watcher = removeAdapterWatcher(isolate);
+
+    if (watcher == nullptr)
+    {
+        return;
+    }
+
+#if NODE_MODULE_VERSION >= 64
+    node::RemoveEnvironmentCleanupHook(isolate, adapterWatcherCleanup, isolate);
+#endif
+
+    stopAdapterWatcher(watcher);
+}
+
+// Applies the pending udev events to the cache, or scans on the first call. Must be called with the cache locked.
+static void rescanAdapterCache()
+{
+    for (auto &port : adapterCache.ports)
+    {
+        delete port.second;
+    }
+
+    adapterCache.ports.clear();
+    scanAdapters(adapterCache.udev_ctx, adapterCache.ports);
+}
+
+static void updateAdapterCache()
+{
+    if (adapterCache.udev_ctx == nullptr)
+    {
+        adapterCache.udev_ctx = udev_new();
+        assert(adapterCache.udev_ctx != nullptr);
+
+        adapterCache.monitor = udev_monitor_new_from_netlink(adapterCache.udev_ctx, "udev");
 
-            if (device->vendorId != NULL)
+        if (adapterCache.monitor != nullptr)
+        {
+            udev_monitor_filter_add_match_subsystem_devtype(adapterCache.monitor, "tty", nullptr);
+            udev_monitor_set_receive_buffer_size(adapterCache.monitor, ADAPTER_CACHE_RECEIVE_BUFFER_SIZE);
+
+            if (udev_monitor_enable_receiving(adapterCache.monitor) < 0)
             {
-                resultItem->vendorId = device->vendorId;
+                udev_monitor_unref(adapterCache.monitor);
+                adapterCache.monitor = nullptr;
             }
+        }
+
+        scanAdapters(adapterCache.udev_ctx, adapterCache.ports);
+        return;
+    }
+
+    if (adapterCache.monitor == nullptr)
+    {
+        // Without a monitor the cache cannot be trusted, scan every time
+        rescanAdapterCache();
+        return;
+    }
+
+    struct udev_device *tty;
 
-            if (device->productId != NULL)
+    while (true)
+    {
+        errno = 0;
+        tty = udev_monitor_receive_device(adapterCache.monitor);
+
+        if (tty == nullptr)
+        {
+            // EAGAIN means every queued event was received. Any other error, like ENOBUFS when the
+            // receive buffer overflowed, means events were lost and the cache cannot be trusted.
+            if (errno != 0 && errno != EAGAIN && errno != EWOULDBLOCK)
             {
-                resultItem->productId = device->productId;
+                rescanAdapterCache();
             }
 
-            if (device->manufacturer != NULL)
+            break;
+        }
+
+        auto action = udev_device_get_action(tty);
+        auto devname = udev_device_get_devnode(tty);
+
+        if (action != nullptr && devname != nullptr)
+        {
+            auto known = adapterCache.ports.find(devname);
+
+            if (strcmp(action, "add") == 0 && known == adapterCache.ports.end())
             {
-                resultItem->manufacturer = device->manufacturer;
-            }
+                auto desc = toSerialPortDesc(tty);
 
-            if (device->serialNumber != NULL)
+                if (desc != nullptr)
+                {
+                    adapterCache.ports[desc->comName] = desc;
+                }
+            }
+            else if (strcmp(action, "remove") == 0 && known != adapterCache.ports.end())
             {
-                resultItem->serialNumber = device->serialNumber;
+                delete known->second;
+                adapterCache.ports.erase(known);
             }
-
-            data->results.push_back(resultItem);
         }
 
-        delete device;
+        udev_device_unref(tty);
     }
+}
+
+// This runs in a worker thread (not Main Thread)
+void EnumCachedSerialPorts(std::list<SerialPortDesc *> &results)
+{
+    std::lock_guard<std::mutex> lock(adapterCache.mutex);
+
+    updateAdapterCache();
 
-    devices->clear();
-    delete devices;
+    for (auto &port : adapterCache.ports)
+    {
+        results.push_back(new SerialPortDesc(*port.second));
+    }
 }
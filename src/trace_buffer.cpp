@@ -0,0 +1,264 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "trace_buffer.h"
+
+#include <chrono>
+#include <sstream>
+
+namespace
+{
+    const std::chrono::steady_clock::time_point traceEpoch = std::chrono::steady_clock::now();
+
+    std::atomic<uint32_t> nextThread(0);
+    std::atomic<uint32_t> nextInstance(0);
+
+    void writeString(std::ostringstream &out, const char *value)
+    {
+        out << '"';
+
+        for (auto c = value; *c != '\0'; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                out << '\\';
+            }
+
+            out << *c;
+        }
+
+        out << '"';
+    }
+}
+
+TraceBuffer::TraceBuffer()
+    : enabled(false), records(nullptr), capacity(0), writeIndex(0), eventId(0)
+{
+    instance = ++nextInstance;
+}
+
+TraceBuffer::~TraceBuffer()
+{
+    delete[] records.load();
+}
+
+void TraceBuffer::enable(const uint32_t requestedCapacity)
+{
+    if (records.load(std::memory_order_relaxed) == nullptr)
+    {
+        capacity = requestedCapacity != 0 ? requestedCapacity : defaultCapacity;
+
+        auto ring = new TraceRecord[capacity];
+
+        for (uint32_t i = 0; i < capacity; ++i)
+        {
+            ring[i].sequence.store(0, std::memory_order_relaxed);
+        }
+
+        records.store(ring, std::memory_order_release);
+    }
+
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void TraceBuffer::disable()
+{
+    enabled.store(false, std::memory_order_relaxed);
+}
+
+uint32_t TraceBuffer::currentThread()
+{
+    static thread_local uint32_t thread = 0;
+
+    if (thread == 0)
+    {
+        thread = ++nextThread;
+    }
+
+    return thread;
+}
+
+int64_t TraceBuffer::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+void TraceBuffer::record(const TraceStage stage, const char *name, const uint32_t id)
+{
+    if (!enabled.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    auto ring = records.load(std::memory_order_acquire);
+    auto index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    auto &record = ring[index % capacity];
+
+    // Readers skip the record until the sequence is published again
+    record.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    record.timestamp = now();
+    record.name = name;
+    record.id = id;
+    record.thread = currentThread();
+    record.stage = stage;
+
+    record.sequence.store(index + 1, std::memory_order_release);
+}
+
+void TraceBuffer::nameThread(const char *name)
+{
+    std::lock_guard<std::mutex> lock(threadNamesMutex);
+    threadNames[currentThread()] = name;
+}
+
+std::string TraceBuffer::toChromeTraceJson()
+{
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    out << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << instance
+        << ",\"args\":{\"name\":\"adapter " << instance << "\"}}";
+
+    {
+        // The trace is rendered on the NodeJS thread
+        std::lock_guard<std::mutex> lock(threadNamesMutex);
+        threadNames[currentThread()] = "NodeJS";
+
+        for (auto &threadName : threadNames)
+        {
+            out << ",{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << instance
+                << ",\"tid\":" << threadName.first << ",\"args\":{\"name\":";
+            writeString(out, threadName.second);
+            out << "}}";
+        }
+    }
+
+    auto ring = records.load(std::memory_order_acquire);
+
+    if (ring == nullptr)
+    {
+        out << "]}";
+        return out.str();
+    }
+
+    auto end = writeIndex.load(std::memory_order_acquire);
+    auto begin = end > capacity ? end - capacity : 0;
+
+    for (auto index = begin; index < end; ++index)
+    {
+        auto &slot = ring[index % capacity];
+
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+        {
+            // Being written or already overwritten
+            continue;
+        }
+
+        auto timestamp = slot.timestamp;
+        auto name = slot.name;
+        auto id = slot.id;
+        auto thread = slot.thread;
+        auto stage = slot.stage;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.sequence.load(std::memory_order_relaxed) != index + 1)
+        {
+            continue;
+        }
+
+        const char *phase;
+        const char *category;
+        const char *step = nullptr;
+        auto async = true;
+
+        switch (stage)
+        {
+            case TRACE_COMMAND_QUEUED:
+                phase = "b"; category = "command"; break;
+            case TRACE_COMMAND_STARTED:
+                phase = "B"; category = "command"; async = false; break;
+            case TRACE_COMMAND_RETURNED:
+                phase = "E"; category = "command"; async = false; break;
+            case TRACE_COMMAND_CALLBACK_STARTED:
+                phase = "B"; category = "callback"; async = false; break;
+            case TRACE_COMMAND_CALLBACK_ENDED:
+                phase = "E"; category = "callback"; async = false; break;
+            case TRACE_EVENT_RECEIVED:
+                phase = "b"; category = "event"; break;
+            case TRACE_EVENT_QUEUED:
+                phase = "n"; category = "event"; step = "queued"; break;
+            case TRACE_EVENT_DISPATCHED:
+                phase = "n"; category = "event"; step = "dispatched"; break;
+            case TRACE_EVENT_HANDLED:
+                phase = "e"; category = "event"; break;
+            default:
+                continue;
+        }
+
+        out << ",{\"ph\":\"" << phase << "\",\"cat\":\"" << category << "\",\"name\":";
+        writeString(out, name);
+        out << ",\"pid\":" << instance << ",\"tid\":" << thread << ",\"ts\":" << timestamp;
+
+        if (async)
+        {
+            out << ",\"id\":\"" << category[0] << id << "\"";
+        }
+
+        out << ",\"args\":{\"id\":" << id;
+
+        if (step != nullptr)
+        {
+            out << ",\"step\":\"" << step << "\"";
+        }
+
+        out << "}}";
+
+        // The asynchronous command span ends when its callback has returned
+        if (stage == TRACE_COMMAND_CALLBACK_ENDED)
+        {
+            out << ",{\"ph\":\"e\",\"cat\":\"command\",\"name\":";
+            writeString(out, name);
+            out << ",\"pid\":" << instance << ",\"tid\":" << thread << ",\"ts\":" << timestamp
+                << ",\"id\":\"c" << id << "\",\"args\":{\"id\":" << id << "}}";
+        }
+    }
+
+    out << "]}";
+    return out.str();
+}
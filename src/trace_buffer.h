@@ -0,0 +1,125 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TRACE_BUFFER_H
+#define TRACE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+enum TraceStage
+{
+    TRACE_COMMAND_QUEUED,
+    TRACE_COMMAND_STARTED,
+    TRACE_COMMAND_RETURNED,
+    TRACE_COMMAND_CALLBACK_STARTED,
+    TRACE_COMMAND_CALLBACK_ENDED,
+    TRACE_EVENT_RECEIVED,
+    TRACE_EVENT_QUEUED,
+    TRACE_EVENT_DISPATCHED,
+    TRACE_EVENT_HANDLED
+};
+
+struct TraceRecord
+{
+public:
+    // Index of the record plus one when it is completely written, 0 while it is being written
+    std::atomic<uint64_t> sequence;
+
+    int64_t timestamp;
+    const char *name;
+    uint32_t id;
+    uint32_t thread;
+    TraceStage stage;
+};
+
+// Records the lifecycle of commands and events of one adapter for a timeline view of where time is spent.
+//
+// Records are written by the NodeJS, command and driver threads into a fixed size ring without locking,
+// the oldest records are overwritten when the ring is full. Names must be string literals or otherwise
+// outlive the buffer, since only the pointer is recorded. The records are rendered as Chrome trace
+// event JSON, which can be loaded in chrome://tracing or https://ui.perfetto.dev.
+class TraceBuffer
+{
+public:
+    TraceBuffer();
+    ~TraceBuffer();
+
+    // Must be called from the NodeJS thread. The ring is allocated when tracing is enabled for the
+    // first time and keeps its capacity for the lifetime of the buffer.
+    void enable(const uint32_t capacity);
+    void disable();
+
+    bool isEnabled() const
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void record(const TraceStage stage, const char *name, const uint32_t id);
+
+    // Name shown for the calling thread in the trace
+    void nameThread(const char *name);
+
+    std::string toChromeTraceJson();
+
+    uint32_t nextEventId()
+    {
+        return ++eventId;
+    }
+
+    static const uint32_t defaultCapacity = 65536;
+
+private:
+    static uint32_t currentThread();
+    static int64_t now();
+
+    std::atomic<bool> enabled;
+    std::atomic<TraceRecord *> records;
+    uint32_t capacity;
+    std::atomic<uint64_t> writeIndex;
+    std::atomic<uint32_t> eventId;
+
+    // Trace process id, one per adapter
+    uint32_t instance;
+
+    std::mutex threadNamesMutex;
+    std::map<uint32_t, const char *> threadNames;
+};
+
+#endif // TRACE_BUFFER_H